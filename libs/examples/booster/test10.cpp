@@ -0,0 +1,316 @@
+#include "fungus_booster/fungus_booster.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+namespace fnet = fungus_net;
+
+constexpr fnet::message_type test_message_type = 1;
+constexpr int                n_rounds          = 20;
+
+// long enough that a waiter which only wakes on its timeout fails the test.
+constexpr double wait_timeout = 5.0;
+constexpr double max_latency  = 1.0;
+
+class test_message: public fnet::user_message
+{
+public:
+    class factory: public fnet::message::factory
+    {
+    public:
+        virtual fnet::message *create() const
+        {
+            return new test_message();
+        }
+
+        virtual fnet::message::factory *move() const
+        {
+            return new factory();
+        }
+
+        virtual fnet::message_type get_type() const
+        {
+            return test_message_type;
+        }
+    };
+
+    int m_value;
+
+    test_message(int m_value = 0):
+        fnet::user_message(fnet::message::stream_mode::sequenced, 1),
+        m_value(m_value)
+    {}
+
+    virtual fnet::message_type get_type() const
+    {
+        return test_message_type;
+    }
+
+    virtual fnet::message *copy() const
+    {
+        return new test_message(m_value);
+    }
+protected:
+    virtual void serialize_data(fungus_util::serializer &s) const
+    {
+        s << m_value;
+    }
+
+    virtual void deserialize_data(fungus_util::deserializer &s)
+    {
+        s >> m_value;
+    }
+};
+
+static double now()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// a lone wait with nothing to do sleeps out its timeout, give or take.
+static bool test_idle_wait()
+{
+    fnet::host m_host;
+    if (!m_host.start(fnet::host::flag_support_memory_connection, 4))
+        return false;
+
+    double t = now();
+    bool success = m_host.dispatch_wait(0.05);
+    double waited = now() - t;
+
+    t = now();
+    success = m_host.dispatch_wait_nsec(20000000) && success;
+    double waited_nsec = now() - t;
+
+    t = now();
+    success = m_host.dispatch_wait(0) && success;
+    double polled = now() - t;
+
+    m_host.stop();
+
+    return success && waited > 0.04 && waited < max_latency &&
+           waited_nsec > 0.015 && waited_nsec < max_latency && polled < max_latency;
+}
+
+// a callback runs inside dispatch(), holding the host lock, so a wait
+// made from it must fail at once rather than sleep holding the lock.
+class wait_in_callback_test: public fnet::host::callbacks
+{
+public:
+    fnet::host m_hosts[2];
+
+    size_t host_i;
+    size_t n_waits;
+    bool   b_waits_failed;
+    double longest_wait;
+
+    wait_in_callback_test():
+        fnet::host::callbacks(fnet::host::callbacks::implements_on_peer_connected),
+        host_i(0), n_waits(0), b_waits_failed(true), longest_wait(0)
+    {}
+
+    virtual fnet::host::callbacks::event_action on_peer_connected(const fnet::host::event &m_event)
+    {
+        double t = now();
+        b_waits_failed = !m_hosts[host_i].dispatch_wait(-1) && b_waits_failed;
+        longest_wait   = std::max(longest_wait, now() - t);
+
+        ++n_waits;
+        return fnet::host::callbacks::event_action::discard;
+    }
+
+    bool go()
+    {
+        for (size_t i = 0; i < 2; ++i)
+        {
+            if (!m_hosts[i].start(fnet::host::flag_support_memory_connection, 4) ||
+                !m_hosts[i].set_callbacks(this))
+                return false;
+        }
+
+        if (!m_hosts[1].connect(m_hosts[1].create_auth_payload(fnet::auth_status::in_progress), 0, &m_hosts[0]))
+            return false;
+
+        double t = now();
+        while (n_waits < 2 && now() - t < wait_timeout)
+        {
+            for (host_i = 0; host_i < 2; ++host_i)
+                m_hosts[host_i].dispatch();
+        }
+
+        for (size_t i = 0; i < 2; ++i)
+            m_hosts[i].stop();
+
+        return n_waits == 2 && b_waits_failed && longest_wait < max_latency;
+    }
+};
+
+// host 1 connects to host 0, and each host is dispatched by its own
+// thread, which only ever sleeps in dispatch_wait().  the main thread
+// sends from host 1, and host 0 must wake for every message long before
+// its wait times out.
+class wakeup_test
+{
+public:
+    fnet::host m_hosts[2];
+
+    std::atomic<bool>          b_quit;
+    std::atomic<bool>          b_ready;
+    std::atomic<int>           n_received;
+    std::atomic<fnet::peer_id> client_peer_id;
+
+    wakeup_test():
+        b_quit(false), b_ready(false), n_received(0), client_peer_id(fnet::null_peer_id)
+    {}
+
+    void run(size_t i)
+    {
+        while (!b_quit)
+        {
+            m_hosts[i].dispatch_wait(wait_timeout);
+
+            fnet::host::event m_event;
+            while (m_hosts[i].next_event(m_event))
+            {
+                if (m_event.m_type != fnet::host::event::type::received_auth_payload)
+                    continue;
+
+                fnet::auth_payload *m_payload = m_event.m_content.m_payload;
+
+                if (i == 0)
+                    m_hosts[0].send_auth_payload(m_event.m_id, m_hosts[0].create_auth_payload(fnet::auth_status::success));
+                else if (m_payload->get_status() == fnet::auth_status::success)
+                {
+                    client_peer_id = m_event.m_id;
+                    b_ready        = true;
+                }
+
+                m_hosts[i].destroy_auth_payload(m_payload);
+            }
+
+            fnet::peer *m_all = m_hosts[i].get_peer(fnet::all_peer_id);
+            fnet::peer::incoming_message m_in;
+
+            while (m_all && m_all->receive_message(m_in))
+            {
+                if (i == 0 && dynamic_cast<test_message *>(m_in.m_message))
+                    ++n_received;
+
+                delete m_in.m_message;
+            }
+        }
+    }
+
+    bool go(bool networked)
+    {
+        for (size_t i = 0; i < 2; ++i)
+        {
+            fnet::host::networked_host_args m_args;
+            m_args.m_ipv4 = fnet::ipv4(fnet::ipv4::host("localhost"), fnet::ipv4::default_port + i);
+
+            if (!m_hosts[i].start(networked ? fnet::host::flag_support_both : fnet::host::flag_support_memory_connection,
+                                  4, m_args) ||
+                !m_hosts[i].get_message_factory_manager().add_factory(test_message::factory()))
+                return false;
+        }
+
+        std::thread m_threads[2] = {std::thread(&wakeup_test::run, this, 0),
+                                    std::thread(&wakeup_test::run, this, 1)};
+
+        fnet::auth_payload *m_payload = m_hosts[1].create_auth_payload(fnet::auth_status::in_progress);
+        fnet::peer *m_peer = networked ?
+            m_hosts[1].connect(m_payload, 0, fnet::ipv4(fnet::ipv4::host("localhost"), fnet::ipv4::default_port)) :
+            m_hosts[1].connect(m_payload, 0, &m_hosts[0]);
+
+        // the connection and the auth handshake wake the waiters too.
+        double t = now();
+        while (m_peer && !b_ready && now() - t < wait_timeout)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+        bool success = b_ready;
+
+        for (int n = 0; success && n < n_rounds; ++n)
+        {
+            int before = n_received;
+
+            t = now();
+            m_hosts[1].send_message(client_peer_id, new test_message(n));
+
+            while (n_received == before && now() - t < wait_timeout)
+                std::this_thread::yield();
+
+            success = n_received == before + 1 && now() - t < max_latency;
+        }
+
+        // sending from this thread wakes both waiters, so they see b_quit.
+        b_quit = true;
+        for (size_t i = 0; i < 2; ++i)
+            m_hosts[i].send_message(fnet::all_peer_id, new test_message(-1));
+
+        t = now();
+        m_threads[0].join();
+        m_threads[1].join();
+
+        success = success && now() - t < max_latency;
+
+        for (size_t i = 0; i < 2; ++i)
+            m_hosts[i].stop();
+
+        return success;
+    }
+};
+
+int main()
+{
+    std::cout << "dispatch wait unit tests" << std::endl << std::endl;
+
+    fnet::initialize();
+
+    std::cout << "testing idle timed wait...";
+
+    if (test_idle_wait())
+        std::cout << "good!" << std::endl;
+    else
+    {
+        std::cout << "fail. aborting." << std::endl;
+        return 1;
+    }
+
+    std::cout << "testing dispatch wait from a callback...";
+
+    wait_in_callback_test m_callback_test;
+
+    if (m_callback_test.go())
+        std::cout << "good!" << std::endl;
+    else
+    {
+        std::cout << "fail. aborting." << std::endl;
+        return 1;
+    }
+
+    const char *names[] = {"memory", "physical"};
+
+    for (size_t networked = 0; networked < 2; ++networked)
+    {
+        std::cout << "testing " << names[networked] << " networking wakeups...";
+
+        wakeup_test m_test;
+
+        if (m_test.go(networked))
+            std::cout << "good!" << std::endl;
+        else
+        {
+            std::cout << "fail. aborting." << std::endl;
+            return 1;
+        }
+    }
+
+    fnet::deinitialize();
+
+    std::cout << "unit test complete." << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,240 @@
+#include "fungus_booster/fungus_booster.h"
+#include "fungus_booster/fungus_concurrency/fungus_concurrency_ring_buffer.h"
+#include "fungus_booster/fungus_concurrency/fungus_concurrency_comm_internal.h"
+
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace fungus_util;
+using namespace fungus_concurrency;
+
+static constexpr size_t N_VALUES    = 1000000;
+static constexpr size_t N_PRODUCERS = 4;
+
+// values carry their producer in the top byte, so the consumer can
+// check that each producer's values arrive in the order they were pushed.
+static inline size_t make_value(size_t producer, size_t i) {return (producer << 56) | i;}
+static inline size_t producer_of(size_t v)                 {return v >> 56;}
+static inline size_t index_of(size_t v)                    {return v & (((size_t)1 << 56) - 1);}
+
+static bool test_spsc()
+{
+    spsc_ring<size_t> ring(256);
+
+    std::thread producer([&]()
+    {
+        size_t batch[16];
+        size_t i = 0;
+
+        while (i < N_VALUES)
+        {
+            size_t k = 0;
+            for (; k < 16 && i + k < N_VALUES; ++k)
+                batch[k] = i + k;
+
+            // mix single and batched pushes.
+            size_t n = (i & 1) ? ring.push_n(batch, k) : (ring.push(batch[0]) ? 1 : 0);
+            if (!n) std::this_thread::yield();
+
+            i += n;
+        }
+    });
+
+    size_t out[32];
+    size_t expect = 0;
+    bool   ok     = true;
+
+    while (expect < N_VALUES)
+    {
+        size_t n = ring.pop_n(out, 32);
+        if (!n) std::this_thread::yield();
+
+        for (size_t j = 0; j < n; ++j)
+            ok = ok && out[j] == expect++;
+    }
+
+    producer.join();
+    return ok && ring.empty();
+}
+
+static bool test_mpsc()
+{
+    mpsc_ring<size_t> ring(128);
+    std::vector<std::thread> producers;
+
+    for (size_t p = 0; p < N_PRODUCERS; ++p)
+    {
+        producers.emplace_back([&ring, p]()
+        {
+            size_t batch[8];
+            size_t i = 1;
+
+            while (i <= N_VALUES / N_PRODUCERS)
+            {
+                size_t k = 0;
+                for (; k < 8 && i + k <= N_VALUES / N_PRODUCERS; ++k)
+                    batch[k] = make_value(p, i + k);
+
+                size_t n = (p & 1) ? ring.push_n(batch, k) : (ring.push(batch[0]) ? 1 : 0);
+                if (!n) std::this_thread::yield();
+
+                i += n;
+            }
+        });
+    }
+
+    std::vector<size_t> last(N_PRODUCERS, 0);
+    size_t out[32];
+    size_t got = 0;
+    bool   ok  = true;
+
+    while (got < N_VALUES / N_PRODUCERS * N_PRODUCERS)
+    {
+        size_t n = ring.pop_n(out, 32);
+        if (!n) std::this_thread::yield();
+
+        for (size_t j = 0; j < n; ++j)
+        {
+            size_t p = producer_of(out[j]);
+
+            ok      = ok && p < N_PRODUCERS && index_of(out[j]) == last[p] + 1;
+            last[p] = index_of(out[j]);
+        }
+
+        got += n;
+    }
+
+    for (auto &producer: producers)
+        producer.join();
+
+    return ok && ring.empty();
+}
+
+static bool test_reserve()
+{
+    spsc_ring<int> spsc(8);
+    mpsc_ring<int> mpsc(8);
+
+    int values[8] = {0, 1, 2, 3, 4, 5, 6, 7};
+
+    // one slot is held back from pushes with a reserve of 1.
+    size_t n_spsc = spsc.push_n(values, 8, 1);
+    size_t n_mpsc = mpsc.push_n(values, 8, 1);
+
+    return n_spsc == 7 && !spsc.push(7, 1) && spsc.push(7) && !spsc.push(8) &&
+           n_mpsc == 7 && !mpsc.push(7, 1) && mpsc.push(7) && !mpsc.push(8);
+}
+
+struct int_discard
+{
+    inline void operator()(int) {}
+};
+
+typedef inlined::comm_tplt<int, int_discard, spsc_ring> ring_comm;
+
+// more messages than the receiving ring holds, then a close: they must
+// all arrive in order, with the close last.
+static bool test_comm_back_pressure()
+{
+    static constexpr int n_messages = 5000;
+    static constexpr int close_data = 7;
+
+    ring_comm a(4, 16, 10.0, int_discard());
+    ring_comm b(4, 16, 10.0, int_discard());
+
+    ring_comm::channel_id a_id = a.open_channel(&b, 0);
+    ring_comm::channel_id b_id = ring_comm::null_channel_id;
+    ring_comm::event      event;
+
+    // messages sent before the other end accepts are dropped by a close.
+    for (int round = 0; round < 100 && (b_id == ring_comm::null_channel_id || !a.is_channel_open(a_id)); ++round)
+    {
+        b.dispatch();
+        a.dispatch();
+
+        while (b.get_event(event))
+        {
+            if (event.t == ring_comm::event::channel_open)
+                b_id = event.id;
+        }
+    }
+
+    for (int i = 0; i < n_messages; ++i)
+        a.channel_send(a_id, i);
+
+    a.close_channel(a_id, close_data);
+
+    int  expect = 0;
+    bool closed = false;
+    bool ok     = true;
+
+    for (int round = 0; round < 1000 && !closed; ++round)
+    {
+        a.dispatch();
+        b.dispatch();
+
+        while (b.get_event(event))
+        {
+            if (event.t == ring_comm::event::channel_clos)
+            {
+                closed = true;
+                ok     = ok && event.data == close_data;
+            }
+        }
+
+        int m;
+        while (b.channel_receive(b_id, m))
+            ok = ok && m == expect++;
+    }
+
+    return ok && closed && expect == n_messages;
+}
+
+int main()
+{
+    std::cout << "ring buffer unit tests" << std::endl << std::endl
+              << "testing spsc_ring push/push_n against pop_n...";
+
+    if (test_spsc())
+        std::cout << "good!" << std::endl;
+    else
+    {
+        std::cout << "fail. aborting." << std::endl;
+        return 1;
+    }
+
+    std::cout << "testing mpsc_ring push/push_n from " << N_PRODUCERS << " producers...";
+
+    if (test_mpsc())
+        std::cout << "good!" << std::endl;
+    else
+    {
+        std::cout << "fail. aborting." << std::endl;
+        return 1;
+    }
+
+    std::cout << "testing reserved slots...";
+
+    if (test_reserve())
+        std::cout << "good!" << std::endl;
+    else
+    {
+        std::cout << "fail. aborting." << std::endl;
+        return 1;
+    }
+
+    std::cout << "testing comm back pressure over spsc_ring...";
+
+    if (test_comm_back_pressure())
+        std::cout << "good!" << std::endl;
+    else
+    {
+        std::cout << "fail. aborting." << std::endl;
+        return 1;
+    }
+
+    std::cout << "unit test complete." << std::endl;
+
+    return 0;
+}
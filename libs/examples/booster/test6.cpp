@@ -0,0 +1,157 @@
+#include "fungus_booster/fungus_booster.h"
+#include "fungus_booster/fungus_concurrency/fungus_concurrency_block_allocator.h"
+#include "fungus_booster/fungus_concurrency/fungus_concurrency_ring_buffer.h"
+
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace fungus_util;
+using namespace fungus_concurrency;
+
+struct test_block
+{
+    size_t value;
+    size_t check;
+
+    test_block(size_t value): value(value), check(~value) {}
+    ~test_block() {check = 0;}
+
+    bool good(size_t expect) const {return value == expect && check == ~expect;}
+};
+
+typedef concurrent_block_allocator<test_block, 64> test_allocator;
+
+static constexpr size_t N_BLOCKS = 100000;
+static constexpr size_t N_PAIRS  = 3;
+
+// blocks are created on one thread and destroyed on another, so every
+// destroy is a remote free back to the creating thread's heap.
+static bool test_remote_frees()
+{
+    test_allocator allocator;
+    std::vector<std::thread> threads;
+    atomic<size_t> n_bad(0);
+
+    std::vector<spsc_ring<test_block *> *> rings;
+    for (size_t p = 0; p < N_PAIRS; ++p)
+        rings.push_back(new spsc_ring<test_block *>(256));
+
+    for (size_t p = 0; p < N_PAIRS; ++p)
+    {
+        spsc_ring<test_block *> *ring = rings[p];
+
+        threads.emplace_back([&allocator, ring]()
+        {
+            for (size_t i = 0; i < N_BLOCKS;)
+            {
+                test_block *b = allocator.create(i);
+                while (!ring->push(b)) std::this_thread::yield();
+
+                ++i;
+            }
+        });
+
+        threads.emplace_back([&allocator, &n_bad, ring]()
+        {
+            for (size_t i = 0; i < N_BLOCKS;)
+            {
+                test_block *b;
+                if (!ring->pop(b))
+                {
+                    std::this_thread::yield();
+                    continue;
+                }
+
+                if (!b->good(i) || !allocator.destroy(b))
+                    n_bad.fetch_add(1);
+
+                ++i;
+            }
+        });
+    }
+
+    for (auto &thread: threads)
+        thread.join();
+
+    for (auto ring: rings)
+        delete ring;
+
+    return n_bad.load() == 0 && allocator.count_alloced() == 0;
+}
+
+// a spike of blocks, all freed: the first reclaim() only marks the
+// free sets, the second gives them back, and the allocator still works.
+static bool test_reclaim()
+{
+    test_allocator allocator;
+    std::vector<test_block *> blocks;
+
+    for (size_t i = 0; i < N_BLOCKS; ++i)
+        blocks.push_back(allocator.create(i));
+
+    size_t n_peak = allocator.count_block_sets();
+
+    std::thread([&allocator, &blocks]()
+    {
+        for (auto b: blocks)
+            allocator.destroy(b);
+    }).join();
+
+    blocks.clear();
+
+    // the owner drains its remote frees when it next runs short.
+    for (size_t i = 0; i < N_BLOCKS; ++i)
+        blocks.push_back(allocator.create(i));
+
+    bool ok = true;
+    for (size_t i = 0; i < N_BLOCKS; ++i)
+    {
+        ok = ok && blocks[i]->good(i);
+        allocator.destroy(blocks[i]);
+    }
+
+    blocks.clear();
+
+    ok = ok && allocator.reclaim() == 0 && allocator.count_block_sets() == n_peak;
+    ok = ok && allocator.reclaim() > 0  && allocator.count_block_sets() < n_peak / 2;
+
+    for (size_t i = 0; i < N_BLOCKS; ++i)
+        blocks.push_back(allocator.create(i));
+
+    for (size_t i = 0; i < N_BLOCKS; ++i)
+    {
+        ok = ok && blocks[i]->good(i);
+        allocator.destroy(blocks[i]);
+    }
+
+    return ok && allocator.count_alloced() == 0;
+}
+
+int main()
+{
+    std::cout << "concurrent block allocator unit tests" << std::endl << std::endl
+              << "testing remote frees across " << N_PAIRS << " thread pairs...";
+
+    if (test_remote_frees())
+        std::cout << "good!" << std::endl;
+    else
+    {
+        std::cout << "fail. aborting." << std::endl;
+        return 1;
+    }
+
+    std::cout << "testing reclaim of free block sets...";
+
+    if (test_reclaim())
+        std::cout << "good!" << std::endl;
+    else
+    {
+        std::cout << "fail. aborting." << std::endl;
+        return 1;
+    }
+
+    std::cout << "unit test complete." << std::endl;
+
+    return 0;
+}
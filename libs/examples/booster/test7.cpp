@@ -0,0 +1,195 @@
+#include "fungus_booster/fungus_booster.h"
+#include "fungus_booster/fungus_net/fungus_net_compression_internal.h"
+#include "fungus_booster/fungus_net/fungus_net_packet.h"
+
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+using namespace fungus_util;
+using namespace fungus_net;
+
+static constexpr size_t PACKET_SIZE = 4096;
+
+static std::vector<char> make_packet(size_t size)
+{
+    std::vector<char> raw(size);
+    for (size_t i = 0; i < size; ++i)
+        raw[i] = (char)("fungus booster "[i % 15]);
+
+    return raw;
+}
+
+static std::vector<char> compress_packet(compressor &comp, const std::vector<char> &raw,
+                                         const endian_converter &endian)
+{
+    std::vector<char> out(compressor::get_bound(raw.size()));
+    out.resize(comp.compress(&raw[0], raw.size(), &out[0], out.size(), endian));
+
+    return out;
+}
+
+// reads and decompresses data the way a separator would.
+static bool try_decompress(compressor &comp, const char *data, size_t size,
+                           const endian_converter &endian, std::vector<char> &raw)
+{
+    size_t raw_size;
+    if (!compressor::is_compressed(data, size, endian) ||
+        !comp.read_header(data, size, endian, raw_size))
+        return false;
+
+    raw.resize(raw_size);
+    return comp.decompress(data, size, &raw[0], raw_size, endian);
+}
+
+static bool test_round_trip(compression_codec codec, const endian_converter &endian)
+{
+    compressor comp(codec, nullptr);
+    std::vector<char> raw = make_packet(PACKET_SIZE), out;
+    std::vector<char> packed = compress_packet(comp, raw, endian);
+
+    return !packed.empty() && packed.size() < raw.size() &&
+           try_decompress(comp, &packed[0], packed.size(), endian, out) && out == raw;
+}
+
+// every truncation and every flipped byte must fail or decompress to
+// exactly raw_size bytes, never run off either buffer.
+static bool test_damaged(compression_codec codec, const endian_converter &endian)
+{
+    compressor comp(codec, nullptr);
+    std::vector<char> raw = make_packet(PACKET_SIZE), out;
+    std::vector<char> packed = compress_packet(comp, raw, endian);
+
+    if (packed.empty()) return false;
+
+    for (size_t n = 0; n < packed.size(); ++n)
+    {
+        std::vector<char> cut(packed.begin(), packed.begin() + n);
+        if (try_decompress(comp, cut.empty() ? nullptr : &cut[0], n, endian, out))
+            return false;
+    }
+
+    for (size_t i = compressor::header_size; i < packed.size(); ++i)
+    {
+        std::vector<char> bad = packed;
+        bad[i] ^= 0x5A;
+
+        if (try_decompress(comp, &bad[0], bad.size(), endian, out) && out.size() != raw.size())
+            return false;
+    }
+
+    return true;
+}
+
+// a header may not promise more than max_raw_size, nor more than the
+// codec could have squeezed in to what follows it.
+static bool test_raw_size_bounds(compression_codec codec, const endian_converter &endian)
+{
+    std::vector<char> raw = make_packet(PACKET_SIZE), out;
+
+    compressor comp(codec, nullptr);
+    compressor small(codec, nullptr, PACKET_SIZE / 4);
+
+    std::vector<char> packed = compress_packet(comp, raw, endian);
+    if (packed.empty() || try_decompress(small, &packed[0], packed.size(), endian, out))
+        return false;
+
+    const size_t raw_size_at = sizeof(size_t) + sizeof(uint8_t) + sizeof(uint32_t);
+    const size_t lies[] = {(packed.size() - compressor::header_size + 1) * compressor::get_max_ratio(codec),
+                           default_max_decompressed_size + 1, ~(size_t)0};
+
+    for (size_t lie: lies)
+    {
+        std::vector<char> bad = packed;
+        size_t v = endian.convert(lie);
+        memcpy(&bad[raw_size_at], &v, sizeof(size_t));
+
+        size_t raw_size;
+        if (comp.read_header(&bad[0], bad.size(), endian, raw_size))
+            return false;
+    }
+
+    return true;
+}
+
+// lone messages start with the guard word and aggregates with a size,
+// and neither may look like a compressed packet.
+static bool test_marker(const endian_converter &endian)
+{
+    std::vector<char> data(PACKET_SIZE, 0);
+
+    const uint16_t guard = endian.convert((uint16_t)0xFFBE);
+    memcpy(&data[0], &guard, sizeof(guard));
+    if (compressor::is_compressed(&data[0], data.size(), endian))
+        return false;
+
+    const uint16_t old_marker = endian.convert((uint16_t)0xFFBC);
+    memcpy(&data[0], &old_marker, sizeof(old_marker));
+    if (compressor::is_compressed(&data[0], data.size(), endian))
+        return false;
+
+    const size_t aggregate = endian.convert((size_t)PACKET_SIZE);
+    memcpy(&data[0], &aggregate, sizeof(aggregate));
+    if (compressor::is_compressed(&data[0], data.size(), endian))
+        return false;
+
+    return !packet::set_guard_word(0xFFFF) && !packet::set_guard_word(-1) &&
+           !packet::set_guard_word(0x10000) && packet::set_guard_word(0xFFBE);
+}
+
+int main()
+{
+    endian_converter endian;
+
+    const compression_codec codecs[] = {compression_codec::range_coder, compression_codec::fast};
+    const char *names[] = {"range coder", "fast"};
+
+    std::cout << "packet compression unit tests" << std::endl << std::endl;
+
+    for (size_t c = 0; c < 2; ++c)
+    {
+        std::cout << "testing " << names[c] << " round trip...";
+
+        if (test_round_trip(codecs[c], endian))
+            std::cout << "good!" << std::endl;
+        else
+        {
+            std::cout << "fail. aborting." << std::endl;
+            return 1;
+        }
+
+        std::cout << "testing " << names[c] << " truncated and corrupt packets...";
+
+        if (test_damaged(codecs[c], endian))
+            std::cout << "good!" << std::endl;
+        else
+        {
+            std::cout << "fail. aborting." << std::endl;
+            return 1;
+        }
+
+        std::cout << "testing " << names[c] << " raw_size bounds...";
+
+        if (test_raw_size_bounds(codecs[c], endian))
+            std::cout << "good!" << std::endl;
+        else
+        {
+            std::cout << "fail. aborting." << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << "testing compressed packet marker...";
+
+    if (test_marker(endian))
+        std::cout << "good!" << std::endl;
+    else
+    {
+        std::cout << "fail. aborting." << std::endl;
+        return 1;
+    }
+
+    std::cout << "unit test complete." << std::endl;
+
+    return 0;
+}
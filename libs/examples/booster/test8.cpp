@@ -0,0 +1,254 @@
+#include "fungus_booster/fungus_booster.h"
+#include "fungus_booster/fungus_util/fungus_util_flat_hash_map.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <set>
+
+using namespace fungus_util;
+
+static constexpr uint32_t N_KEYS = 5000;
+
+// four keys to a hash, so runs are long and erasing shifts entries.
+class clumped_hash: public hash<uint32_t, uint32_t>
+{
+public:
+    FUNGUSUTIL_ALWAYS_INLINE inline map_index_type hash_key(const uint32_t &key, map_index_type max)
+    {
+        return (key / 4) % max;
+    }
+};
+
+// refuses to insert keys that are 4 more than a multiple of 5 and to
+// remove multiples of 3, and counts the entries clear() forces out.
+class picky_hash: public hash<uint32_t, uint32_t>
+{
+public:
+    static size_t n_forced;
+
+    FUNGUSUTIL_ALWAYS_INLINE inline hash_entry_action hash_entry_on_insert(const uint32_t &key,
+                                                                            uint32_t &value,
+                                                                            default_hash_data_type &data)
+    {
+        return key % 5 == 4 ? hash_entry_no_action : hash_entry_complete_action;
+    }
+
+    FUNGUSUTIL_ALWAYS_INLINE inline hash_entry_action hash_entry_on_remove(const uint32_t &key,
+                                                                            uint32_t &value,
+                                                                            default_hash_data_type &data)
+    {
+        return key % 3 == 0 ? hash_entry_no_action : hash_entry_complete_action;
+    }
+
+    FUNGUSUTIL_ALWAYS_INLINE inline void hash_entry_force_remove(const uint32_t &key,
+                                                                 uint32_t &value,
+                                                                 default_hash_data_type &data)
+    {
+        ++n_forced;
+    }
+};
+
+size_t picky_hash::n_forced = 0;
+
+typedef flat_hash_map<default_hash<uint32_t, uint32_t> > plain_map;
+typedef flat_hash_map<clumped_hash> clumped_map;
+
+// the map must hold exactly what ref holds.
+template <typename mapT>
+static bool matches(mapT &map, const std::map<uint32_t, uint32_t> &ref)
+{
+    if (map.size() != ref.size()) return false;
+
+    std::set<uint32_t> seen;
+    for (auto it = map.begin(); it != map.end(); ++it)
+    {
+        auto r = ref.find(it->key);
+        if (r == ref.end() || r->second != it->value || !seen.insert(it->key).second)
+            return false;
+    }
+
+    for (auto r = ref.begin(); r != ref.end(); ++r)
+    {
+        auto it = map.find(r->first);
+        if (it == map.end() || it->value != r->second)
+            return false;
+    }
+
+    return true;
+}
+
+template <typename mapT>
+static bool test_random_ops()
+{
+    mapT map;
+    std::map<uint32_t, uint32_t> ref;
+
+    srand(1);
+    for (uint32_t i = 0; i < N_KEYS * 8; ++i)
+    {
+        uint32_t key = rand() % (N_KEYS * 2), value = rand();
+
+        if (rand() % 3)
+        {
+            map.insert(std::make_pair(key, value));
+            ref[key] = value;
+        }
+        else if (map.erase(key) != (ref.erase(key) != 0))
+            return false;
+    }
+
+    if (!matches(map, ref)) return false;
+
+    map.clear();
+    return map.empty() && map.begin() == map.end();
+}
+
+// every entry left must be visited exactly once, including those
+// shifted in to the slot of one just erased.
+template <typename mapT>
+static bool test_erase_while_iterating()
+{
+    mapT map;
+    std::map<uint32_t, uint32_t> ref;
+
+    for (uint32_t key = 0; key < N_KEYS; ++key)
+    {
+        map.insert(std::make_pair(key, key * 7));
+        ref[key] = key * 7;
+    }
+
+    std::multiset<uint32_t> seen;
+    for (auto it = map.begin(); it != map.end();)
+    {
+        seen.insert(it->key);
+
+        if (it->key % 2 == 0)
+        {
+            ref.erase(it->key);
+            it = map.erase(it);
+        }
+        else
+            ++it;
+    }
+
+    if (seen.size() != N_KEYS) return false;
+    for (uint32_t key = 0; key < N_KEYS; ++key)
+    {
+        if (seen.count(key) != 1)
+            return false;
+    }
+
+    if (!matches(map, ref)) return false;
+
+    // and emptying the map the same way leaves nothing behind.
+    size_t n = 0;
+    for (auto it = map.begin(); it != map.end(); ++n)
+        it = map.erase(it);
+
+    return n == N_KEYS / 2 && map.empty() && map.begin() == map.end();
+}
+
+// an insert the policy refuses adds nothing, and a removal it refuses
+// leaves the entry where it is and erase(iterator) hands back the same
+// iterator.
+static bool test_policy_hooks()
+{
+    std::map<uint32_t, uint32_t> ref;
+    size_t n_refused = 0;
+
+    {
+        flat_hash_map<picky_hash> map;
+
+        for (uint32_t key = 0; key < N_KEYS; ++key)
+        {
+            bool added = map.insert(std::make_pair(key, key)) != map.end();
+            if (added != (key % 5 != 4)) return false;
+
+            if (added) ref[key] = key;
+        }
+
+        if (!matches(map, ref)) return false;
+
+        // a successful erase may also return the slot it was given, with
+        // the next entry shifted in to it, so look at the key.
+        for (auto it = map.begin(); it != map.end();)
+        {
+            uint32_t key = it->key;
+
+            auto next = map.erase(it);
+            if (key % 3 == 0)
+            {
+                if (next != it || next->key != key) return false;
+
+                ++n_refused;
+                ++it;
+            }
+            else
+            {
+                if (map.find(key) != map.end()) return false;
+                it = next;
+            }
+        }
+
+        for (auto r = ref.begin(); r != ref.end();)
+        {
+            if (r->first % 3 != 0)
+                ref.erase(r++);
+            else
+            {
+                if (map.erase(r->first)) return false;
+                ++r;
+            }
+        }
+
+        if (!matches(map, ref)) return false;
+
+        picky_hash::n_forced = 0;
+        map.clear();
+
+        if (!map.empty() || picky_hash::n_forced != ref.size())
+            return false;
+    }
+
+    return n_refused == ref.size();
+}
+
+int main()
+{
+    std::cout << "flat hash map unit tests" << std::endl << std::endl;
+
+    std::cout << "testing random inserts and erases...";
+
+    if (test_random_ops<plain_map>() && test_random_ops<clumped_map>())
+        std::cout << "good!" << std::endl;
+    else
+    {
+        std::cout << "fail. aborting." << std::endl;
+        return 1;
+    }
+
+    std::cout << "testing erase while iterating...";
+
+    if (test_erase_while_iterating<plain_map>() && test_erase_while_iterating<clumped_map>())
+        std::cout << "good!" << std::endl;
+    else
+    {
+        std::cout << "fail. aborting." << std::endl;
+        return 1;
+    }
+
+    std::cout << "testing hash policy hooks...";
+
+    if (test_policy_hooks())
+        std::cout << "good!" << std::endl;
+    else
+    {
+        std::cout << "fail. aborting." << std::endl;
+        return 1;
+    }
+
+    std::cout << "unit test complete." << std::endl;
+
+    return 0;
+}
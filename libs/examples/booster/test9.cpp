@@ -0,0 +1,289 @@
+#include "fungus_booster/fungus_booster.h"
+
+#include <iostream>
+#include <vector>
+
+namespace fnet = fungus_net;
+
+constexpr fnet::message_type test_message_type = 1;
+constexpr int                n_messages        = 64;
+constexpr size_t             max_dispatches    = 100000;
+
+class test_message: public fnet::user_message
+{
+public:
+    class factory: public fnet::message::factory
+    {
+    public:
+        virtual fnet::message *create() const
+        {
+            return new test_message();
+        }
+
+        virtual fnet::message::factory *move() const
+        {
+            return new factory();
+        }
+
+        virtual fnet::message_type get_type() const
+        {
+            return test_message_type;
+        }
+    };
+
+    int m_value;
+
+    test_message(int m_value = 0):
+        fnet::user_message(fnet::message::stream_mode::sequenced, 1),
+        m_value(m_value)
+    {}
+
+    virtual fnet::message_type get_type() const
+    {
+        return test_message_type;
+    }
+
+    virtual fnet::message *copy() const
+    {
+        return new test_message(m_value);
+    }
+protected:
+    virtual void serialize_data(fungus_util::serializer &s) const
+    {
+        s << m_value;
+    }
+
+    virtual void deserialize_data(fungus_util::deserializer &s)
+    {
+        s >> m_value;
+    }
+};
+
+static int value_of(const fnet::message *m_message)
+{
+    const test_message *m_test = dynamic_cast<const test_message *>(m_message);
+    return m_test ? m_test->m_value : -1;
+}
+
+// host 1 connects to host 0 through memory.  host 0 puts the peer for
+// host 1 in a group of its own, so every message host 1 sends is
+// delivered to three queues on host 0: the peer, the group and
+// all_peer_id.
+class shared_message_test
+{
+public:
+    fnet::host    m_hosts[2];
+    fnet::peer_id server_peer_id;
+    fnet::peer_id client_peer_id;
+    fnet::peer   *m_group;
+
+    shared_message_test():
+        server_peer_id(fnet::null_peer_id), client_peer_id(fnet::null_peer_id), m_group(nullptr)
+    {}
+
+    // handles the auth handshake; true once host 1 is authenticated.
+    inline bool dispatch()
+    {
+        bool authenticated = false;
+
+        for (size_t i = 0; i < 2; ++i)
+        {
+            m_hosts[i].dispatch();
+
+            fnet::host::event m_event;
+            while (m_hosts[i].next_event(m_event))
+            {
+                if (m_event.m_type != fnet::host::event::type::received_auth_payload)
+                    continue;
+
+                fnet::auth_payload *m_payload = m_event.m_content.m_payload;
+
+                if (i == 0)
+                {
+                    server_peer_id = m_event.m_id;
+                    m_hosts[0].send_auth_payload(m_event.m_id, m_hosts[0].create_auth_payload(fnet::auth_status::success));
+                }
+                else if (m_payload->get_status() == fnet::auth_status::success)
+                {
+                    client_peer_id = m_event.m_id;
+                    authenticated  = true;
+                }
+
+                m_hosts[i].destroy_auth_payload(m_payload);
+            }
+        }
+
+        return authenticated;
+    }
+
+    inline bool connect()
+    {
+        for (size_t i = 0; i < 2; ++i)
+        {
+            if (!m_hosts[i].start(fnet::host::flag_support_memory_connection, 4) ||
+                !m_hosts[i].get_message_factory_manager().add_factory(test_message::factory()))
+                return false;
+        }
+
+        if (!m_hosts[1].connect(m_hosts[1].create_auth_payload(fnet::auth_status::in_progress), 0, &m_hosts[0]))
+            return false;
+
+        size_t n = 0;
+        while (!dispatch())
+        {
+            if (++n >= max_dispatches)
+                return false;
+        }
+
+        fnet::peer *m_peer = m_hosts[0].get_peer(server_peer_id);
+        m_group = m_hosts[0].create_group();
+
+        return m_peer && m_group && m_group->add_member(m_peer);
+    }
+
+    // sends n_messages from host 1 and collects them from the peer on
+    // host 0, in order.
+    inline bool transfer(std::vector<fnet::peer::shared_incoming_message> &m_received)
+    {
+        for (int v = 0; v < n_messages; ++v)
+        {
+            if (!m_hosts[1].send_message(client_peer_id, new test_message(v)))
+                return false;
+        }
+
+        fnet::peer *m_peer = m_hosts[0].get_peer(server_peer_id);
+        fnet::peer::shared_incoming_message m_shared;
+
+        for (size_t n = 0; m_received.size() < (size_t)n_messages; ++n)
+        {
+            if (n >= max_dispatches)
+                return false;
+
+            dispatch();
+
+            while (m_peer->receive_shared_message(m_shared))
+            {
+                if (m_shared.get_sender_id() != server_peer_id ||
+                    value_of(m_shared.get_message()) != (int)m_received.size())
+                    return false;
+
+                m_received.push_back(m_shared);
+            }
+        }
+
+        m_shared.reset();
+        return m_shared.get_message() == nullptr && m_shared.get_sender_id() == fnet::null_peer_id;
+    }
+
+    inline void stop()
+    {
+        for (size_t i = 0; i < 2; ++i)
+            m_hosts[i].stop();
+    }
+};
+
+// the group shares the instances the peer handed out, and skips the ones
+// marked as read through them.
+static bool test_shared_queues(shared_message_test &m_test)
+{
+    std::vector<fnet::peer::shared_incoming_message> m_received;
+    if (!m_test.transfer(m_received)) return false;
+
+    for (int v = 1; v < n_messages; v += 2)
+        m_received[v].mark_as_read();
+
+    fnet::peer::shared_incoming_message m_shared;
+    int v = 0;
+
+    while (m_test.m_group->receive_shared_message(m_shared))
+    {
+        if (v >= n_messages || m_shared.get_message() != m_received[v].get_message())
+            return false;
+
+        v += 2;
+    }
+
+    if (v != n_messages) return false;
+
+    // receive_message() clones, since m_received still holds every message.
+    fnet::peer *m_all = m_test.m_hosts[0].get_peer(fnet::all_peer_id);
+    fnet::peer::incoming_message m_in;
+    bool success = true;
+
+    for (v = 0; m_all->receive_message(m_in); v += 2)
+    {
+        if (v >= n_messages || m_in.m_message == m_received[v].get_message() ||
+            value_of(m_in.m_message) != v || m_in.sender_id != m_test.server_peer_id)
+            success = false;
+
+        delete m_in.m_message;
+    }
+
+    return success && v == n_messages;
+}
+
+// a handle keeps its message after every queue has let go of it.
+static bool test_outlives_queues(shared_message_test &m_test)
+{
+    std::vector<fnet::peer::shared_incoming_message> m_received;
+    if (!m_test.transfer(m_received)) return false;
+
+    fnet::peer::shared_incoming_message m_kept(m_received[n_messages - 1]), m_copy;
+    m_received.clear();
+
+    m_test.m_group->discard_all_messages();
+    m_test.m_hosts[0].get_peer(fnet::all_peer_id)->discard_all_messages();
+
+    m_copy = m_kept;
+    m_kept = m_kept;
+    m_kept.reset();
+
+    return value_of(m_copy.get_message()) == n_messages - 1 &&
+           m_copy.get_sender_id() == m_test.server_peer_id;
+}
+
+int main()
+{
+    std::cout << "shared incoming message unit tests" << std::endl << std::endl;
+
+    fnet::initialize();
+
+    shared_message_test m_test;
+
+    std::cout << "testing memory connection...";
+
+    if (m_test.connect())
+        std::cout << "good!" << std::endl;
+    else
+    {
+        std::cout << "fail. aborting." << std::endl;
+        return 1;
+    }
+
+    std::cout << "testing peer and group queues sharing messages...";
+
+    if (test_shared_queues(m_test))
+        std::cout << "good!" << std::endl;
+    else
+    {
+        std::cout << "fail. aborting." << std::endl;
+        return 1;
+    }
+
+    std::cout << "testing shared messages outliving their queues...";
+
+    if (test_outlives_queues(m_test))
+        std::cout << "good!" << std::endl;
+    else
+    {
+        std::cout << "fail. aborting." << std::endl;
+        return 1;
+    }
+
+    m_test.stop();
+    fnet::deinitialize();
+
+    std::cout << "unit test complete." << std::endl;
+
+    return 0;
+}
@@ -25,6 +25,8 @@ namespace fungus_concurrency
     bool comm::channel_discard_all(channel_id id)                       {return pimpl_->channel_discard_all(id);}
     void comm::all_channels_discard_all()                               {       pimpl_->all_channels_discard_all();}
     void comm::dispatch()                                               {       pimpl_->dispatch();}
+    bool comm::wait_for_activity(sec_duration_t timeout)                {return pimpl_->wait_for_activity(timeout);}
+    bool comm::wait_for_activity_nsec(nsec_duration_t timeout)          {return pimpl_->wait_for_activity_nsec(timeout);}
     bool comm::peek_event(event &event) const                           {return pimpl_->peek_event(event);}
     bool comm::get_event(event &event)                                  {return pimpl_->get_event(event);}
     void comm::clear_events()                                           {       pimpl_->clear_events();}
@@ -0,0 +1,638 @@
+#ifndef FUNGUSCONCURRENCY_BLOCK_ALLOCATOR_H
+#define FUNGUSCONCURRENCY_BLOCK_ALLOCATOR_H
+
+#include "fungus_concurrency_common.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace fungus_concurrency
+{
+    using namespace fungus_util;
+
+    // an address unique to the calling thread among the live threads.
+    // not static, so that every translation unit sees the same one.
+    inline const void *__thread_token()
+    {
+        static __thread char token;
+        return &token;
+    }
+
+#ifndef FUNGUSUTIL_NO_BLOCK_ALLOCATOR
+    // a block_allocator whose blocks may be created and destroyed on any
+    // thread, with the same interface so that it can stand in for one.
+    //
+    // every thread that uses the allocator gets a heap of its own, which
+    // caches free blocks in two magazines (fixed size stacks), so that
+    // the common case touches nothing shared.  a thread whose magazines
+    // are both full hands one over to the depot, a small lock-free array
+    // of full magazines that a thread whose magazines are both empty
+    // takes from.  only when the depot has nothing to give does a heap
+    // go to the central free list, which is locked, and which grows by
+    // whole block sets.
+    //
+    // a block remembers the heap that created it.  destroying it on any
+    // other thread pushes it on to that heap's remote free list, which
+    // its owner drains before going to the depot, so blocks made on one
+    // thread and destroyed on another flow back without a lock.
+    //
+    // a heap outlives its thread; its cached blocks are picked up again
+    // by the next thread to be given the same thread token.  block sets
+    // whose blocks are all back on the central free list can be given
+    // back with trim() or reclaim(); blocks cached by heaps are not.
+    template <typename blockT, size_t n_blocks>
+    class concurrent_block_allocator
+    {
+    private:
+        struct heap;
+        struct state;
+
+        struct block_t
+        {
+            typename std::aligned_storage
+                <sizeof(blockT), std::alignment_of<blockT>::value>::type
+                storage;
+
+            heap    *m_heap; // nullptr while free
+            block_t *next;
+        };
+
+        struct block_set
+        {
+            block_set *next;
+            block_t    m_blocks[n_blocks];
+
+            // blocks of the set on the central free list, whether the
+            // set was wholly free at the last reclaim(), and whether it
+            // is about to be freed.  only used under the central lock.
+            size_t n_central;
+            bool   b_idle;
+            bool   b_release;
+
+            block_set(): next(nullptr), n_central(0), b_idle(false), b_release(false) {}
+
+            FUNGUSUTIL_ALWAYS_INLINE inline bool holds(const block_t *p_b) const
+            {
+                return p_b >= m_blocks && p_b < m_blocks + n_blocks;
+            }
+        };
+
+        fungus_util_constexpr_assert(n_blocks > 0, n_blocks_check);
+
+        static constexpr size_t magazine_size = n_blocks >= 128 ? 64 : (n_blocks >= 2 ? n_blocks / 2 : 1);
+        static constexpr size_t depot_slots   = 16;
+        static constexpr size_t tls_ways      = 4;
+
+        struct magazine
+        {
+            size_t   n;
+            block_t *blocks[magazine_size];
+
+            magazine(): n(0) {}
+        };
+
+        struct heap
+        {
+            state      *parent;
+            const void *token;
+            heap       *next;
+
+            magazine *loaded;
+            magazine *spare;
+
+            // written by the owner only, read by count_alloced().
+            atomic<size_t> n_out;
+
+            char pad0[FUNGUSUTIL_CACHE_LINE_SIZE];
+
+            // pushed to by other threads, drained by the owner.
+            atomic<block_t *> remote;
+            atomic<size_t>    n_remote;
+
+            char pad1[FUNGUSUTIL_CACHE_LINE_SIZE];
+
+            heap(state *parent, const void *token):
+                parent(parent), token(token), next(nullptr),
+                loaded(new magazine()), spare(new magazine()),
+                n_out(0), remote(nullptr), n_remote(0)
+            {}
+
+            ~heap()
+            {
+                delete loaded;
+                delete spare;
+            }
+        };
+
+        struct state
+        {
+            const uint64_t id;
+
+            atomic<heap *> heaps;
+
+            atomic<magazine *> full[depot_slots];
+            atomic<magazine *> empty[depot_slots];
+
+            mutex      m;
+            block_t   *central;
+            block_set *sets;
+
+            atomic<size_t> n_block_sets;
+
+            state(uint64_t id):
+                id(id), heaps(nullptr), m(), central(nullptr), sets(nullptr), n_block_sets(0)
+            {}
+
+            ~state()
+            {
+                for (heap *h = heaps.load(); h != nullptr;)
+                {
+                    heap *next = h->next;
+                    delete h;
+                    h = next;
+                }
+
+                for (size_t i = 0; i < depot_slots; ++i)
+                {
+                    delete full[i].load();
+                    delete empty[i].load();
+                }
+
+                while (sets)
+                {
+                    block_set *next = sets->next;
+                    delete sets;
+                    sets = next;
+                }
+            }
+
+            // m must be held.
+            void expand()
+            {
+                block_set *m_set = new block_set();
+
+                for (size_t i = 0; i < n_blocks; ++i)
+                {
+                    m_set->m_blocks[i].m_heap = nullptr;
+                    m_set->m_blocks[i].next   = i + 1 < n_blocks ? m_set->m_blocks + i + 1 : central;
+                }
+
+                central = m_set->m_blocks;
+
+                m_set->next = sets;
+                sets = m_set;
+
+                n_block_sets.fetch_add(1, memory_order_relaxed);
+            }
+
+            // m must be held.  frees the sets whose blocks are all on
+            // the central list, or with only_idle, those that also were
+            // at the last call, and returns how many were freed.
+            size_t release_free_sets(bool only_idle)
+            {
+                if (!sets || !central)
+                {
+                    for (block_set *m_set = sets; m_set != nullptr; m_set = m_set->next)
+                        m_set->b_idle = false;
+
+                    return 0;
+                }
+
+                // sets sorted by address, so that each central block is
+                // matched to its set with a binary search.
+                std::vector<block_set *> sorted;
+                for (block_set *m_set = sets; m_set != nullptr; m_set = m_set->next)
+                {
+                    m_set->n_central = 0;
+                    sorted.push_back(m_set);
+                }
+
+                std::sort(sorted.begin(), sorted.end());
+
+                auto set_of = [&sorted](const block_t *p_b) -> block_set *
+                {
+                    auto it = std::upper_bound(sorted.begin(), sorted.end(), p_b,
+                                               [](const block_t *p, const block_set *m_set)
+                                               {return (const void *)p < (const void *)m_set;});
+
+                    return (it != sorted.begin() && (*--it)->holds(p_b)) ? *it : nullptr;
+                };
+
+                for (block_t *p_b = central; p_b != nullptr; p_b = p_b->next)
+                {
+                    block_set *m_set = set_of(p_b);
+                    if (m_set) ++m_set->n_central;
+                }
+
+                size_t n_released = 0;
+                for (block_set *m_set = sets; m_set != nullptr; m_set = m_set->next)
+                {
+                    bool b_free = m_set->n_central == n_blocks;
+
+                    m_set->b_release = b_free && (!only_idle || m_set->b_idle);
+                    m_set->b_idle    = b_free;
+
+                    if (m_set->b_release) ++n_released;
+                }
+
+                if (n_released == 0)
+                    return 0;
+
+                block_t **p_next = &central;
+                while (*p_next)
+                {
+                    block_set *m_set = set_of(*p_next);
+                    if (m_set && m_set->b_release)
+                        *p_next = (*p_next)->next;
+                    else
+                        p_next = &(*p_next)->next;
+                }
+
+                block_set **p_set = &sets;
+                while (*p_set)
+                {
+                    block_set *m_set = *p_set;
+                    if (m_set->b_release)
+                    {
+                        *p_set = m_set->next;
+                        delete m_set;
+                    }
+                    else
+                        p_set = &m_set->next;
+                }
+
+                n_block_sets.fetch_sub(n_released, memory_order_relaxed);
+
+                return n_released;
+            }
+        };
+
+        state *m_state;
+
+        struct tls_entry
+        {
+            uint64_t id;
+            heap    *m_heap;
+        };
+
+        FUNGUSUTIL_NO_ASSIGN(concurrent_block_allocator);
+
+        static inline uint64_t __next_id()
+        {
+            static atomic<uint64_t> next_id(1);
+            return next_id.fetch_add(1, memory_order_relaxed);
+        }
+
+        FUNGUSUTIL_ALWAYS_INLINE static inline block_t *get_from_p(void *p)
+        {
+            return static_cast<block_t *>(p);
+        }
+
+        FUNGUSUTIL_ALWAYS_INLINE inline heap *__local_heap()
+        {
+            static __thread tls_entry cache[tls_ways];
+
+            tls_entry &e = cache[m_state->id % tls_ways];
+            if (e.id != m_state->id)
+            {
+                e.m_heap = __find_heap();
+                e.id     = m_state->id;
+            }
+
+            return e.m_heap;
+        }
+
+        heap *__find_heap()
+        {
+            const void *token = __thread_token();
+
+            heap *top = m_state->heaps.load();
+            for (heap *h = top; h != nullptr; h = h->next)
+            {
+                if (h->token == token)
+                    return h;
+            }
+
+            // nobody else can be adding a heap with our token.
+            heap *h = new heap(m_state, token);
+            do h->next = top;
+            while (!m_state->heaps.compare_exchange(top, h));
+
+            return h;
+        }
+
+        static bool __depot_put(atomic<magazine *> *slots, magazine *mag)
+        {
+            for (size_t i = 0; i < depot_slots; ++i)
+            {
+                magazine *expected = nullptr;
+                if (slots[i].load(memory_order_relaxed) == nullptr &&
+                    slots[i].compare_exchange(expected, mag))
+                    return true;
+            }
+
+            return false;
+        }
+
+        static magazine *__depot_take(atomic<magazine *> *slots)
+        {
+            for (size_t i = 0; i < depot_slots; ++i)
+            {
+                if (slots[i].load(memory_order_relaxed) != nullptr)
+                {
+                    magazine *mag = slots[i].exchange(nullptr);
+                    if (mag) return mag;
+                }
+            }
+
+            return nullptr;
+        }
+
+        void __to_central(block_t *first, block_t *last)
+        {
+            lock guard(m_state->m);
+
+            last->next = m_state->central;
+            m_state->central = first;
+        }
+
+        void __drain_remote(heap *h)
+        {
+            block_t *b = h->remote.exchange(nullptr);
+            if (!b) return;
+
+            size_t n = 0;
+            while (b)
+            {
+                block_t *next = b->next;
+
+                magazine *mag = h->loaded->n < magazine_size ? h->loaded :
+                                h->spare->n  < magazine_size ? h->spare  : nullptr;
+                if (!mag)
+                {
+                    block_t *last = b;
+                    for (++n; last->next; last = last->next) ++n;
+
+                    __to_central(b, last);
+                    break;
+                }
+
+                mag->blocks[mag->n++] = b;
+                b = next;
+                ++n;
+            }
+
+            h->n_out.store(h->n_out.load(memory_order_relaxed) - n, memory_order_relaxed);
+            h->n_remote.fetch_sub(n, memory_order_relaxed);
+        }
+
+        // moves the full magazines in the depot on to the central list,
+        // so that their blocks count towards freeing a set.
+        void __depot_to_central()
+        {
+            magazine *mag;
+            while ((mag = __depot_take(m_state->full)))
+            {
+                for (size_t i = 0; i + 1 < mag->n; ++i)
+                    mag->blocks[i]->next = mag->blocks[i + 1];
+
+                if (mag->n > 0)
+                    __to_central(mag->blocks[0], mag->blocks[mag->n - 1]);
+
+                mag->n = 0;
+                if (!__depot_put(m_state->empty, mag))
+                    delete mag;
+            }
+        }
+
+        size_t __release(bool only_idle)
+        {
+            __depot_to_central();
+
+            lock guard(m_state->m);
+            return m_state->release_free_sets(only_idle) * sizeof(block_set);
+        }
+
+        // the loaded magazine is empty.
+        void __refill(heap *h)
+        {
+            if (h->spare->n > 0)
+            {
+                std::swap(h->loaded, h->spare);
+                return;
+            }
+
+            __drain_remote(h);
+            if (h->loaded->n > 0)
+                return;
+
+            magazine *mag = __depot_take(m_state->full);
+            if (mag)
+            {
+                if (!__depot_put(m_state->empty, h->loaded))
+                    delete h->loaded;
+
+                h->loaded = mag;
+                return;
+            }
+
+            lock guard(m_state->m);
+
+            mag = h->loaded;
+            while (mag->n < magazine_size)
+            {
+                if (!m_state->central)
+                    m_state->expand();
+
+                mag->blocks[mag->n++] = m_state->central;
+                m_state->central = m_state->central->next;
+            }
+        }
+
+        // the loaded magazine is full.
+        void __flush(heap *h)
+        {
+            if (h->spare->n == 0)
+            {
+                std::swap(h->loaded, h->spare);
+                return;
+            }
+
+            magazine *mag = h->loaded;
+            if (__depot_put(m_state->full, mag))
+            {
+                mag = __depot_take(m_state->empty);
+                h->loaded = mag ? mag : new magazine();
+                return;
+            }
+
+            for (size_t i = 0; i + 1 < mag->n; ++i)
+                mag->blocks[i]->next = mag->blocks[i + 1];
+
+            __to_central(mag->blocks[0], mag->blocks[mag->n - 1]);
+            mag->n = 0;
+        }
+    public:
+        FUNGUSUTIL_ALWAYS_INLINE inline concurrent_block_allocator(concurrent_block_allocator &&m_block_allocator):
+            m_state(m_block_allocator.m_state)
+        {
+            m_block_allocator.m_state = nullptr;
+        }
+
+        inline concurrent_block_allocator(size_t n_block_sets = 1):
+            m_state(new state(__next_id()))
+        {
+            lock guard(m_state->m);
+
+            for (size_t i = 0; i < (n_block_sets == 0 ? 1 : n_block_sets); ++i)
+                m_state->expand();
+        }
+
+        // blocks still alive are released without being destroyed, as
+        // block_allocator does.  no other thread may be using it.
+        inline ~concurrent_block_allocator()
+        {
+            delete m_state;
+        }
+
+        FUNGUSUTIL_ALWAYS_INLINE inline size_t count_block_sets() const {return m_state->n_block_sets.load(memory_order_relaxed);}
+        FUNGUSUTIL_ALWAYS_INLINE inline size_t count_blocks()     const {return count_block_sets() * n_blocks;}
+
+        // only a snapshot while other threads are using the allocator.
+        inline size_t count_alloced() const
+        {
+            size_t n_out = 0, n_remote = 0;
+            for (heap *h = m_state->heaps.load(); h != nullptr; h = h->next)
+            {
+                n_out    += h->n_out.load(memory_order_relaxed);
+                n_remote += h->n_remote.load(memory_order_relaxed);
+            }
+
+            return n_out > n_remote ? n_out - n_remote : 0;
+        }
+
+        // frees every block set whose blocks are all free and not cached
+        // by a heap.  the central list grows again as needed.  may be
+        // called from any thread.  returns the number of bytes freed.
+        inline size_t trim()
+        {
+            return m_state ? __release(false) : 0;
+        }
+
+        // frees the block sets that were wholly free at the last call as
+        // well, so that sets taken for a spike drain away without being
+        // freed just before they are needed again.  meant to be called
+        // periodically, from any thread.  returns the number of bytes freed.
+        inline size_t reclaim()
+        {
+            return m_state ? __release(true) : 0;
+        }
+
+        template <typename... argT>
+        FUNGUSUTIL_ALWAYS_INLINE inline blockT *create(argT&&... argV)
+        {
+            fungus_util_assert(m_state, "fungus_concurrency::concurrent_block_allocator::create(): this instance has been moved!");
+
+            heap *h = __local_heap();
+            if (h->loaded->n == 0)
+                __refill(h);
+
+            block_t *p_b = h->loaded->blocks[--h->loaded->n];
+            p_b->m_heap = h;
+
+            h->n_out.store(h->n_out.load(memory_order_relaxed) + 1, memory_order_relaxed);
+
+            return new(&p_b->storage) blockT(std::forward<argT>(argV)...);
+        }
+
+        FUNGUSUTIL_ALWAYS_INLINE inline bool destroy(blockT *b)
+        {
+            fungus_util_assert(m_state, "fungus_concurrency::concurrent_block_allocator::destroy(): this instance has been moved!");
+
+            block_t *p_b = get_from_p(b);
+            heap    *h   = p_b->m_heap;
+
+            if (!h || h->parent != m_state)
+                return false;
+
+            b->~blockT();
+            p_b->m_heap = nullptr;
+
+            if (h->token == __thread_token())
+            {
+                if (h->loaded->n == magazine_size)
+                    __flush(h);
+
+                h->loaded->blocks[h->loaded->n++] = p_b;
+                h->n_out.store(h->n_out.load(memory_order_relaxed) - 1, memory_order_relaxed);
+            }
+            else
+            {
+                // counted first, so that n_remote never drops below
+                // the number of blocks the owner has drained.
+                h->n_remote.fetch_add(1, memory_order_relaxed);
+
+                block_t *top = h->remote.load(memory_order_relaxed);
+                do p_b->next = top;
+                while (!h->remote.compare_exchange(top, p_b, memory_order_release));
+            }
+
+            return true;
+        }
+    };
+#else
+    template <typename blockT, size_t n_blocks>
+    class concurrent_block_allocator
+    {
+    private:
+        bool           b_moved;
+        atomic<size_t> n_alloced;
+
+        FUNGUSUTIL_NO_ASSIGN(concurrent_block_allocator);
+    public:
+        FUNGUSUTIL_ALWAYS_INLINE inline concurrent_block_allocator(concurrent_block_allocator &&m_block_allocator):
+            b_moved(false), n_alloced(m_block_allocator.n_alloced.load())
+        {
+            m_block_allocator.b_moved = true;
+        }
+
+        FUNGUSUTIL_ALWAYS_INLINE inline concurrent_block_allocator(size_t n_block_sets = 1):
+            b_moved(false), n_alloced(0)
+        {}
+
+        FUNGUSUTIL_ALWAYS_INLINE inline ~concurrent_block_allocator()
+        {}
+
+        FUNGUSUTIL_ALWAYS_INLINE inline size_t count_block_sets() const {return 1;}
+        FUNGUSUTIL_ALWAYS_INLINE inline size_t count_blocks()     const {return UINT32_MAX;}
+        FUNGUSUTIL_ALWAYS_INLINE inline size_t count_alloced()    const {return n_alloced.load(memory_order_relaxed);}
+
+        FUNGUSUTIL_ALWAYS_INLINE inline size_t trim()    {return 0;}
+        FUNGUSUTIL_ALWAYS_INLINE inline size_t reclaim() {return 0;}
+
+        template <typename... argT>
+        FUNGUSUTIL_ALWAYS_INLINE inline blockT *create(argT&&... argV)
+        {
+            fungus_util_assert(!b_moved, "fungus_concurrency::concurrent_block_allocator::create(): this instance has been moved!");
+
+            blockT *b = new(std::nothrow) blockT(std::forward<argT>(argV)...);
+            if (b)
+                n_alloced.fetch_add(1, memory_order_relaxed);
+
+            return b;
+        }
+
+        FUNGUSUTIL_ALWAYS_INLINE inline bool destroy(blockT *b)
+        {
+            fungus_util_assert(!b_moved, "fungus_concurrency::concurrent_block_allocator::destroy(): this instance has been moved!");
+
+            delete b;
+            n_alloced.fetch_sub(1, memory_order_relaxed);
+
+            return true;
+        }
+    };
+#endif
+}
+
+#endif
@@ -4,6 +4,7 @@
 #include "fungus_concurrency_communication.h"
 #include "fungus_concurrency_concurrent_auto_ptr.h"
 #include "fungus_concurrency_concurrent_queue.h"
+#include "fungus_concurrency_ring_buffer.h"
 #include <queue>
 
 namespace fungus_concurrency
@@ -22,8 +23,15 @@ namespace fungus_concurrency
             FUNGUSCONCURRENCY_INLINE void operator()(messageT m_message) {delete m_message;}
         };
 
+        // message_queueT is the queue each channel receives on.  the
+        // default, concurrent_queue, is unbounded.  every channel queue has
+        // exactly one producer (the channel at the other end) and one
+        // consumer, so spsc_ring may be used instead; then a channel whose
+        // peer's ring is full keeps the rest of its messages back until a
+        // later dispatch() finds room, and a close waits behind them.
         template <typename messageT,
-                  typename discard_functorT = default_discard_functor<messageT> >
+                  typename discard_functorT = default_discard_functor<messageT>,
+                  template <typename> class message_queueT = concurrent_queue>
         class comm_tplt
         {
         public:
@@ -78,7 +86,7 @@ namespace fungus_concurrency
                 virtual message_wrap_type get_type() const {return message_wrap::type_close_message;}
             };
 
-            typedef concurrent_queue<message_wrap *>   message_queue;
+            typedef message_queueT<message_wrap *>     message_queue;
             typedef concurrent_auto_ptr<message_queue> message_queue_ptr;
 
             class command
@@ -130,6 +138,10 @@ namespace fungus_concurrency
                     const size_t cmd_io_nslots;
                     slot *slots;
 
+                    // signalled whenever a command or a message is
+                    // pushed to the comm that owns this io.
+                    notifier activity;
+
                     io(const size_t cmd_io_nslots): cmd_io_nslots(cmd_io_nslots)
                     {
                         slots = new slot[cmd_io_nslots];
@@ -146,6 +158,8 @@ namespace fungus_concurrency
                         for (size_t i = 0; searching; i = (i + 1) % cmd_io_nslots)
                             searching = !slots[i].put(ncmd);
 
+                        activity.notify();
+
                         //stdlib_bits::locked_cout << stdlib_bits::lock_o << "put command" << stdlib_bits::unlock_o;
                     }
 
@@ -166,6 +180,19 @@ namespace fungus_concurrency
 
                         return success;
                     }
+
+                    bool empty()
+                    {
+                        bool success = true;
+                        for (size_t i = 0; i < cmd_io_nslots && success; ++i)
+                        {
+                            slots[i].m.lock();
+                            success = (slots[i].cmd == nullptr);
+                            slots[i].m.unlock();
+                        }
+
+                        return success;
+                    }
                 };
 
                 typedef concurrent_auto_ptr<io> io_ptr;
@@ -200,25 +227,28 @@ namespace fungus_concurrency
             public:
                 discard_functorT discard;
                 message_queue_ptr    out_m_message, in_m_message;
+                cmd_io_ptr           out_io;
                 std::queue<messageT> wait_out;
 
-                bool      is_stub, closed, allow_timeout;
-                int       closed_data;
-                timestamp timeout_start;
+                bool            is_stub, closed, closing, allow_timeout;
+                bool            unflushed; // sent to since the last flush()
+                int             closed_data;
+                nsec_duration_t timeout_start;
 
             private:
                 channel(discard_functorT discard): discard(discard),
-                    is_stub(true), closed(false), allow_timeout(true),
-                    timeout_start(timestamp::current_time)
+                    is_stub(true), closed(false), closing(false), allow_timeout(true),
+                    unflushed(false), timeout_start(monotonic_clock::read())
                 {
                     out_m_message = nullptr;
+                    out_io        = nullptr;
                     in_m_message  = new message_queue();
                 }
 
-                channel(message_queue_ptr out_m_message, discard_functorT discard):
-                    discard(discard), out_m_message(out_m_message),
-                    is_stub(false), closed(false), allow_timeout(false),
-                    timeout_start(timestamp::zero_time)
+                channel(message_queue_ptr out_m_message, cmd_io_ptr out_io, discard_functorT discard):
+                    discard(discard), out_m_message(out_m_message), out_io(out_io),
+                    is_stub(false), closed(false), closing(false), allow_timeout(false),
+                    unflushed(false), timeout_start(0)
                 {
                     in_m_message  = new message_queue();
                 }
@@ -227,6 +257,20 @@ namespace fungus_concurrency
                 {
                     if (!closed) close(-1);
 
+                    // the other end is gone with us; drop what could not be
+                    // sent.  the close message always fits, because user
+                    // messages never take the last slot.
+                    if (closing)
+                    {
+                        while (!wait_out.empty())
+                        {
+                            discard(wait_out.front());
+                            wait_out.pop();
+                        }
+
+                        flush();
+                    }
+
                     message_wrap *wrap;
                     while (in_m_message->pop(wrap))
                         delete wrap;
@@ -234,33 +278,26 @@ namespace fungus_concurrency
 
                 friend class fungus_util::block_allocator<channel, 32>;
             public:
-                FUNGUSCONCURRENCY_INLINE bool is_timed_out(const sec_duration_t &timeout_period) const
+                FUNGUSCONCURRENCY_INLINE bool is_timed_out(nsec_duration_t now, nsec_duration_t timeout_period) const
                 {
-                    if (allow_timeout)
-                    {
-                        sec_duration_t dur = usec_duration_to_sec
-                            (timestamp(timestamp::current_time) - timeout_start);
-
-                        if (dur >= timeout_period)
-                            return true;
-                    }
-
-                    return false;
+                    return allow_timeout && now - timeout_start >= timeout_period;
                 }
 
-                FUNGUSCONCURRENCY_INLINE void reset_timeout() const
+                FUNGUSCONCURRENCY_INLINE void reset_timeout()
                 {
-                    timeout_start = timestamp::current_time;
+                    timeout_start = monotonic_clock::read();
                 }
 
-                FUNGUSCONCURRENCY_INLINE void open(message_queue_ptr out_m_message)
+                FUNGUSCONCURRENCY_INLINE void open(message_queue_ptr out_m_message, cmd_io_ptr out_io)
                 {
                     this->out_m_message = out_m_message;
+                    this->out_io        = out_io;
 
                     is_stub       = false;
                     allow_timeout = false;
                     closed        = false;
-                    timeout_start = timestamp::zero_time;
+                    closing       = false;
+                    timeout_start = 0;
                 }
 
                 FUNGUSCONCURRENCY_INLINE bool receive(messageT &m_message)
@@ -285,6 +322,7 @@ namespace fungus_concurrency
 
                                 is_stub     = true;
                                 closed      = true;
+                                closing     = false;
                                 closed_data = close_message->data;
 
                                 success     = false;
@@ -317,24 +355,32 @@ namespace fungus_concurrency
                 FUNGUSCONCURRENCY_INLINE void send(const messageT &m_message)
                 {
                     wait_out.push(m_message);
+                    unflushed = true;
                 }
 
+                // if the other end's queue is too full to take everything
+                // still waiting to go out, the close message is held back
+                // until flush() gets it through.
                 FUNGUSCONCURRENCY_INLINE void close(int data)
                 {
-                    flush();
-                    if (!is_stub)
+                    closed_data = data;
+
+                    if (is_stub)
                     {
-                        message_wrap *wrap = new close_message_wrap(data);
-                        out_m_message->push(wrap);
+                        closed = true;
+                        flush();
+                    }
+                    else
+                    {
+                        closing = true;
+                        flush();
                     }
-
-                    is_stub     = true;
-                    closed      = true;
-                    closed_data = data;
                 }
 
                 FUNGUSCONCURRENCY_INLINE void flush()
                 {
+                    unflushed = false;
+
                     if (is_stub)
                     {
                         while (!wait_out.empty())
@@ -345,22 +391,52 @@ namespace fungus_concurrency
                     }
                     else
                     {
+                        bool pushed = false;
+
                         while (!wait_out.empty())
                         {
-                            message_wrap *wrap = new user_message_wrap(wait_out.front(), discard);
-                            out_m_message->push(wrap);
+                            // the last slot is kept back for the close message.
+                            user_message_wrap *wrap = new user_message_wrap(wait_out.front(), discard);
+                            if (!out_m_message->push(wrap, 1))
+                            {
+                                wrap->received = true;
+                                delete wrap;
+                                break;
+                            }
 
                             wait_out.pop();
+                            pushed = true;
                         }
+
+                        if (closing && wait_out.empty())
+                        {
+                            out_m_message->push(new close_message_wrap(closed_data));
+                            pushed = true;
+
+                            is_stub = true;
+                            closed  = true;
+                            closing = false;
+                        }
+
+                        // one wakeup per flush, not per message.
+                        if (pushed)
+                            out_io->activity.notify();
                     }
                 }
+
+                // true if dispatch() has something to do for this channel
+                // right now, without anything else arriving first.
+                FUNGUSCONCURRENCY_INLINE bool has_activity() const
+                {
+                    return closed || (!is_stub && !in_m_message->empty());
+                }
             };
 
             typedef block_allocator_object_hash<channel_id, channel,
                     fungus_util::block_allocator<channel, 32>> channel_hash;
 
-            typedef          fungus_util::hash_map<channel_hash>        channel_map;
-            typedef typename fungus_util::hash_map<channel_hash>::entry channel_map_entry;
+            typedef          fungus_util::flat_hash_map<channel_hash>        channel_map;
+            typedef typename fungus_util::flat_hash_map<channel_hash>::entry channel_map_entry;
 
             fungus_util::block_allocator<channel, 32> m_channel_allocator;
 
@@ -375,7 +451,7 @@ namespace fungus_concurrency
             std::queue<channel_id> available_channel_ids;
             channel_id             channel_id_ctr;
 
-            sec_duration_t         timeout_period;
+            nsec_duration_t        timeout_period;
             size_t                 max_channels;
 
             discard_functorT       discard;
@@ -417,13 +493,13 @@ namespace fungus_concurrency
                 if (chans.size() < max_channels)
                 {
                     channel_id nchan_id = alloc_channel_id();
-                    channel *nchan = m_channel_allocator.create(cmd->q, discard);
+                    channel *nchan = m_channel_allocator.create(cmd->q, cmd->iop, discard);
                     chans.insert(channel_map_entry(nchan_id, nchan));
 
                     command *ncmd = new command
                     (
                         command::appr_channel,
-                        nchan->in_m_message, nullptr,
+                        nchan->in_m_message, cmd_io_ap,
                         id, data
                     );
                     comm_tplt_cmd_io_p->put(ncmd);
@@ -451,7 +527,7 @@ namespace fungus_concurrency
                 if (it != chans.end())
                 {
                     channel *chan = it->value;
-                    chan->open(cmd->q);
+                    chan->open(cmd->q, cmd->iop);
                     events.push(event(event::channel_open, id, data));
                 }
             }
@@ -493,6 +569,9 @@ namespace fungus_concurrency
                 // queue to delete dead channels
                 std::queue<std::pair<channel_id, channel *>> dead_chans;
 
+                // one clock reading for every channel
+                nsec_duration_t now = monotonic_clock::now();
+
                 // go through all channels
                 for (auto it: chans)
                 {
@@ -507,7 +586,7 @@ namespace fungus_concurrency
                         events.push(event(event::channel_clos, id, chan->closed_data));
                         dead_chans.push(std::pair<channel_id, channel *>(id, chan));
                     }
-                    else if (chan->is_timed_out(timeout_period))
+                    else if (chan->is_timed_out(now, timeout_period))
                     {
                         events.push(event(event::channel_lost, id, 0));
                         dead_chans.push(std::pair<channel_id, channel *>(id, chan));
@@ -530,6 +609,15 @@ namespace fungus_concurrency
                 for (auto it: chans)
                     it.value->flush();
             }
+
+            // how long to sleep before trying again to flush a channel whose
+            // other end is full.  nothing signals us when it makes room.
+            static constexpr nsec_duration_t blocked_retry_period = 1000000;
+
+            static FUNGUSCONCURRENCY_INLINE nsec_duration_t __min_timeout(nsec_duration_t timeout, nsec_duration_t t)
+            {
+                return (timeout < 0 || t < timeout) ? t : timeout;
+            }
         public:
             comm_tplt(size_t max_channels, size_t cmd_io_nslots, sec_duration_t timeout_period, discard_functorT discard = discard_functorT()):
                 m_channel_allocator(max_channels / 32 + 1),
@@ -538,7 +626,7 @@ namespace fungus_concurrency
                 recycled_channel_ids(),
                 available_channel_ids(),
                 channel_id_ctr(0),
-                timeout_period(timeout_period),
+                timeout_period(sec_duration_to_nsec(timeout_period)),
                 max_channels(max_channels),
                 discard(discard)
             {
@@ -588,8 +676,8 @@ namespace fungus_concurrency
 
                 channel *chan = it->value;
 
-                if (!chan)        return false;
-                if (chan->closed) return false;
+                if (!chan)                         return false;
+                if (chan->closed || chan->closing) return false;
 
                 chan->close(data);
                 return true;
@@ -601,7 +689,7 @@ namespace fungus_concurrency
                 {
                     channel *chan = it.value;
 
-                    if (!chan->closed)
+                    if (!chan->closed && !chan->closing)
                         chan->close(data);
                 }
             }
@@ -627,8 +715,8 @@ namespace fungus_concurrency
 
                 channel *chan = it->value;
 
-                if (!chan)        return false;
-                if (chan->closed) return false;
+                if (!chan)                         return false;
+                if (chan->closed || chan->closing) return false;
 
                 chan->send(m_message);
                 return true;
@@ -702,6 +790,11 @@ namespace fungus_concurrency
 
             FUNGUSCONCURRENCY_INLINE void dispatch()
             {
+                // cleanup() times channels out against now(), and
+                // has_activity() against read(), so the two must agree
+                // however we are dispatched.
+                monotonic_clock::update();
+
                 while (!waiting_events.empty())
                 {
                     events.push(waiting_events.front());
@@ -718,6 +811,55 @@ namespace fungus_concurrency
                 this_thread::yield();
             }
 
+            // true if dispatch() or channel_receive() has something to do
+            // now.  otherwise lowers timeout (negative is none) to when
+            // they next will, short of being notified.
+            FUNGUSCONCURRENCY_INLINE bool has_activity(nsec_duration_t &timeout)
+            {
+                // events already handed out by dispatch() are not counted;
+                // they are waiting on get_event(), not on us.
+                if (!waiting_events.empty() || !cmd_io_p->empty())
+                    return true;
+
+                nsec_duration_t now = monotonic_clock::read();
+                for (auto it: chans)
+                {
+                    channel *chan = it.value;
+
+                    if (chan->has_activity() || chan->unflushed || chan->is_timed_out(now, timeout_period))
+                        return true;
+
+                    if (chan->allow_timeout)
+                        timeout = __min_timeout(timeout, chan->timeout_start + timeout_period - now);
+
+                    if (!chan->wait_out.empty())
+                        timeout = __min_timeout(timeout, blocked_retry_period);
+                }
+
+                return false;
+            }
+
+            // notified whenever has_activity() may have become true.
+            FUNGUSCONCURRENCY_INLINE notifier &get_activity_notifier()
+            {
+                return cmd_io_p->activity;
+            }
+
+            // sleeps until dispatch() or channel_receive() would have
+            // something to do, or until timeout nanoseconds have passed
+            // (negative waits forever).  returns false on timeout.
+            FUNGUSCONCURRENCY_INLINE bool wait_for_activity(nsec_duration_t timeout)
+            {
+                // read the epoch before looking, so anything pushed after
+                // we look still wakes us.
+                int epoch = cmd_io_p->activity.get_epoch();
+
+                if (has_activity(timeout))
+                    return true;
+
+                return cmd_io_p->activity.wait(epoch, timeout);
+            }
+
             FUNGUSCONCURRENCY_INLINE bool peek_event(event &event) const
             {
                 if (!events.empty())
@@ -776,6 +918,11 @@ namespace fungus_concurrency
         FUNGUSCONCURRENCY_INLINE bool       channel_discard_all(channel_id id)                {return impl_.channel_discard_all(id);}
         FUNGUSCONCURRENCY_INLINE void       all_channels_discard_all()                        {return impl_.all_channels_discard_all();}
         FUNGUSCONCURRENCY_INLINE void       dispatch()                                        {       impl_.dispatch();}
+        FUNGUSCONCURRENCY_INLINE bool       wait_for_activity(sec_duration_t timeout)
+        {
+            return impl_.wait_for_activity(timeout < 0 ? -1 : sec_duration_to_nsec(timeout));
+        }
+        FUNGUSCONCURRENCY_INLINE bool       wait_for_activity_nsec(nsec_duration_t timeout)  {return impl_.wait_for_activity(timeout);}
         FUNGUSCONCURRENCY_INLINE bool       peek_event(event &event) const                    {return impl_.peek_event(event);}
         FUNGUSCONCURRENCY_INLINE bool       get_event(event &event)                           {return impl_.get_event(event);}
         FUNGUSCONCURRENCY_INLINE void       clear_events()                                    {       impl_.clear_events();}
@@ -62,6 +62,14 @@ namespace fungus_concurrency
         bool       channel_discard_all(channel_id id);
         void       all_channels_discard_all();
         void       dispatch();
+
+        // sleeps until there are commands or messages for dispatch() and
+        // channel_receive() to handle, or until timeout seconds have
+        // passed (nanoseconds for wait_for_activity_nsec(); negative
+        // waits forever).  returns false on timeout.
+        bool       wait_for_activity(sec_duration_t timeout = -1);
+        bool       wait_for_activity_nsec(nsec_duration_t timeout);
+
         bool       peek_event(event &event) const;
         bool       get_event(event &event);
         void       clear_events();
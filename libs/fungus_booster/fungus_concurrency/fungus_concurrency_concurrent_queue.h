@@ -80,7 +80,9 @@ namespace fungus_concurrency
             }
         }
 
-        FUNGUSCONCURRENCY_INLINE void push(const T &v)
+        // unbounded, so push() always succeeds; reserve exists only to
+        // match the interface of the bounded rings.
+        FUNGUSCONCURRENCY_INLINE bool push(const T &v, size_t reserve = 0)
         {
             lock guard(producer_lock);
 
@@ -88,6 +90,8 @@ namespace fungus_concurrency
 
             last->set_next(n);
             last = n;
+
+            return true;
         }
 
         FUNGUSCONCURRENCY_INLINE bool pop_if_open(T &v)
@@ -103,6 +107,13 @@ namespace fungus_concurrency
             consumer_lock.lock();
             return __pop(v);
         }
+
+        // only a snapshot if a producer is running.
+        FUNGUSCONCURRENCY_INLINE bool empty() const
+        {
+            lock guard(consumer_lock);
+            return first->get_next() == nullptr;
+        }
     };
 }
 
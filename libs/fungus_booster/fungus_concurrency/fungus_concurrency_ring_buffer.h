@@ -0,0 +1,338 @@
+#ifndef FUNGUSCONCURRENCY_RING_BUFFER_H
+#define FUNGUSCONCURRENCY_RING_BUFFER_H
+
+#include "fungus_concurrency_common.h"
+
+namespace fungus_concurrency
+{
+    using namespace fungus_util;
+
+    constexpr size_t default_ring_capacity = 1024;
+
+    FUNGUSCONCURRENCY_INLINE size_t __ring_capacity(size_t capacity)
+    {
+        size_t n = 2;
+        while (n < capacity) n <<= 1;
+
+        return n;
+    }
+
+    // bounded lock-free queues.  both share the interface of
+    // concurrent_queue, except that push() fails when the ring is full.
+    // push() and push_n() take a reserve count: they refuse to fill the
+    // last reserve slots, which lets a producer hold space back for
+    // something that must always get through.
+
+    // single producer, single consumer.  each side owns one index and
+    // keeps a cached copy of the other side's index, so it only touches
+    // the other side's cache line when the cached copy says the ring
+    // is full (or empty).
+    template <typename T>
+    class spsc_ring
+    {
+    private:
+        const size_t capacity;
+        const size_t mask;
+        T           *slots;
+
+        char pad0[FUNGUSUTIL_CACHE_LINE_SIZE];
+
+        // consumer side
+        atomic<size_t> head;
+        size_t         tail_cache;
+
+        char pad1[FUNGUSUTIL_CACHE_LINE_SIZE];
+
+        // producer side
+        atomic<size_t> tail;
+        size_t         head_cache;
+
+        char pad2[FUNGUSUTIL_CACHE_LINE_SIZE];
+
+        FUNGUSCONCURRENCY_INLINE size_t __free_slots(size_t t, size_t need)
+        {
+            size_t n_free = capacity - (t - head_cache);
+            if (n_free < need)
+            {
+                head_cache = head.load(memory_order_acquire);
+                n_free     = capacity - (t - head_cache);
+            }
+
+            return n_free;
+        }
+
+        FUNGUSCONCURRENCY_INLINE size_t __used_slots(size_t h, size_t need)
+        {
+            size_t n_used = tail_cache - h;
+            if (n_used < need)
+            {
+                tail_cache = tail.load(memory_order_acquire);
+                n_used     = tail_cache - h;
+            }
+
+            return n_used;
+        }
+
+        FUNGUSUTIL_NO_ASSIGN(spsc_ring)
+    public:
+        spsc_ring(size_t capacity = default_ring_capacity):
+            capacity(__ring_capacity(capacity)), mask(__ring_capacity(capacity) - 1), slots(nullptr),
+            head(0), tail_cache(0), tail(0), head_cache(0)
+        {
+            slots = new T[this->capacity];
+        }
+
+        ~spsc_ring()
+        {
+            delete[] slots;
+        }
+
+        FUNGUSCONCURRENCY_INLINE bool push(const T &v, size_t reserve = 0)
+        {
+            size_t t = tail.load(memory_order_relaxed);
+            if (__free_slots(t, reserve + 1) < reserve + 1)
+                return false;
+
+            slots[t & mask] = v;
+            tail.store(t + 1, memory_order_release);
+
+            return true;
+        }
+
+        // pushes as many of v[0..n) as fit, publishing them all at once.
+        FUNGUSCONCURRENCY_INLINE size_t push_n(const T *v, size_t n, size_t reserve = 0)
+        {
+            size_t t      = tail.load(memory_order_relaxed);
+            size_t n_free = __free_slots(t, n + reserve);
+
+            if (n_free <= reserve) return 0;
+            if (n > n_free - reserve) n = n_free - reserve;
+
+            for (size_t i = 0; i < n; ++i)
+                slots[(t + i) & mask] = v[i];
+
+            tail.store(t + n, memory_order_release);
+            return n;
+        }
+
+        FUNGUSCONCURRENCY_INLINE bool pop(T &v)
+        {
+            size_t h = head.load(memory_order_relaxed);
+            if (__used_slots(h, 1) == 0)
+                return false;
+
+            v = slots[h & mask];
+            head.store(h + 1, memory_order_release);
+
+            return true;
+        }
+
+        FUNGUSCONCURRENCY_INLINE bool pop_if_open(T &v)
+        {
+            return pop(v);
+        }
+
+        // pops up to n entries into v, releasing their slots all at once.
+        FUNGUSCONCURRENCY_INLINE size_t pop_n(T *v, size_t n)
+        {
+            size_t h      = head.load(memory_order_relaxed);
+            size_t n_used = __used_slots(h, n);
+
+            if (n > n_used) n = n_used;
+
+            for (size_t i = 0; i < n; ++i)
+                v[i] = slots[(h + i) & mask];
+
+            head.store(h + n, memory_order_release);
+            return n;
+        }
+
+        FUNGUSCONCURRENCY_INLINE bool empty() const
+        {
+            return head.load() == tail.load();
+        }
+
+        // only a snapshot if the other side is running.
+        FUNGUSCONCURRENCY_INLINE size_t size() const
+        {
+            return tail.load() - head.load();
+        }
+
+        FUNGUSCONCURRENCY_INLINE size_t get_capacity() const
+        {
+            return capacity;
+        }
+    };
+
+    // multiple producers, single consumer.  every slot carries a sequence
+    // number; producers claim slots by advancing tail with a CAS and then
+    // publish each by bumping its sequence, so the consumer never sees a
+    // slot that is still being written.  push_n() claims its whole run
+    // with one CAS, against the head the consumer last published.
+    template <typename T>
+    class mpsc_ring
+    {
+    private:
+        struct cell
+        {
+            atomic<size_t> seq;
+            T              v;
+        };
+
+        const size_t capacity;
+        const size_t mask;
+        cell        *cells;
+
+        char pad0[FUNGUSUTIL_CACHE_LINE_SIZE];
+
+        // producer side
+        atomic<size_t> tail;
+
+        char pad1[FUNGUSUTIL_CACHE_LINE_SIZE];
+
+        // consumer side; published so producers can honour their reserve.
+        atomic<size_t> head;
+
+        char pad2[FUNGUSUTIL_CACHE_LINE_SIZE];
+
+        FUNGUSUTIL_NO_ASSIGN(mpsc_ring)
+    public:
+        mpsc_ring(size_t capacity = default_ring_capacity):
+            capacity(__ring_capacity(capacity)), mask(__ring_capacity(capacity) - 1), cells(nullptr),
+            tail(0), head(0)
+        {
+            cells = new cell[this->capacity];
+            for (size_t i = 0; i < this->capacity; ++i)
+                cells[i].seq.store(i, memory_order_relaxed);
+        }
+
+        ~mpsc_ring()
+        {
+            delete[] cells;
+        }
+
+        FUNGUSCONCURRENCY_INLINE bool push(const T &v, size_t reserve = 0)
+        {
+            size_t t = tail.load(memory_order_relaxed);
+            cell *c;
+
+            for (;;)
+            {
+                c = &cells[t & mask];
+
+                size_t    seq = c->seq.load(memory_order_acquire);
+                ptrdiff_t dif = (ptrdiff_t)seq - (ptrdiff_t)t;
+
+                if (dif == 0)
+                {
+                    if (reserve > 0 && t - head.load(memory_order_acquire) + reserve >= capacity)
+                        return false;
+
+                    if (tail.compare_exchange(t, t + 1, memory_order_relaxed))
+                        break;
+                }
+                else if (dif < 0)
+                    return false;
+                else
+                    t = tail.load(memory_order_relaxed);
+            }
+
+            c->v = v;
+            c->seq.store(t + 1, memory_order_release);
+
+            return true;
+        }
+
+        FUNGUSCONCURRENCY_INLINE size_t push_n(const T *v, size_t n, size_t reserve = 0)
+        {
+            size_t t;
+
+            for (;;)
+            {
+                // head first, so the tail read after it is never behind it.
+                size_t h = head.load(memory_order_acquire);
+                t = tail.load(memory_order_relaxed);
+
+                // every slot below head + capacity has been given back.
+                // push() goes by the slots' sequences instead, so it may
+                // already have claimed a slot pop() freed before moving head.
+                size_t n_used = t - h;
+                if (n_used + reserve >= capacity) return 0;
+
+                size_t n_free  = capacity - n_used - reserve;
+                size_t n_claim = n < n_free ? n : n_free;
+                if (tail.compare_exchange(t, t + n_claim, memory_order_relaxed))
+                {
+                    n = n_claim;
+                    break;
+                }
+            }
+
+            for (size_t i = 0; i < n; ++i)
+            {
+                cell &c = cells[(t + i) & mask];
+
+                c.v = v[i];
+                c.seq.store(t + i + 1, memory_order_release);
+            }
+
+            return n;
+        }
+
+        FUNGUSCONCURRENCY_INLINE bool pop(T &v)
+        {
+            size_t h = head.load(memory_order_relaxed);
+            cell  &c = cells[h & mask];
+
+            if ((ptrdiff_t)c.seq.load(memory_order_acquire) - (ptrdiff_t)(h + 1) < 0)
+                return false;
+
+            v = c.v;
+            c.seq.store(h + capacity, memory_order_release);
+            head.store(h + 1, memory_order_release);
+
+            return true;
+        }
+
+        FUNGUSCONCURRENCY_INLINE bool pop_if_open(T &v)
+        {
+            return pop(v);
+        }
+
+        // pops up to n published entries into v, moving head once.
+        FUNGUSCONCURRENCY_INLINE size_t pop_n(T *v, size_t n)
+        {
+            size_t h = head.load(memory_order_relaxed);
+            size_t i = 0;
+
+            for (; i < n; ++i)
+            {
+                cell &c = cells[(h + i) & mask];
+
+                if ((ptrdiff_t)c.seq.load(memory_order_acquire) - (ptrdiff_t)(h + i + 1) < 0)
+                    break;
+
+                v[i] = c.v;
+                c.seq.store(h + i + capacity, memory_order_release);
+            }
+
+            if (i > 0)
+                head.store(h + i, memory_order_release);
+
+            return i;
+        }
+
+        FUNGUSCONCURRENCY_INLINE bool empty() const
+        {
+            size_t h = head.load();
+            return (ptrdiff_t)cells[h & mask].seq.load() - (ptrdiff_t)(h + 1) < 0;
+        }
+
+        FUNGUSCONCURRENCY_INLINE size_t get_capacity() const
+        {
+            return capacity;
+        }
+    };
+}
+
+#endif
@@ -120,6 +120,8 @@ namespace fungus_concurrency
                     {
                         if (comm_impl_p->is_channel_open(chan_id))
                             mthis_wait = false;
+                        else
+                            comm_impl_p->wait_for_activity(-1);
                     }
                     else
                     {
@@ -158,6 +160,9 @@ namespace fungus_concurrency
                         parent_chan = event.id;
                     }
                 }
+
+                if (mthis_wait)
+                    comm_impl_p->wait_for_activity(-1);
             }
         }
 
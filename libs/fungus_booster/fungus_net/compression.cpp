@@ -0,0 +1,567 @@
+#include "fungus_net_compression_internal.h"
+
+#include <algorithm>
+#include <queue>
+
+namespace fungus_net
+{
+    using namespace fungus_util;
+
+    // fast codec stream: a sequence of (literals, match) pairs.  each
+    // starts with a token holding the literal length in its high nibble
+    // and the match length less min_match in its low one; a nibble of 15
+    // is continued in bytes of 255 ending with one below 255.  the
+    // literals follow the token, and then the offset of the match as
+    // two little endian bytes.  the last sequence has no match.
+    // offsets may reach back past the start of the packet in to the end
+    // of the dictionary.
+    static constexpr size_t   min_match       = 4;
+    static constexpr size_t   max_offset      = 65535;
+    static constexpr unsigned dictionary_bits = 14;
+
+    // longer than any run in a packet could be; only keeps a length
+    // being read from overflowing.
+    static constexpr size_t   max_length      = (size_t)1 << 30;
+
+    static inline uint32_t __read32(const uint8_t *p)
+    {
+        uint32_t v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    static inline size_t __hash(uint32_t seq, unsigned bits)
+    {
+        return (size_t)((seq * 2654435761u) >> (32 - bits));
+    }
+
+    // counts the bytes at a that match those at b, up to a_end.
+    static inline size_t __match_length(const uint8_t *a, const uint8_t *b, const uint8_t *a_end)
+    {
+        const uint8_t *start = a;
+        while (a < a_end && *a == *b)
+        {
+            ++a;
+            ++b;
+        }
+
+        return a - start;
+    }
+
+    static inline bool __write_length(uint8_t *&op, const uint8_t *oend, size_t length)
+    {
+        for (length -= 15;; length -= 255)
+        {
+            if (op == oend) return false;
+
+            if (length < 255)
+            {
+                *op++ = (uint8_t)length;
+                return true;
+            }
+
+            *op++ = 255;
+        }
+    }
+
+    static inline bool __read_length(const uint8_t *&ip, const uint8_t *iend, size_t &length)
+    {
+        uint8_t b;
+        do
+        {
+            if (ip == iend || length > max_length) return false;
+
+            b = *ip++;
+            length += b;
+        }
+        while (b == 255);
+
+        return true;
+    }
+
+    static inline bool __write_sequence(uint8_t *&op, const uint8_t *oend,
+                                        const uint8_t *literals, size_t n_literals,
+                                        size_t offset, size_t match)
+    {
+        if (op == oend) return false;
+
+        size_t match_code = match ? match - min_match : 0;
+        *op++ = (uint8_t)((std::min(n_literals, (size_t)15) << 4) | std::min(match_code, (size_t)15));
+
+        if (n_literals >= 15 && !__write_length(op, oend, n_literals)) return false;
+        if (n_literals > (size_t)(oend - op))                          return false;
+
+        memcpy(op, literals, n_literals);
+        op += n_literals;
+
+        if (!match) return true;
+
+        if (oend - op < 2) return false;
+
+        *op++ = (uint8_t)(offset & 0xFF);
+        *op++ = (uint8_t)(offset >> 8);
+
+        return match_code < 15 || __write_length(op, oend, match_code);
+    }
+
+    template <typename T>
+    static inline char *__put(char *at, T v, const endian_converter &endian)
+    {
+        v = endian.convert(v);
+        memcpy(at, &v, sizeof(T));
+        return at + sizeof(T);
+    }
+
+    template <typename T>
+    static inline const char *__get(const char *at, T &v, const endian_converter &endian)
+    {
+        memcpy(&v, at, sizeof(T));
+        v = endian.convert(v);
+        return at + sizeof(T);
+    }
+
+    compressor::compressor(compression_codec codec, const compression_dictionary *dictionary,
+                           size_t max_raw_size):
+        codec(codec), dictionary(dictionary && !dictionary->empty() ? dictionary : nullptr),
+        max_raw_size(max_raw_size), range_coder(nullptr), table(), dictionary_table(),
+        bytes_in(0), bytes_out(0)
+    {
+        // the decompressing side needs the range coder whatever its own
+        // codec is.
+        range_coder = enet_range_coder_create();
+
+        if (this->dictionary)
+        {
+            const std::string &bytes = this->dictionary->get_bytes();
+            const uint8_t     *dict  = (const uint8_t *)bytes.data();
+
+            // later positions win, since they are closer to the packet.
+            dictionary_table.assign((size_t)1 << dictionary_bits, 0);
+            for (size_t i = 0; i + min_match <= bytes.size(); ++i)
+                dictionary_table[__hash(__read32(dict + i), dictionary_bits)] = (uint16_t)(i + 1);
+        }
+    }
+
+    compressor::~compressor()
+    {
+        if (range_coder)
+            enet_range_coder_destroy(range_coder);
+    }
+
+    size_t compressor::__compress_fast(const char *in_data, size_t size, char *out_data, size_t out_cap)
+    {
+        const uint8_t *in   = (const uint8_t *)in_data;
+        uint8_t       *op   = (uint8_t *)out_data;
+        const uint8_t *oend = op + out_cap;
+
+        const uint8_t *dict      = dictionary ? (const uint8_t *)dictionary->get_bytes().data() : nullptr;
+        const size_t   dict_size = dictionary ? dictionary->get_bytes().size() : 0;
+
+        // small packets get a small table, so clearing it stays cheap.
+        unsigned bits = 8;
+        while (bits < 16 && ((size_t)1 << bits) < size)
+            ++bits;
+
+        table.assign((size_t)1 << bits, 0);
+
+        size_t anchor = 0, i = 0;
+        while (i + min_match <= size)
+        {
+            uint32_t seq    = __read32(in + i);
+            size_t   match  = 0;
+            size_t   offset = 0;
+
+            uint32_t &slot = table[__hash(seq, bits)];
+            size_t    cand = slot;
+            slot = (uint32_t)(i + 1);
+
+            if (cand && i + 1 - cand <= max_offset && __read32(in + cand - 1) == seq)
+            {
+                offset = i + 1 - cand;
+                match  = __match_length(in + i, in + cand - 1, in + size);
+            }
+            else if (dict)
+            {
+                size_t dcand = dictionary_table[__hash(seq, dictionary_bits)];
+                if (dcand)
+                {
+                    size_t at = dcand - 1;
+                    offset = dict_size - at + i;
+
+                    if (offset <= max_offset && __read32(dict + at) == seq)
+                        match = __match_length(in + i, dict + at, in + i + std::min(size - i, dict_size - at));
+                }
+            }
+
+            if (match < min_match)
+            {
+                // skip ahead faster the longer nothing has matched.
+                i += 1 + ((i - anchor) >> 6);
+                continue;
+            }
+
+            if (!__write_sequence(op, oend, in + anchor, i - anchor, offset, match))
+                return 0;
+
+            i     += match;
+            anchor = i;
+        }
+
+        if (!__write_sequence(op, oend, in + anchor, size - anchor, 0, 0))
+            return 0;
+
+        return op - (uint8_t *)out_data;
+    }
+
+    size_t compressor::__decompress_fast(const char *in_data, size_t size, char *out_data, size_t raw_size) const
+    {
+        const uint8_t *ip   = (const uint8_t *)in_data;
+        const uint8_t *iend = ip + size;
+        uint8_t       *out  = (uint8_t *)out_data;
+        uint8_t       *op   = out;
+        const uint8_t *oend = out + raw_size;
+
+        const uint8_t *dict      = dictionary ? (const uint8_t *)dictionary->get_bytes().data() : nullptr;
+        const size_t   dict_size = dictionary ? dictionary->get_bytes().size() : 0;
+
+        for (;;)
+        {
+            if (ip == iend) return 0;
+
+            uint8_t token = *ip++;
+
+            size_t n_literals = token >> 4;
+            if (n_literals == 15 && !__read_length(ip, iend, n_literals)) return 0;
+
+            if (n_literals > (size_t)(iend - ip) || n_literals > (size_t)(oend - op)) return 0;
+
+            memcpy(op, ip, n_literals);
+            op += n_literals;
+            ip += n_literals;
+
+            if (ip == iend)
+                return op - out;
+
+            if (iend - ip < 2) return 0;
+
+            size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+            ip += 2;
+
+            size_t match = token & 0xF;
+            if (match == 15 && !__read_length(ip, iend, match)) return 0;
+            match += min_match;
+
+            size_t produced = op - out;
+            if (offset == 0 || offset > produced + dict_size || match > (size_t)(oend - op)) return 0;
+
+            if (offset > produced)
+            {
+                size_t n = std::min(match, offset - produced);
+                memcpy(op, dict + dict_size - (offset - produced), n);
+
+                op    += n;
+                match -= n;
+            }
+
+            // byte by byte, since the match may overlap what it makes.
+            const uint8_t *src = op - offset;
+            while (match--)
+                *op++ = *src++;
+        }
+    }
+
+    size_t compressor::get_bound(size_t size)
+    {
+        // every 255 literals cost at most one more byte.
+        return header_size + size + size / 255 + 16;
+    }
+
+    size_t compressor::compress(const char *in, size_t size, char *out, size_t out_cap,
+                                const endian_converter &endian)
+    {
+        if (!is_enabled() || size < min_size || out_cap <= header_size) return 0;
+
+        size_t n = 0;
+        switch (codec)
+        {
+        case compression_codec::range_coder:
+        {
+            ENetBuffer buf;
+            buf.data       = (void *)in;
+            buf.dataLength = size;
+
+            n = enet_range_coder_compress(range_coder, &buf, 1, size,
+                                          (enet_uint8 *)out + header_size, out_cap - header_size);
+            break;
+        }
+        case compression_codec::fast:
+            n = __compress_fast(in, size, out + header_size, out_cap - header_size);
+            break;
+        default:
+            break;
+        };
+
+        if (n == 0 || header_size + n >= size)
+            return 0;
+
+        char *at = out;
+        at = __put(at, compressed_marker, endian);
+        at = __put(at, (uint8_t)codec, endian);
+        at = __put(at, codec == compression_codec::fast && dictionary ? dictionary->get_id() : (uint32_t)0, endian);
+        at = __put(at, size, endian);
+
+        return header_size + n;
+    }
+
+    bool compressor::is_compressed(const char *data, size_t size, const endian_converter &endian)
+    {
+        if (size <= header_size) return false;
+
+        size_t marker;
+        __get(data, marker, endian);
+
+        return marker == compressed_marker;
+    }
+
+    size_t compressor::get_max_ratio(compression_codec codec)
+    {
+        // a byte of 255 adds 255 to a length in the fast codec.  the
+        // range coder spends a little under a bit on a byte it has seen
+        // over and over; measured at about 1000:1 on runs of zeroes.
+        switch (codec)
+        {
+        case compression_codec::range_coder:
+            return 2048;
+        case compression_codec::fast:
+            return 256;
+        default:
+            break;
+        };
+
+        return 1;
+    }
+
+    bool compressor::read_header(const char *data, size_t size, const endian_converter &endian,
+                                 size_t &raw_size) const
+    {
+        if (size <= header_size) return false;
+
+        size_t   marker;
+        uint8_t  codec_i;
+        uint32_t id;
+
+        const char *at = data;
+        at = __get(at, marker,   endian);
+        at = __get(at, codec_i,  endian);
+        at = __get(at, id,       endian);
+        at = __get(at, raw_size, endian);
+
+        if (marker != compressed_marker || raw_size > max_raw_size ||
+            raw_size / get_max_ratio((compression_codec)codec_i) > size - header_size)
+            return false;
+
+        switch ((compression_codec)codec_i)
+        {
+        case compression_codec::range_coder:
+            return id == 0;
+        case compression_codec::fast:
+            return id == (dictionary ? dictionary->get_id() : (uint32_t)0);
+        default:
+            break;
+        };
+
+        return false;
+    }
+
+    bool compressor::decompress(const char *data, size_t size, char *out, size_t raw_size,
+                                const endian_converter &endian)
+    {
+        uint8_t codec_i;
+        __get(data + sizeof(size_t), codec_i, endian);
+
+        const char *in   = data + header_size;
+        size_t      n_in = size - header_size;
+
+        switch ((compression_codec)codec_i)
+        {
+        case compression_codec::range_coder:
+            return enet_range_coder_decompress(range_coder, (const enet_uint8 *)in, n_in,
+                                               (enet_uint8 *)out, raw_size) == raw_size;
+        case compression_codec::fast:
+            return __decompress_fast(in, n_in, out, raw_size) == raw_size;
+        default:
+            break;
+        };
+
+        return false;
+    }
+
+    static uint32_t __checksum(const std::string &bytes)
+    {
+        // fnv-1a; 0 is kept for no dictionary.
+        uint32_t h = 2166136261u;
+        for (char c: bytes)
+            h = (h ^ (uint8_t)c) * 16777619u;
+
+        return h ? h : 1;
+    }
+
+    constexpr size_t compression_dictionary::max_size;
+
+    compression_dictionary::compression_dictionary():
+        bytes(), id(0)
+    {}
+
+    compression_dictionary::compression_dictionary(const std::string &bytes):
+        bytes(bytes.size() > max_size ? bytes.substr(bytes.size() - max_size) : bytes),
+        id(0)
+    {
+        if (!this->bytes.empty())
+            id = __checksum(this->bytes);
+    }
+
+    const std::string &compression_dictionary::get_bytes() const
+    {
+        return bytes;
+    }
+
+    uint32_t compression_dictionary::get_id() const
+    {
+        return id;
+    }
+
+    bool compression_dictionary::empty() const
+    {
+        return bytes.empty();
+    }
+
+    // greedy segment selection: every segment_size run of the samples
+    // (starting every segment_step bytes) scores the number of samples
+    // each of its k-grams appears in.  the best segment is taken, its
+    // k-grams stop counting, and the rest are rescored lazily, since a
+    // score can only go down.
+    compression_dictionary compression_dictionary::train(const std::vector<std::string> &samples, size_t size)
+    {
+        constexpr size_t k            = 8;
+        constexpr size_t segment_size = 64;
+        constexpr size_t segment_step = 16;
+
+        struct kgram
+        {
+            uint32_t n_samples;
+            uint32_t last_sample;
+        };
+
+        typedef hash_map<default_hash<uint64_t, kgram>> kgram_map;
+
+        struct segment
+        {
+            size_t   score;
+            uint32_t sample;
+            uint32_t at;
+
+            inline bool operator <(const segment &s) const
+            {
+                return score < s.score;
+            }
+        };
+
+        size = std::min(size, max_size);
+
+        kgram_map kgrams;
+        for (size_t i = 0; i < samples.size(); ++i)
+        {
+            const std::string &sample = samples[i];
+            for (size_t j = 0; j + k <= sample.size(); ++j)
+            {
+                uint64_t key;
+                memcpy(&key, sample.data() + j, k);
+
+                auto it = kgrams.find(key);
+                if (it == kgrams.end())
+                    kgrams.insert(kgram_map::entry(key, kgram{1, (uint32_t)i}));
+                else if (it->value.last_sample != (uint32_t)i)
+                {
+                    ++it->value.n_samples;
+                    it->value.last_sample = (uint32_t)i;
+                }
+            }
+        }
+
+        auto score = [&](const segment &s) -> size_t
+        {
+            const std::string &sample = samples[s.sample];
+            size_t end = std::min(sample.size(), (size_t)s.at + segment_size);
+
+            size_t total = 0;
+            for (size_t j = s.at; j + k <= end; ++j)
+            {
+                uint64_t key;
+                memcpy(&key, sample.data() + j, k);
+
+                auto it = kgrams.find(key);
+                if (it != kgrams.end() && it->value.n_samples > 1)
+                    total += it->value.n_samples;
+            }
+
+            return total;
+        };
+
+        std::priority_queue<segment> segments;
+        for (size_t i = 0; i < samples.size(); ++i)
+        {
+            for (size_t j = 0; j + k <= samples[i].size(); j += segment_step)
+            {
+                segment s = {0, (uint32_t)i, (uint32_t)j};
+                s.score = score(s);
+
+                if (s.score > 0)
+                    segments.push(s);
+            }
+        }
+
+        std::vector<std::string> picked;
+        size_t n_picked = 0;
+
+        while (n_picked < size && !segments.empty())
+        {
+            segment s = segments.top();
+            segments.pop();
+
+            s.score = score(s);
+            if (s.score == 0) continue;
+
+            if (!segments.empty() && s.score < segments.top().score)
+            {
+                segments.push(s);
+                continue;
+            }
+
+            const std::string &sample = samples[s.sample];
+            std::string bytes = sample.substr(s.at, std::min(segment_size, sample.size() - s.at));
+
+            for (size_t j = 0; j + k <= bytes.size(); ++j)
+            {
+                uint64_t key;
+                memcpy(&key, bytes.data() + j, k);
+
+                auto it = kgrams.find(key);
+                if (it != kgrams.end())
+                    it->value.n_samples = 0;
+            }
+
+            n_picked += bytes.size();
+            picked.push_back(std::move(bytes));
+        }
+
+        // the best segments go last, nearest to the packets.
+        std::string bytes;
+        for (auto it = picked.rbegin(); it != picked.rend(); ++it)
+            bytes += *it;
+
+        if (bytes.size() > size)
+            bytes.erase(0, bytes.size() - size);
+
+        return compression_dictionary(bytes);
+    }
+}
@@ -50,7 +50,8 @@ typedef enum _ENetSocketOption
    ENET_SOCKOPT_BROADCAST = 2,
    ENET_SOCKOPT_RCVBUF    = 3,
    ENET_SOCKOPT_SNDBUF    = 4,
-   ENET_SOCKOPT_REUSEADDR = 5
+   ENET_SOCKOPT_REUSEADDR = 5,
+   ENET_SOCKOPT_REUSEPORT = 6
 } ENetSocketOption;
 
 enum
@@ -77,6 +78,20 @@ typedef struct _ENetAddress
    enet_uint16 port;
 } ENetAddress;
 
+/**
+ * A datagram moved by enet_socket_send_batch() or enet_socket_receive_batch().
+ *
+ * address is the destination of a sent datagram or the source of a received one,
+ * and dataLength is set to the number of bytes actually sent or received.
+ */
+typedef struct _ENetSocketDatagram
+{
+   ENetAddress  address;
+   ENetBuffer * buffers;
+   size_t       bufferCount;
+   size_t       dataLength;
+} ENetSocketDatagram;
+
 /**
  * Packet flag bit constants.
  *
@@ -185,6 +200,11 @@ typedef enum _ENetPeerState
 #define ENET_BUFFER_MAXIMUM (1 + 2 * ENET_PROTOCOL_MAXIMUM_PACKET_COMMANDS)
 #endif
 
+/** maximum number of datagrams a host sends or receives per socket call */
+#ifndef ENET_SOCKET_BATCH_MAXIMUM
+#define ENET_SOCKET_BATCH_MAXIMUM 32
+#endif
+
 enum
 {
    ENET_HOST_RECEIVE_BUFFER_SIZE          = 256 * 1024,
@@ -351,6 +371,15 @@ typedef struct _ENetHost
    ENetAddress          receivedAddress;
    enet_uint8 *         receivedData;
    size_t               receivedDataLength;
+   ENetSocketDatagram   receivedDatagrams [ENET_SOCKET_BATCH_MAXIMUM];
+   ENetBuffer           receivedBuffers [ENET_SOCKET_BATCH_MAXIMUM];
+   size_t               receivedDatagramCount;
+   size_t               receivedDatagramIndex;
+   enet_uint8           receivedDatagramData [ENET_SOCKET_BATCH_MAXIMUM][ENET_PROTOCOL_MAXIMUM_MTU];
+   ENetSocketDatagram   sentDatagrams [ENET_SOCKET_BATCH_MAXIMUM];
+   ENetBuffer           sentBuffers [ENET_SOCKET_BATCH_MAXIMUM];
+   size_t               sentDatagramCount;
+   enet_uint8           sentDatagramData [ENET_SOCKET_BATCH_MAXIMUM][ENET_PROTOCOL_MAXIMUM_MTU + sizeof (enet_uint32)]; /* room for the checksum */
    enet_uint32          totalSentData;               /**< total data sent, user should reset to 0 as needed to prevent overflow */
    enet_uint32          totalSentPackets;            /**< total UDP packets sent, user should reset to 0 as needed to prevent overflow */
    enet_uint32          totalReceivedData;           /**< total data received, user should reset to 0 as needed to prevent overflow */
@@ -452,6 +481,8 @@ ENET_API ENetSocket enet_socket_accept (ENetSocket, ENetAddress *);
 ENET_API int        enet_socket_connect (ENetSocket, const ENetAddress *);
 ENET_API int        enet_socket_send (ENetSocket, const ENetAddress *, const ENetBuffer *, size_t);
 ENET_API int        enet_socket_receive (ENetSocket, ENetAddress *, ENetBuffer *, size_t);
+ENET_API int        enet_socket_send_batch (ENetSocket, ENetSocketDatagram *, size_t);
+ENET_API int        enet_socket_receive_batch (ENetSocket, ENetSocketDatagram *, size_t);
 ENET_API int        enet_socket_wait (ENetSocket, enet_uint32 *, enet_uint32);
 ENET_API int        enet_socket_set_option (ENetSocket, ENetSocketOption, int);
 ENET_API void       enet_socket_destroy (ENetSocket);
@@ -500,10 +531,12 @@ ENET_API int          enet_packet_resize  (ENetPacket *, size_t);
 extern enet_uint32    enet_crc32 (const ENetBuffer *, size_t);
 
 ENET_API ENetHost * enet_host_create (const ENetAddress *, size_t, size_t, enet_uint32, enet_uint32);
+ENET_API ENetHost * enet_host_create_shared (const ENetAddress *, size_t, size_t, enet_uint32, enet_uint32);
 ENET_API void       enet_host_destroy (ENetHost *);
 ENET_API ENetPeer * enet_host_connect (ENetHost *, const ENetAddress *, size_t, enet_uint32);
 ENET_API int        enet_host_check_events (ENetHost *, ENetEvent *);
 ENET_API int        enet_host_service (ENetHost *, ENetEvent *, enet_uint32);
+ENET_API int        enet_host_service_timeout (ENetHost *, enet_uint32 *);
 ENET_API void       enet_host_flush (ENetHost *);
 ENET_API void       enet_host_broadcast (ENetHost *, enet_uint8, ENetPacket *);
 ENET_API void       enet_host_compress (ENetHost *, const ENetCompressor *);
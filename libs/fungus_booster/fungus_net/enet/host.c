@@ -11,26 +11,12 @@
     @{
 */
 
-/** Creates a host for communicating to peers.
-
-    @param address   the address at which other peers may connect to this host.  If NULL, then no peers may connect to the host.
-    @param peerCount the maximum number of peers that should be allocated for the host.
-    @param channelLimit the maximum number of channels allowed; if 0, then this is equivalent to ENET_PROTOCOL_MAXIMUM_CHANNEL_COUNT
-    @param incomingBandwidth downstream bandwidth of the host in bytes/second; if 0, ENet will assume unlimited bandwidth.
-    @param outgoingBandwidth upstream bandwidth of the host in bytes/second; if 0, ENet will assume unlimited bandwidth.
-
-    @returns the host on success and NULL on failure
-
-    @remarks ENet will strategically drop packets on specific sides of a connection between hosts
-    to ensure the host's bandwidth is not overwhelmed.  The bandwidth parameters also determine
-    the window size of a connection which limits the amount of reliable packets that may be in transit
-    at any given time.
-*/
-ENetHost *
-enet_host_create (const ENetAddress * address, size_t peerCount, size_t channelLimit, enet_uint32 incomingBandwidth, enet_uint32 outgoingBandwidth)
+static ENetHost *
+enet_host_create_internal (const ENetAddress * address, size_t peerCount, size_t channelLimit, enet_uint32 incomingBandwidth, enet_uint32 outgoingBandwidth, int shareAddress)
 {
     ENetHost * host;
     ENetPeer * currentPeer;
+    size_t i;
 
     if (peerCount > ENET_PROTOCOL_MAXIMUM_PEER_ID)
       return NULL;
@@ -49,7 +35,9 @@ enet_host_create (const ENetAddress * address, size_t peerCount, size_t channelL
     memset (host -> peers, 0, peerCount * sizeof (ENetPeer));
 
     host -> socket = enet_socket_create (ENET_SOCKET_TYPE_DATAGRAM);
-    if (host -> socket == ENET_SOCKET_NULL || (address != NULL && enet_socket_bind (host -> socket, address) < 0))
+    if (host -> socket == ENET_SOCKET_NULL ||
+        (shareAddress && enet_socket_set_option (host -> socket, ENET_SOCKOPT_REUSEPORT, 1) < 0) ||
+        (address != NULL && enet_socket_bind (host -> socket, address) < 0))
     {
        if (host -> socket != ENET_SOCKET_NULL)
          enet_socket_destroy (host -> socket);
@@ -90,6 +78,22 @@ enet_host_create (const ENetAddress * address, size_t peerCount, size_t channelL
     host -> receivedAddress.port = 0;
     host -> receivedData = NULL;
     host -> receivedDataLength = 0;
+    host -> receivedDatagramCount = 0;
+    host -> receivedDatagramIndex = 0;
+    host -> sentDatagramCount = 0;
+
+    for (i = 0; i < ENET_SOCKET_BATCH_MAXIMUM; ++ i)
+    {
+       host -> receivedBuffers [i].data = host -> receivedDatagramData [i];
+       host -> receivedBuffers [i].dataLength = sizeof (host -> receivedDatagramData [i]);
+       host -> receivedDatagrams [i].buffers = & host -> receivedBuffers [i];
+       host -> receivedDatagrams [i].bufferCount = 1;
+
+       host -> sentBuffers [i].data = host -> sentDatagramData [i];
+       host -> sentBuffers [i].dataLength = 0;
+       host -> sentDatagrams [i].buffers = & host -> sentBuffers [i];
+       host -> sentDatagrams [i].bufferCount = 1;
+    }
 
     host -> totalSentData = 0;
     host -> totalSentPackets = 0;
@@ -125,6 +129,39 @@ enet_host_create (const ENetAddress * address, size_t peerCount, size_t channelL
     return host;
 }
 
+/** Creates a host for communicating to peers.
+
+    @param address   the address at which other peers may connect to this host.  If NULL, then no peers may connect to the host.
+    @param peerCount the maximum number of peers that should be allocated for the host.
+    @param channelLimit the maximum number of channels allowed; if 0, then this is equivalent to ENET_PROTOCOL_MAXIMUM_CHANNEL_COUNT
+    @param incomingBandwidth downstream bandwidth of the host in bytes/second; if 0, ENet will assume unlimited bandwidth.
+    @param outgoingBandwidth upstream bandwidth of the host in bytes/second; if 0, ENet will assume unlimited bandwidth.
+
+    @returns the host on success and NULL on failure
+
+    @remarks ENet will strategically drop packets on specific sides of a connection between hosts
+    to ensure the host's bandwidth is not overwhelmed.  The bandwidth parameters also determine
+    the window size of a connection which limits the amount of reliable packets that may be in transit
+    at any given time.
+*/
+ENetHost *
+enet_host_create (const ENetAddress * address, size_t peerCount, size_t channelLimit, enet_uint32 incomingBandwidth, enet_uint32 outgoingBandwidth)
+{
+    return enet_host_create_internal (address, peerCount, channelLimit, incomingBandwidth, outgoingBandwidth, 0);
+}
+
+/** Creates a host, like enet_host_create(), whose address may be shared with other
+    hosts created the same way (SO_REUSEPORT).  Incoming datagrams are spread across
+    the hosts by the operating system, each source address always going to the same host.
+
+    @returns the host on success and NULL on failure, or if the platform cannot share addresses
+*/
+ENetHost *
+enet_host_create_shared (const ENetAddress * address, size_t peerCount, size_t channelLimit, enet_uint32 incomingBandwidth, enet_uint32 outgoingBandwidth)
+{
+    return enet_host_create_internal (address, peerCount, channelLimit, incomingBandwidth, outgoingBandwidth, 1);
+}
+
 /** Destroys the host and all resources associated with it.
     @param host pointer to the host to destroy
 */
@@ -1154,27 +1154,32 @@ enet_protocol_receive_incoming_commands (ENetHost * host, ENetEvent * event)
 {
     for (;;)
     {
-       int receivedLength;
-       ENetBuffer buffer;
+       ENetSocketDatagram * datagram;
 
-       buffer.data = host -> packetData [0];
-       buffer.dataLength = sizeof (host -> packetData [0]);
+       /* datagrams left over from a batch that was cut short by an event are handled first */
+       if (host -> receivedDatagramIndex >= host -> receivedDatagramCount)
+       {
+          int receivedCount = enet_socket_receive_batch (host -> socket,
+                                                         host -> receivedDatagrams,
+                                                         ENET_SOCKET_BATCH_MAXIMUM);
 
-       receivedLength = enet_socket_receive (host -> socket,
-                                             & host -> receivedAddress,
-                                             & buffer,
-                                             1);
+          if (receivedCount < 0)
+            return -1;
 
-       if (receivedLength < 0)
-         return -1;
+          if (receivedCount == 0)
+            return 0;
 
-       if (receivedLength == 0)
-         return 0;
+          host -> receivedDatagramCount = receivedCount;
+          host -> receivedDatagramIndex = 0;
+       }
+
+       datagram = & host -> receivedDatagrams [host -> receivedDatagramIndex ++];
 
-       host -> receivedData = host -> packetData [0];
-       host -> receivedDataLength = receivedLength;
+       host -> receivedAddress = datagram -> address;
+       host -> receivedData = (enet_uint8 *) datagram -> buffers -> data;
+       host -> receivedDataLength = datagram -> dataLength;
 
-       host -> totalReceivedData += receivedLength;
+       host -> totalReceivedData += datagram -> dataLength;
        host -> totalReceivedPackets ++;
 
        switch (enet_protocol_handle_incoming_commands (host, event))
@@ -1521,12 +1526,72 @@ enet_protocol_send_reliable_outgoing_commands (ENetHost * host, ENetPeer * peer)
 }
 
 static int
-enet_protocol_send_outgoing_commands (ENetHost * host, ENetEvent * event, int checkForTimeouts)
+enet_protocol_flush_datagrams (ENetHost * host)
+{
+    ENetSocketDatagram * datagram = host -> sentDatagrams;
+    size_t datagramCount = host -> sentDatagramCount;
+
+    host -> sentDatagramCount = 0;
+
+    while (datagramCount > 0)
+    {
+       int sentCount = enet_socket_send_batch (host -> socket, datagram, datagramCount),
+           i;
+
+       if (sentCount < 0)
+         return -1;
+
+       /* the socket would block; what is left is dropped like any lost datagram */
+       if (sentCount == 0)
+         break;
+
+       for (i = 0; i < sentCount; ++ i)
+       {
+          host -> totalSentData += datagram [i].dataLength;
+          host -> totalSentPackets ++;
+       }
+
+       datagram += sentCount;
+       datagramCount -= sentCount;
+    }
+
+    return 0;
+}
+
+static int
+enet_protocol_queue_datagram (ENetHost * host, const ENetAddress * address)
+{
+    ENetSocketDatagram * datagram;
+    enet_uint8 * data;
+    size_t i;
+
+    if (host -> sentDatagramCount >= ENET_SOCKET_BATCH_MAXIMUM &&
+        enet_protocol_flush_datagrams (host) < 0)
+      return -1;
+
+    datagram = & host -> sentDatagrams [host -> sentDatagramCount ++];
+    datagram -> address = * address;
+
+    /* the buffers refer to packets that may be freed before the batch is flushed */
+    data = (enet_uint8 *) datagram -> buffers -> data;
+    for (i = 0; i < host -> bufferCount; ++ i)
+    {
+       memcpy (data, host -> buffers [i].data, host -> buffers [i].dataLength);
+       data += host -> buffers [i].dataLength;
+    }
+
+    datagram -> buffers -> dataLength = data - (enet_uint8 *) datagram -> buffers -> data;
+
+    return 0;
+}
+
+static int
+enet_protocol_queue_outgoing_commands (ENetHost * host, ENetEvent * event, int checkForTimeouts)
 {
     enet_uint8 headerData [sizeof (ENetProtocolHeader) + sizeof (enet_uint32)];
     ENetProtocolHeader * header = (ENetProtocolHeader *) headerData;
     ENetPeer * currentPeer;
-    int sentLength;
+    int queued;
     size_t shouldCompress = 0;
 
     host -> continueSending = 1;
@@ -1660,20 +1725,29 @@ enet_protocol_send_outgoing_commands (ENetHost * host, ENetEvent * event, int ch
 
         currentPeer -> lastSendTime = host -> serviceTime;
 
-        sentLength = enet_socket_send (host -> socket, & currentPeer -> address, host -> buffers, host -> bufferCount);
+        queued = enet_protocol_queue_datagram (host, & currentPeer -> address);
 
         enet_protocol_remove_sent_unreliable_commands (currentPeer);
 
-        if (sentLength < 0)
+        if (queued < 0)
           return -1;
-
-        host -> totalSentData += sentLength;
-        host -> totalSentPackets ++;
     }
 
     return 0;
 }
 
+/* the datagrams of every peer are queued up and then sent in as few socket calls as possible. */
+static int
+enet_protocol_send_outgoing_commands (ENetHost * host, ENetEvent * event, int checkForTimeouts)
+{
+    int result = enet_protocol_queue_outgoing_commands (host, event, checkForTimeouts);
+
+    if (enet_protocol_flush_datagrams (host) < 0)
+      return -1;
+
+    return result;
+}
+
 /** Sends any queued packets on the host specified to its designated peers.
 
     @param host   host to flush
@@ -1709,6 +1783,74 @@ enet_host_check_events (ENetHost * host, ENetEvent * event)
     return enet_protocol_dispatch_incoming_commands (host, event);
 }
 
+/** Finds out how long the host can go without being serviced, as long as
+    no datagrams arrive on its socket.  Bandwidth throttling is not counted.
+
+    @param host    host to check
+    @param timeout set to the number of milliseconds until enet_host_service
+                   next has work, 0 if it has work now
+    @retval 1 if timeout was set
+    @retval 0 if the host has nothing to do until a datagram arrives
+    @ingroup host
+*/
+int
+enet_host_service_timeout (ENetHost * host, enet_uint32 * timeout)
+{
+    ENetPeer * currentPeer;
+    enet_uint32 timeCurrent, deadline;
+    int hasDeadline = 0;
+
+    if (! enet_list_empty (& host -> dispatchQueue) ||
+        host -> receivedDatagramIndex < host -> receivedDatagramCount)
+    {
+        * timeout = 0;
+
+        return 1;
+    }
+
+    timeCurrent = enet_time_get ();
+
+    for (currentPeer = host -> peers;
+         currentPeer < & host -> peers [host -> peerCount];
+         ++ currentPeer)
+    {
+        if (currentPeer -> state == ENET_PEER_STATE_DISCONNECTED ||
+            currentPeer -> state == ENET_PEER_STATE_ZOMBIE)
+          continue;
+
+        /* reliable commands waiting on a full window go out when the window
+           opens, which takes an acknowledgement or a timeout. */
+        if (! enet_list_empty (& currentPeer -> acknowledgements) ||
+            ! enet_list_empty (& currentPeer -> outgoingUnreliableCommands) ||
+            (! enet_list_empty (& currentPeer -> outgoingReliableCommands) &&
+             enet_list_empty (& currentPeer -> sentReliableCommands)))
+        {
+            * timeout = 0;
+
+            return 1;
+        }
+
+        if (! enet_list_empty (& currentPeer -> sentReliableCommands))
+          deadline = currentPeer -> nextTimeout;
+        else
+          deadline = currentPeer -> lastReceiveTime + ENET_PEER_PING_INTERVAL;
+
+        if (ENET_TIME_GREATER_EQUAL (timeCurrent, deadline))
+        {
+            * timeout = 0;
+
+            return 1;
+        }
+
+        if (! hasDeadline || ENET_TIME_DIFFERENCE (deadline, timeCurrent) < * timeout)
+          * timeout = ENET_TIME_DIFFERENCE (deadline, timeCurrent);
+
+        hasDeadline = 1;
+    }
+
+    return hasDeadline;
+}
+
 /** Waits for events on the host specified and shuttles packets between
     the host and its peers.
 
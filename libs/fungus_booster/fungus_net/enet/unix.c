@@ -4,6 +4,10 @@
 */
 #ifndef WIN32
 
+#if (defined(HAS_SENDMMSG) || defined(HAS_RECVMMSG)) && ! defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/ioctl.h>
@@ -31,7 +35,7 @@
 #endif
 
 #ifndef HAS_SOCKLEN_T
-//typedef int socklen_t; // don't need or want this on Linux GCC!  socklen_t is always defined in "sys/socket.h".
+/* typedef int socklen_t;  -- not needed on Linux GCC, socklen_t is always defined in "sys/socket.h". */
 #endif
 
 #ifndef MSG_NOSIGNAL
@@ -56,7 +60,7 @@ enet_time_get (void)
 {
     struct timeval timeVal;
 
-    gettimeofday (& timeVal, nullptr);
+    gettimeofday (& timeVal, NULL);
 
     return timeVal.tv_sec * 1000 + timeVal.tv_usec / 1000 - timeBase;
 }
@@ -66,7 +70,7 @@ enet_time_set (enet_uint32 newTimeBase)
 {
     struct timeval timeVal;
 
-    gettimeofday (& timeVal, nullptr);
+    gettimeofday (& timeVal, NULL);
 
     timeBase = timeVal.tv_sec * 1000 + timeVal.tv_usec / 1000 - newTimeBase;
 }
@@ -74,7 +78,7 @@ enet_time_set (enet_uint32 newTimeBase)
 int
 enet_address_set_host (ENetAddress * address, const char * name)
 {
-    struct hostent * hostEntry = nullptr;
+    struct hostent * hostEntry = NULL;
 #ifdef HAS_GETHOSTBYNAME_R
     struct hostent hostData;
     char buffer [2048];
@@ -89,7 +93,7 @@ enet_address_set_host (ENetAddress * address, const char * name)
     hostEntry = gethostbyname (name);
 #endif
 
-    if (hostEntry == nullptr ||
+    if (hostEntry == NULL ||
         hostEntry -> h_addrtype != AF_INET)
     {
 #ifdef HAS_INET_PTON
@@ -110,10 +114,10 @@ int
 enet_address_get_host_ip (const ENetAddress * address, char * name, size_t nameLength)
 {
 #ifdef HAS_INET_NTOP
-    if (inet_ntop (AF_INET, & address -> host, name, nameLength) == nullptr)
+    if (inet_ntop (AF_INET, & address -> host, name, nameLength) == NULL)
 #else
     char * addr = inet_ntoa (* (struct in_addr *) & address -> host);
-    if (addr != nullptr)
+    if (addr != NULL)
         strncpy (name, addr, nameLength);
     else
 #endif
@@ -125,7 +129,7 @@ int
 enet_address_get_host (const ENetAddress * address, char * name, size_t nameLength)
 {
     struct in_addr in;
-    struct hostent * hostEntry = nullptr;
+    struct hostent * hostEntry = NULL;
 #ifdef HAS_GETHOSTBYADDR_R
     struct hostent hostData;
     char buffer [2048];
@@ -144,7 +148,7 @@ enet_address_get_host (const ENetAddress * address, char * name, size_t nameLeng
     hostEntry = gethostbyaddr ((char *) & in, sizeof (struct in_addr), AF_INET);
 #endif
 
-    if (hostEntry == nullptr)
+    if (hostEntry == NULL)
       return enet_address_get_host_ip (address, name, nameLength);
 
     strncpy (name, hostEntry -> h_name, nameLength);
@@ -161,7 +165,7 @@ enet_socket_bind (ENetSocket socket, const ENetAddress * address)
 
     sin.sin_family = AF_INET;
 
-    if (address != nullptr)
+    if (address != NULL)
     {
        sin.sin_port = ENET_HOST_TO_NET_16 (address -> port);
        sin.sin_addr.s_addr = address -> host;
@@ -211,6 +215,12 @@ enet_socket_set_option (ENetSocket socket, ENetSocketOption option, int value)
             result = setsockopt (socket, SOL_SOCKET, SO_REUSEADDR, (char *) & value, sizeof (int));
             break;
 
+        case ENET_SOCKOPT_REUSEPORT:
+#ifdef SO_REUSEPORT
+            result = setsockopt (socket, SOL_SOCKET, SO_REUSEPORT, (char *) & value, sizeof (int));
+#endif
+            break;
+
         case ENET_SOCKOPT_RCVBUF:
             result = setsockopt (socket, SOL_SOCKET, SO_RCVBUF, (char *) & value, sizeof (int));
             break;
@@ -247,13 +257,13 @@ enet_socket_accept (ENetSocket socket, ENetAddress * address)
     socklen_t sinLength = sizeof (struct sockaddr_in);
 
     result = accept (socket,
-                     address != nullptr ? (struct sockaddr *) & sin : nullptr,
-                     address != nullptr ? & sinLength : nullptr);
+                     address != NULL ? (struct sockaddr *) & sin : NULL,
+                     address != NULL ? & sinLength : NULL);
 
     if (result == -1)
       return ENET_SOCKET_NULL;
 
-    if (address != nullptr)
+    if (address != NULL)
     {
         address -> host = (enet_uint32) sin.sin_addr.s_addr;
         address -> port = ENET_NET_TO_HOST_16 (sin.sin_port);
@@ -280,7 +290,7 @@ enet_socket_send (ENetSocket socket,
 
     memset (& msgHdr, 0, sizeof (struct msghdr));
 
-    if (address != nullptr)
+    if (address != NULL)
     {
         memset (& sin, 0, sizeof (struct sockaddr_in));
 
@@ -320,7 +330,7 @@ enet_socket_receive (ENetSocket socket,
 
     memset (& msgHdr, 0, sizeof (struct msghdr));
 
-    if (address != nullptr)
+    if (address != NULL)
     {
         msgHdr.msg_name = & sin;
         msgHdr.msg_namelen = sizeof (struct sockaddr_in);
@@ -344,7 +354,7 @@ enet_socket_receive (ENetSocket socket,
       return -1;
 #endif
 
-    if (address != nullptr)
+    if (address != NULL)
     {
         address -> host = (enet_uint32) sin.sin_addr.s_addr;
         address -> port = ENET_NET_TO_HOST_16 (sin.sin_port);
@@ -353,6 +363,142 @@ enet_socket_receive (ENetSocket socket,
     return recvLength;
 }
 
+/** Sends up to datagramCount datagrams, in order, with as few system calls as the
+    platform allows (sendmmsg).  Returns the number of datagrams sent, 0 if the socket
+    would block, or -1 on failure.
+*/
+int
+enet_socket_send_batch (ENetSocket socket,
+                        ENetSocketDatagram * datagrams,
+                        size_t datagramCount)
+{
+#ifdef HAS_SENDMMSG
+    struct mmsghdr msgHdrs [ENET_SOCKET_BATCH_MAXIMUM];
+    struct sockaddr_in sins [ENET_SOCKET_BATCH_MAXIMUM];
+    int sentCount, i;
+
+    if (datagramCount > ENET_SOCKET_BATCH_MAXIMUM)
+      datagramCount = ENET_SOCKET_BATCH_MAXIMUM;
+
+    memset (msgHdrs, 0, datagramCount * sizeof (struct mmsghdr));
+    memset (sins, 0, datagramCount * sizeof (struct sockaddr_in));
+
+    for (i = 0; i < (int) datagramCount; ++ i)
+    {
+        sins [i].sin_family = AF_INET;
+        sins [i].sin_port = ENET_HOST_TO_NET_16 (datagrams [i].address.port);
+        sins [i].sin_addr.s_addr = datagrams [i].address.host;
+
+        msgHdrs [i].msg_hdr.msg_name = & sins [i];
+        msgHdrs [i].msg_hdr.msg_namelen = sizeof (struct sockaddr_in);
+        msgHdrs [i].msg_hdr.msg_iov = (struct iovec *) datagrams [i].buffers;
+        msgHdrs [i].msg_hdr.msg_iovlen = datagrams [i].bufferCount;
+    }
+
+    sentCount = sendmmsg (socket, msgHdrs, datagramCount, MSG_NOSIGNAL);
+
+    if (sentCount == -1)
+    {
+       if (errno == EWOULDBLOCK)
+         return 0;
+
+       return -1;
+    }
+
+    for (i = 0; i < sentCount; ++ i)
+      datagrams [i].dataLength = msgHdrs [i].msg_len;
+
+    return sentCount;
+#else
+    size_t i;
+
+    for (i = 0; i < datagramCount; ++ i)
+    {
+        int sentLength = enet_socket_send (socket, & datagrams [i].address, datagrams [i].buffers, datagrams [i].bufferCount);
+
+        if (sentLength < 0)
+          return i > 0 ? (int) i : -1;
+
+        if (sentLength == 0)
+          break;
+
+        datagrams [i].dataLength = sentLength;
+    }
+
+    return (int) i;
+#endif
+}
+
+/** Receives up to datagramCount datagrams with as few system calls as the platform
+    allows (recvmmsg).  Returns the number of datagrams received, 0 if none are waiting,
+    or -1 on failure.  A truncated datagram is received with a dataLength of 0.
+*/
+int
+enet_socket_receive_batch (ENetSocket socket,
+                           ENetSocketDatagram * datagrams,
+                           size_t datagramCount)
+{
+#ifdef HAS_RECVMMSG
+    struct mmsghdr msgHdrs [ENET_SOCKET_BATCH_MAXIMUM];
+    struct sockaddr_in sins [ENET_SOCKET_BATCH_MAXIMUM];
+    int receivedCount, i;
+
+    if (datagramCount > ENET_SOCKET_BATCH_MAXIMUM)
+      datagramCount = ENET_SOCKET_BATCH_MAXIMUM;
+
+    memset (msgHdrs, 0, datagramCount * sizeof (struct mmsghdr));
+
+    for (i = 0; i < (int) datagramCount; ++ i)
+    {
+        msgHdrs [i].msg_hdr.msg_name = & sins [i];
+        msgHdrs [i].msg_hdr.msg_namelen = sizeof (struct sockaddr_in);
+        msgHdrs [i].msg_hdr.msg_iov = (struct iovec *) datagrams [i].buffers;
+        msgHdrs [i].msg_hdr.msg_iovlen = datagrams [i].bufferCount;
+    }
+
+    receivedCount = recvmmsg (socket, msgHdrs, datagramCount, 0, NULL);
+
+    if (receivedCount == -1)
+    {
+       if (errno == EWOULDBLOCK)
+         return 0;
+
+       return -1;
+    }
+
+    for (i = 0; i < receivedCount; ++ i)
+    {
+        datagrams [i].address.host = (enet_uint32) sins [i].sin_addr.s_addr;
+        datagrams [i].address.port = ENET_NET_TO_HOST_16 (sins [i].sin_port);
+        datagrams [i].dataLength = msgHdrs [i].msg_len;
+
+#ifdef HAS_MSGHDR_FLAGS
+        if (msgHdrs [i].msg_hdr.msg_flags & MSG_TRUNC)
+          datagrams [i].dataLength = 0;
+#endif
+    }
+
+    return receivedCount;
+#else
+    size_t i;
+
+    for (i = 0; i < datagramCount; ++ i)
+    {
+        int receivedLength = enet_socket_receive (socket, & datagrams [i].address, datagrams [i].buffers, datagrams [i].bufferCount);
+
+        if (receivedLength < 0)
+          return i > 0 ? (int) i : -1;
+
+        if (receivedLength == 0)
+          break;
+
+        datagrams [i].dataLength = receivedLength;
+    }
+
+    return (int) i;
+#endif
+}
+
 int
 enet_socketset_select (ENetSocket maxSocket, ENetSocketSet * readSet, ENetSocketSet * writeSet, enet_uint32 timeout)
 {
@@ -361,7 +507,7 @@ enet_socketset_select (ENetSocket maxSocket, ENetSocketSet * readSet, ENetSocket
     timeVal.tv_sec = timeout / 1000;
     timeVal.tv_usec = (timeout % 1000) * 1000;
 
-    return select (maxSocket + 1, readSet, writeSet, nullptr, & timeVal);
+    return select (maxSocket + 1, readSet, writeSet, NULL, & timeVal);
 }
 
 int
@@ -414,7 +560,7 @@ enet_socket_wait (ENetSocket socket, enet_uint32 * condition, enet_uint32 timeou
     if (* condition & ENET_SOCKET_WAIT_RECEIVE)
       FD_SET (socket, & readSet);
 
-    selectCount = select (socket + 1, & readSet, & writeSet, nullptr, & timeVal);
+    selectCount = select (socket + 1, & readSet, & writeSet, NULL, & timeVal);
 
     if (selectCount < 0)
       return -1;
@@ -295,6 +295,52 @@ enet_socket_receive (ENetSocket socket,
     return (int) recvLength;
 }
 
+int
+enet_socket_send_batch (ENetSocket socket,
+                        ENetSocketDatagram * datagrams,
+                        size_t datagramCount)
+{
+    size_t i;
+
+    for (i = 0; i < datagramCount; ++ i)
+    {
+        int sentLength = enet_socket_send (socket, & datagrams [i].address, datagrams [i].buffers, datagrams [i].bufferCount);
+
+        if (sentLength < 0)
+          return i > 0 ? (int) i : -1;
+
+        if (sentLength == 0)
+          break;
+
+        datagrams [i].dataLength = sentLength;
+    }
+
+    return (int) i;
+}
+
+int
+enet_socket_receive_batch (ENetSocket socket,
+                           ENetSocketDatagram * datagrams,
+                           size_t datagramCount)
+{
+    size_t i;
+
+    for (i = 0; i < datagramCount; ++ i)
+    {
+        int receivedLength = enet_socket_receive (socket, & datagrams [i].address, datagrams [i].buffers, datagrams [i].bufferCount);
+
+        if (receivedLength < 0)
+          return i > 0 ? (int) i : -1;
+
+        if (receivedLength == 0)
+          break;
+
+        datagrams [i].dataLength = receivedLength;
+    }
+
+    return (int) i;
+}
+
 int
 enet_socketset_select (ENetSocket maxSocket, ENetSocketSet * readSet, ENetSocketSet * writeSet, enet_uint32 timeout)
 {
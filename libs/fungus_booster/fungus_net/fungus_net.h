@@ -8,6 +8,7 @@
 #include "fungus_net_message_factory_manager.h"
 
 #include "fungus_net_authenticator.h"
+#include "fungus_net_compression.h"
 
 #include "fungus_net_host.h"
 #include "fungus_net_peer.h"
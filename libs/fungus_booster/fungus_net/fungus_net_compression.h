@@ -0,0 +1,102 @@
+#ifndef FUNGUSNET_COMPRESSION_H
+#define FUNGUSNET_COMPRESSION_H
+
+#include "fungus_net_common.h"
+
+#include <string>
+#include <vector>
+
+namespace fungus_net
+{
+    using namespace fungus_util;
+
+    /** @addtogroup compression Compression
+      * @{
+      */
+
+    /// The codec used to compress outgoing aggregated packets.
+    enum class compression_codec: uint8_t
+    {
+        none = 0,    /**< Packets are sent as they are. */
+
+        /** ENet's adaptive range coder.  Compresses small, redundant packets well,
+          * but is the slower of the two.  Does not use a compression_dictionary.
+          */
+        range_coder,
+
+        /** A fast LZ77 codec in the style of LZ4.  Compresses repeated byte runs,
+          * and can find them in a compression_dictionary as well as in the packet.
+          */
+        fast
+    };
+
+    /// The largest a compressed packet may expand to by default.  Larger ones are dropped.
+    constexpr size_t default_max_decompressed_size = 16 * 1024 * 1024;
+
+    /** \brief A static dictionary shared by both ends of a connection.
+      *
+      * The fast codec can refer back in to the dictionary as if it came right before every
+      * packet, so that even a small packet compresses well if it looks like the traffic the
+      * dictionary was trained on.  Both hosts must be started with the same dictionary;
+      * packets compressed with a different dictionary are dropped.
+      */
+    class FUNGUSNET_API compression_dictionary
+    {
+    private:
+        std::string bytes;
+        uint32_t    id;
+    public:
+        /// The largest dictionary the fast codec can refer back in to.
+        static constexpr size_t max_size = 65535;
+
+        /// Constructs an empty dictionary.
+        compression_dictionary();
+
+        /** Constructs a dictionary from raw bytes.
+          *
+          * @param bytes    the dictionary.  Only the last max_size bytes are kept.
+          */
+        compression_dictionary(const std::string &bytes);
+
+        /** Trains a dictionary from captured traffic.
+          *
+          * Picks the byte runs that occur most often across the samples.
+          *
+          * @param samples  captured packets or messages, each as raw bytes.
+          * @param size     the size of the dictionary to build, at most max_size.
+          *
+          * @returns the trained dictionary, which is smaller than size if the samples
+          *          do not have enough in common.
+          */
+        static compression_dictionary train(const std::vector<std::string> &samples, size_t size = 16384);
+
+        const std::string &get_bytes() const;
+
+        /// A checksum of the bytes, sent with every packet compressed with the dictionary.
+        uint32_t get_id() const;
+
+        bool empty() const;
+    };
+
+    /// Running totals for compression of outgoing packets.
+    struct FUNGUSNET_API compression_stats
+    {
+        uint64_t bytes_in;  /**< Bytes offered to the codec. */
+        uint64_t bytes_out; /**< Bytes sent in their place, whether compressed or not. */
+
+        inline compression_stats(uint64_t bytes_in = 0, uint64_t bytes_out = 0):
+            bytes_in(bytes_in),
+            bytes_out(bytes_out)
+        {}
+
+        /// Bytes kept off of the wire by compression.
+        inline uint64_t get_bytes_saved() const
+        {
+            return bytes_in - bytes_out;
+        }
+    };
+
+    /** @} */
+}
+
+#endif
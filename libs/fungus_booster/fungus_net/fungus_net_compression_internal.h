@@ -0,0 +1,109 @@
+#ifndef FUNGUSNET_COMPRESSION_INTERNAL_H
+#define FUNGUSNET_COMPRESSION_INTERNAL_H
+
+#include "fungus_net_compression.h"
+#include "fungus_net_defs_internal.h"
+
+#include <vector>
+
+namespace fungus_net
+{
+    using namespace fungus_util;
+
+    // compresses and decompresses whole packets for one thread.  the
+    // range coder keeps a context and the fast codec keeps its hash
+    // tables here, so every aggregator and separator has its own.
+    //
+    // a compressed packet starts with compressed_marker, a size word of
+    // all ones, which no aggregate can start with and no lone message
+    // either, since packet::set_guard_word() refuses 0xFFFF.  it is
+    // followed by the codec, the id of the dictionary and the size of the
+    // packet before it was compressed.  only whole packets are
+    // compressed, never a message inside one.
+    class compressor
+    {
+    private:
+        compression_codec codec;
+
+        // nullptr if there is none.
+        const compression_dictionary *dictionary;
+
+        // the largest packet decompress() will produce.
+        size_t max_raw_size;
+
+        void *range_coder;
+
+        // positions (plus one) in the packet being compressed, and in
+        // the dictionary, keyed by a hash of the 4 bytes found there.
+        std::vector<uint32_t> table;
+        std::vector<uint16_t> dictionary_table;
+
+        atomic<uint64_t> bytes_in, bytes_out;
+
+        size_t __compress_fast(const char *in, size_t size, char *out, size_t out_cap);
+        size_t __decompress_fast(const char *in, size_t size, char *out, size_t raw_size) const;
+
+        FUNGUSUTIL_NO_ASSIGN(compressor)
+    public:
+        static constexpr size_t compressed_marker = ~(size_t)0;
+
+        // packets smaller than this are not worth compressing.
+        static constexpr size_t min_size = 64;
+
+        static constexpr size_t header_size = sizeof(size_t) + sizeof(uint8_t) +
+                                              sizeof(uint32_t) + sizeof(size_t);
+
+        compressor(compression_codec codec, const compression_dictionary *dictionary,
+                   size_t max_raw_size = default_max_decompressed_size);
+        ~compressor();
+
+        inline bool is_enabled() const
+        {
+            return codec != compression_codec::none;
+        }
+
+        // the buffer compress() needs for size bytes, header included.
+        static size_t get_bound(size_t size);
+
+        // compresses size bytes at in in to out, header included.
+        // returns the compressed size, or 0 if compressing would not
+        // make the packet any smaller.
+        size_t compress(const char *in, size_t size, char *out, size_t out_cap,
+                        const endian_converter &endian);
+
+        // true if data starts with a compressed packet header.
+        static bool is_compressed(const char *data, size_t size, const endian_converter &endian);
+
+        // the most a packet can shrink by with codec, so that a header
+        // claiming more can be refused before anything is allocated.
+        static size_t get_max_ratio(compression_codec codec);
+
+        // reads the header.  false if the packet cannot be decompressed
+        // here, because of its codec or dictionary, or because raw_size
+        // is more than max_raw_size or than the codec could have
+        // squeezed in to the packet.
+        bool read_header(const char *data, size_t size, const endian_converter &endian,
+                         size_t &raw_size) const;
+
+        // decompresses a packet whose header has been read in to out,
+        // which holds raw_size bytes.
+        bool decompress(const char *data, size_t size, char *out, size_t raw_size,
+                        const endian_converter &endian);
+
+        // counts a packet of size bytes sent as out bytes.
+        // only the owner thread counts, so no read-modify-write is needed.
+        inline void count(size_t size, size_t out)
+        {
+            bytes_in.store(bytes_in.load(memory_order_relaxed) + size, memory_order_relaxed);
+            bytes_out.store(bytes_out.load(memory_order_relaxed) + out, memory_order_relaxed);
+        }
+
+        // may be called from any thread.
+        inline compression_stats get_stats() const
+        {
+            return compression_stats(bytes_in.load(memory_order_relaxed), bytes_out.load(memory_order_relaxed));
+        }
+    };
+}
+
+#endif
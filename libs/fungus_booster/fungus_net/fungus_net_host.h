@@ -5,6 +5,7 @@
 #include "fungus_net_peer.h"
 #include "fungus_net_message_factory_manager.h"
 #include "fungus_net_authenticator.h"
+#include "fungus_net_compression.h"
 
 namespace fungus_net
 {
@@ -42,7 +43,21 @@ namespace fungus_net
 
             /// Support both networked and memory connections.
             flag_support_both                 = flag_support_memory_connection |
-                                                flag_support_networked_connection
+                                                flag_support_networked_connection,
+
+            /** Let send_message() be called from any thread without taking the host lock.
+              * Messages are placed on a lock-free queue and sent by the next call to dispatch().
+              */
+            flag_concurrent_send              = 0x4,
+
+            /** Service networked connections on an internal thread.
+              * The thread does all socket I/O, aggregation and deserialization, and
+              * dispatch() only picks up the messages and events it has finished, so
+              * dispatch() never waits on the network.  Messages sent over networked
+              * connections are copied, and the copy is serialized by the thread.
+              * Only applicable if flags includes flag_support_networked_connection.
+              */
+            flag_network_thread               = 0x8
         };
 
         /** @{ */
@@ -55,18 +70,64 @@ namespace fungus_net
             uint32_t in_bandwidth;  /**< Maximum incoming bandwidth.  A value of 0 enforces no limit. */
             uint32_t out_bandwidth; /**< Maximum outgoing bandwidth.  A value of 0 enforces no limit. */
 
+            size_t          max_dispatch_events; /**< Maximum network events handled per dispatch().  A value of 0 enforces no limit. */
+            usec_duration_t max_dispatch_usec;   /**< Maximum microseconds spent handling network events per dispatch().  A value of 0 enforces no limit. */
+
+            /** Number of network threads sharing the bound port (see flag_network_thread).
+              * With more than one, each thread owns its own socket bound to the port with
+              * SO_REUSEPORT, and the operating system spreads incoming connections across them.
+              * Outgoing connections are made from one more thread on a port of their own.
+              * Peers, peer_ids and peer groups are shared by every thread, so sending to a
+              * peer group reaches its members whatever thread they are on.  A value greater
+              * than 1 implies flag_network_thread.  If the port cannot be shared, fewer
+              * threads are used.
+              */
+            size_t          shard_count;
+
+            /** Codec used to compress outgoing aggregated packets.  Each packet queued for a
+              * peer on a channel is compressed as a whole, and sent compressed only if that makes
+              * it smaller.  Compressed packets are only accepted by a host whose own codec is not
+              * compression_codec::none, whichever codec it is, so both ends must enable compression.
+              */
+            compression_codec      compression;
+
+            /** Dictionary for compression_codec::fast.  Both ends must use the same one. */
+            compression_dictionary dictionary;
+
+            /** The largest a received compressed packet may expand to.  Larger ones are dropped. */
+            size_t                 max_decompressed_size;
+
             /** Constructor
               *
-              * @param m_ipv4           the ipv4 address to bind the host to.
-              * @param in_bandwidth     maximum incoming bandwidth.  A value of 0 enforces no limit.
-              * @param out_bandwidth    maximum outgoing bandwidth.  A value of 0 enforces no limit.
+              * @param m_ipv4               the ipv4 address to bind the host to.
+              * @param in_bandwidth         maximum incoming bandwidth.  A value of 0 enforces no limit.
+              * @param out_bandwidth        maximum outgoing bandwidth.  A value of 0 enforces no limit.
+              * @param max_dispatch_events  maximum network events handled per dispatch().  A value of 0 enforces no limit.
+              * @param max_dispatch_usec    maximum microseconds spent handling network events per dispatch().
+              *                             A value of 0 enforces no limit.
+              * @param shard_count          number of network threads sharing the bound port.
+              * @param compression          codec used to compress outgoing aggregated packets.
+              * @param dictionary           dictionary for compression_codec::fast.
+              * @param max_decompressed_size  the largest a received compressed packet may expand to.
               */
             inline networked_host_args(const ipv4 &m_ipv4 = ipv4(),
                                        uint32_t in_bandwidth  = 0,
-                                       uint32_t out_bandwidth = 0):
+                                       uint32_t out_bandwidth = 0,
+                                       size_t max_dispatch_events = 0,
+                                       usec_duration_t max_dispatch_usec = 0,
+                                       size_t shard_count = 1,
+                                       compression_codec compression = compression_codec::none,
+                                       const compression_dictionary &dictionary = compression_dictionary(),
+                                       size_t max_decompressed_size = default_max_decompressed_size):
                 m_ipv4(m_ipv4),
                 in_bandwidth(in_bandwidth),
-                out_bandwidth(out_bandwidth)
+                out_bandwidth(out_bandwidth),
+                max_dispatch_events(max_dispatch_events),
+                max_dispatch_usec(max_dispatch_usec),
+                shard_count(shard_count),
+                compression(compression),
+                dictionary(dictionary),
+                max_decompressed_size(max_decompressed_size)
             {}
         };
 
@@ -94,6 +155,18 @@ namespace fungus_net
 
         /** @} */
 
+        /// Statistics describing the work done by the last call to dispatch().
+        struct FUNGUSNET_API dispatch_stats
+        {
+            size_t events_processed; /**< Number of low level connection events handled. */
+            size_t events_remaining; /**< Number of events left queued because the dispatch budget ran out. */
+
+            inline dispatch_stats(size_t events_processed = 0, size_t events_remaining = 0):
+                events_processed(events_processed),
+                events_remaining(events_remaining)
+            {}
+        };
+
         /** An event structure represents an event that occured
           * during a call of dispatch() for this host.
           */
@@ -446,6 +519,10 @@ namespace fungus_net
         /** @{ */
 
         /** Retrieves a peer by its handle.
+          *
+          * Like is_running() and get_max_peers(), this does not take the host lock, so it
+          * may be called from any thread without waiting for dispatch().  The peer may be
+          * destroyed by the next dispatch() or stop() on another thread.
           *
           * @param  m_id        the peer_id for the peer to retrieve.
           * @retval == nullptr  no peer exists on this host for this peer_id.
@@ -454,6 +531,10 @@ namespace fungus_net
               peer *get_peer(peer_id m_id);
 
         /** Retrieves a peer by its handle.
+          *
+          * Like is_running() and get_max_peers(), this does not take the host lock, so it
+          * may be called from any thread without waiting for dispatch().  The peer may be
+          * destroyed by the next dispatch() or stop() on another thread.
           *
           * @param  m_id        the peer_id for the peer to retrieve.
           * @retval == nullptr  no peer exists on this host for this peer_id.
@@ -619,6 +700,43 @@ namespace fungus_net
         /** @} */
         /** @{ */
 
+        /** Send a message to the peer or peer group at a peer_id handle.
+          *
+          * The host takes ownership of the message, and destroys it if it cannot be sent.
+          *
+          * If the host was started with flag_concurrent_send, this may be called from any
+          * thread while the host is running.  The message is placed on a lock-free queue
+          * and sent by the next call to dispatch(), so it does not contend with dispatch()
+          * or with other threads for the host lock.  Messages queued by one thread are sent
+          * in the order they were queued.  If the queue is full, the host lock is taken, the
+          * queue is emptied and the message is sent immediately.  A queued message whose
+          * peer is gone or not connected by the time it is sent is silently destroyed.
+          *
+          * Otherwise the message is sent immediately, as if by peer::send_message().
+          *
+          * @param m_id         The peer_id handle to the peer or peer group to send the message to.
+          * @param m_message    The message to send.
+          *
+          * @retval true    the message was sent or queued.
+          * @retval false   on failure.
+          */
+        bool send_message(peer_id m_id, const message *m_message);
+
+        /** Send a message to the peer or peer group at a peer_id handle, excluding
+          * the concrete peers referenced by another.  See send_message(peer_id, const message *).
+          *
+          * @param m_id             The peer_id handle to the peer or peer group to send the message to.
+          * @param m_message        The message to send.
+          * @param m_exclusion_id   The peer_id handle to a peer or peer group representing the other host(s) to exclude.
+          *
+          * @retval true    the message was sent or queued.
+          * @retval false   on failure.
+          */
+        bool send_message(peer_id m_id, const message *m_message, peer_id m_exclusion_id);
+
+        /** @} */
+        /** @{ */
+
         /** Dispatch all.
           *
           * This function must be called frequently in order to acheive good networking performance
@@ -626,11 +744,65 @@ namespace fungus_net
           * all messages in outgoing queues, throw events, recycle all unused peer_ids, and handle
           * state changes for each peer.
           *
+          * All pending network events are handled, subject to the budget given by
+          * networked_host_args::max_dispatch_events and networked_host_args::max_dispatch_usec.
+          * Anything left over is handled by the next call.
+          *
           * @retval true    on success.
           * @retval false   on failure.
           */
         bool dispatch();
 
+        /** Wait for work, then dispatch all.
+          *
+          * Sleeps until dispatch() has something to do, or until timeout runs out, and then
+          * calls dispatch().  The host wakes for datagrams arriving on the network, messages
+          * arriving from memory connections, messages sent from other threads with
+          * send_message(), and the next connection, disconnection, authentication or network
+          * protocol deadline.  The host lock is not held while sleeping.
+          *
+          * Only one thread may wait on a host at a time, and never from inside another call to
+          * the host, such as a host callback.  Such a call fails without waiting or dispatching.
+          *
+          * @param timeout  the longest time to sleep in seconds.  A negative value sleeps
+          *                 until there is work.
+          *
+          * @retval true    on success.
+          * @retval false   on failure.
+          */
+        bool dispatch_wait(sec_duration_t timeout = -1);
+
+        /** Wait for work, then dispatch all.
+          *
+          * The same as dispatch_wait(), with the timeout given in whole nanoseconds, as
+          * monotonic_clock counts them.
+          *
+          * @param timeout  the longest time to sleep in nanoseconds.  A negative value sleeps
+          *                 until there is work.
+          *
+          * @retval true    on success.
+          * @retval false   on failure.
+          */
+        bool dispatch_wait_nsec(nsec_duration_t timeout);
+
+        /** Get statistics for the last call to dispatch().
+          *
+          * @param m_stats  a mutable reference to a dispatch_stats structure to be filled.
+          *
+          * @retval true    on success.
+          * @retval false   if the host is not running.
+          */
+        bool get_dispatch_stats(dispatch_stats &m_stats) const;
+
+        /** Get totals for the compression of outgoing packets since the host was started.
+          *
+          * @param m_stats  a mutable reference to a compression_stats structure to be filled.
+          *
+          * @retval true    on success.
+          * @retval false   if the host is not running.
+          */
+        bool get_compression_stats(compression_stats &m_stats) const;
+
         /** Get the next event in the event queue and pop it off of the queue.
           *
           * @param m_event  a mutable reference to an event structure to be filled with data concerning the event.
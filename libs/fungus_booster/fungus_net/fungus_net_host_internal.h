@@ -6,6 +6,8 @@
 #include "fungus_net_authenticator_internal.h"
 #include "fungus_net_message_intercept.h"
 
+#include "../fungus_concurrency/fungus_concurrency_ring_buffer.h"
+
 namespace fungus_net
 {
     using namespace fungus_util;
@@ -180,8 +182,8 @@ namespace fungus_net
             }
         };
 
-        block_allocator<peer_concrete, 1024> m_peer_concrete_allocator;
-        block_allocator<peer_group,    1024> m_peer_group_allocator;
+        fungus_concurrency::concurrent_block_allocator<peer_concrete, 1024> m_peer_concrete_allocator;
+        fungus_concurrency::concurrent_block_allocator<peer_group,    1024> m_peer_group_allocator;
 
         optional<unified_host>    m_unified_host;
         unified_host::common_data m_common_data;
@@ -189,22 +191,41 @@ namespace fungus_net
         peer_group *m_group_all;
 
         // mapped concrete peers (directly related to 1 low level peer object).
-        typedef hash_map<default_hash_no_replace<unified_host::peer *, peer_concrete *, hash_entry_ptr_no_delete>> peer_by_unified_peer_map;
-        typedef hash_map<default_hash_no_replace<peer_id,              peer_concrete *, hash_entry_ptr_no_delete>> peer_by_id_map;
-        typedef hash_map<default_hash_no_replace<peer_id,              peer_group *,    hash_entry_ptr_no_delete>> group_by_id_map;
-        typedef hash_map<default_hash_no_replace<peer_id,              peer *,          hash_entry_ptr_no_delete>> virtual_peer_by_id_map;
-        typedef hash_map<default_hash_no_replace<peer_concrete *,      _s_nil                                   >> peer_concrete_map;
+        typedef flat_hash_map<default_hash_no_replace<unified_host::peer *, peer_concrete *, hash_entry_ptr_no_delete>> peer_by_unified_peer_map;
+        typedef flat_hash_map<default_hash_no_replace<peer_id,              peer_concrete *, hash_entry_ptr_no_delete>> peer_by_id_map;
+        typedef flat_hash_map<default_hash_no_replace<peer_id,              peer_group *,    hash_entry_ptr_no_delete>> group_by_id_map;
+        typedef flat_hash_map<default_hash_no_replace<peer_id,              peer *,          hash_entry_ptr_no_delete>> virtual_peer_by_id_map;
+        typedef flat_hash_map<default_hash_no_replace<peer_concrete *,      _s_nil                                   >> peer_concrete_map;
 
         peer_by_unified_peer_map m_peers_by_unified_peer;
         peer_by_id_map           m_peers_by_id;
         peer_concrete_map        m_peers_authenticating;
 
+        // authenticating peers ordered by auth timeout deadline, and the
+        // ones that received payloads during the current dispatch.
+        typedef timeout_queue<peer_concrete, &peer_concrete::m_auth_timeout> auth_timeout_queue;
+
+        auth_timeout_queue           m_auth_timeouts;
+        std::vector<peer_concrete *> m_peers_with_payloads;
+
         // mapped peer groups (virtual peers that represent a group of concrete peers and/or other groups.
         group_by_id_map m_groups_by_id;
 
         // map of all peers virtualized (concrete/group).
         virtual_peer_by_id_map m_virtual_peers_by_id;
 
+        // the read-only queries of host take this instead of the host
+        // lock, so they don't wait on dispatch().  it guards
+        // m_virtual_peers_by_id, b_running and the policy: whatever
+        // changes them holds the host lock and a write lock, so code under
+        // the host lock reads them without either.  nothing is called out
+        // to under a write lock.
+        mutable rw_mutex m_reader_mutex;
+        bool b_running;
+
+        inline void publish_peer(peer_id m_id, peer *m_peer);
+        inline void unpublish_peer(peer_id m_id);
+
         message_intercept::map m_intercept_map; // map of active message intercepts.
                                                 // recursively stacked hash table is used for lookups.
         event_queue            m_event_queue;   // event queue.
@@ -220,6 +241,42 @@ namespace fungus_net
         // timeout period table
         sec_duration_t m_timeout_periods[timeout_period_type::count];
 
+        // the monotonic_clock reading shared by the current dispatch.
+        nsec_duration_t m_dispatch_time;
+
+        // block sets left free for this long are given back by dispatch().
+        static constexpr nsec_duration_t reclaim_period = 1000000000LL;
+        nsec_duration_t m_reclaim_time;
+
+        inline void reclaim_memory(bool b_trim);
+
+        // messages handed to host::send_message() under flag_concurrent_send,
+        // waiting for dispatch().  producers never take the host lock.
+        struct submission
+        {
+            const message *m_message;
+            peer_id        m_id;
+            peer_id        m_exclusion_id;
+            bool           b_exclusion;
+        };
+
+        fungus_concurrency::mpsc_ring<submission> m_submissions;
+        atomic<bool> m_concurrent_send;
+
+        // what dispatch_wait() sleeps on.  outlives m_unified_host.
+        poller m_poller;
+
+        // ends a dispatch_wait() on another thread.  anything that gives
+        // dispatch() work under the host lock may call it at any point,
+        // since the waiter takes the lock before looking again.
+        FUNGUSUTIL_ALWAYS_INLINE inline void wake()
+        {
+            m_poller.notify();
+        }
+
+        inline void drain_submissions();
+        inline void discard_submissions();
+
         inline peer_id alloc_peer_id();
         inline void    free_peer_id(peer_id m_id);
         inline void    garbage_collect_peer_ids();
@@ -230,6 +287,9 @@ namespace fungus_net
 
         inline peer_group *create_group_internal(peer_id m_id);
 
+        inline void begin_authenticating(peer_concrete *m_peer_concrete);
+        inline void end_authenticating(peer_concrete *m_peer_concrete);
+
         // unified host event processing
         inline void process_unified_host_connected(const unified_host::event &m_unified_host_event, peer_concrete *m_peer_concrete);
         inline void process_unified_host_disconnected(const unified_host::event &m_unified_host_event, peer_concrete *m_peer_concrete);
@@ -287,7 +347,29 @@ namespace fungus_net
         bool disconnect(peer *m_peer, uint32_t data, const peer *m_exclusion);
         bool disconnect(peer_id m_id, uint32_t data, peer_id m_exclusion_id);
 
+        // called under the host lock.
+        bool send_message(peer_id m_id, const message *m_message, const peer_id *m_exclusion_id);
+
+        // may be called from any thread.  fails if the host is not in
+        // concurrent send mode or the queue is full, leaving m_message alone.
+        bool submit_message(peer_id m_id, const message *m_message, const peer_id *m_exclusion_id);
+
+        // called under the host lock, so a failed submit_message() does
+        // not overtake messages that are already queued.
+        void flush_submissions();
+
         bool dispatch();
+        bool get_dispatch_stats(dispatch_stats &m_stats) const;
+        bool get_compression_stats(compression_stats &m_stats) const;
+
+        // called under the host lock by dispatch_wait().  arms the poller
+        // and returns true if the caller should wait, lowering timeout
+        // to the next deadline.  returns false, disarmed, if dispatch()
+        // has work now or the host is not running.
+        bool begin_wait(nsec_duration_t &timeout);
+        void end_wait();
+
+        poller &get_poller();
 
         bool next_event(event &m_event);
         bool peek_event(event &m_event) const;
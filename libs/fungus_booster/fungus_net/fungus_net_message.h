@@ -145,8 +145,10 @@ namespace fungus_net
           * If a message has been marked as read, any clones
           * will be skipped and destroyed on any calls to
           * peer::receive_message().  On receipt of a message,
-          * all duplicates waiting in any peer groups, including
-          * the all_peer_id group will be clones.
+          * it is shared by the queues of every peer group that
+          * references the sender, including the all_peer_id
+          * group.  peer::receive_message() hands out a clone of
+          * it unless no other queue still holds it.
           */
         virtual void mark_as_read();
 
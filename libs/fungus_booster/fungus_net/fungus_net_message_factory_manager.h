@@ -70,6 +70,34 @@ namespace fungus_net
         /// Clear all factories in the map.
         void clear_factories();
 
+        /** Compile the map in to an immutable lookup table.
+          * Until the map is frozen, every call to get_factory()
+          * takes a lock and searches the map.  Once frozen,
+          * get_factory() takes no lock and small non-negative
+          * message_types are found with a single array lookup.
+          * Factories may still be added or removed afterwards.
+          * A removed factory is kept until unfreeze(), since a
+          * reader may still hold it, and an addition the table has
+          * no slot for recompiles it.  Only a bounded number of
+          * recompilations are allowed before add_factory() fails,
+          * so this should be done sparingly.  The host freezes its
+          * map when started.
+          */
+        void freeze();
+
+        /** Undo freeze(), freeing the lookup tables and any factory
+          * removed since.  Only safe when no other thread can be in
+          * get_factory().  The host unfreezes its map when stopped.
+          */
+        void unfreeze();
+
+        /** Check whether freeze() has been called.
+          *
+          * @retval true    the map has been frozen
+          * @retval false   the map has not been frozen
+          */
+        bool is_frozen() const;
+
         /** @} */
 
         /** Get the factory associated with a message_type.
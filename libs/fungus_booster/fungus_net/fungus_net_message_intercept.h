@@ -100,7 +100,10 @@ namespace fungus_net
 
         bool    has(const message_intercept &m_intercept) const;
 
-        bool intercept(message *m_message, peer_id sender_id, peer *m_peer);
+        // intercepts() only looks; intercept() marks m_message as read and
+        // takes it over, so the caller can decide what to hand it.
+        bool intercepts(message_type m_type, const peer *m_peer) const;
+        void intercept(message *m_message, peer_id sender_id, peer *m_peer);
         bool next_intercepted_message(intercepted_message &m_intercepted);
     };
 }
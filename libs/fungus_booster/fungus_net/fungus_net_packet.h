@@ -16,13 +16,19 @@
 
 #include "fungus_net_message.h"
 #include "fungus_net_message_factory_manager.h"
+#include "fungus_net_compression.h"
+
+#include "../fungus_concurrency/fungus_concurrency_block_allocator.h"
 
 #include <queue>
+#include <vector>
 
 namespace fungus_net
 {
     using namespace fungus_util;
 
+    class compressor;
+
     class packet
     {
     public:
@@ -49,7 +55,21 @@ namespace fungus_net
         serializer *s;
         serializer_buf buf;
 
-        friend class block_allocator<packet, 1024>;
+        // ds or s, whichever the destination calls for, is made in here
+        // rather than on the heap.  its buffer comes from the thread's
+        // buffer_pool.
+        typename std::aligned_storage
+            <(sizeof(serializer) > sizeof(deserializer) ? sizeof(serializer) : sizeof(deserializer)),
+             (std::alignment_of<serializer>::value > std::alignment_of<deserializer>::value ?
+              std::alignment_of<serializer>::value : std::alignment_of<deserializer>::value)>::type
+            stream_storage;
+
+        // incoming packets either own their bytes in buf or
+        // borrow them from the ENetPacket they were carved out
+        // of, which stays alive until every borrower is gone.
+        ENetPacket *source;
+
+        friend class fungus_concurrency::concurrent_block_allocator<packet, 1024>;
 
         packet();
         ~packet();
@@ -60,6 +80,10 @@ namespace fungus_net
                                  stream_mode smode, uint8_t channel,
                                  const endian_converter &endian);
 
+        bool initialize_incoming(ENetPacket *source, size_t offset, size_t size,
+                                 stream_mode smode, uint8_t channel,
+                                 const endian_converter &endian);
+
         bool        switch_destination(const endian_converter &endian);
         destination get_destination() const;
         bool        is_initialized() const;
@@ -69,15 +93,26 @@ namespace fungus_net
 
         message    *make_message(message_factory_manager *factory_manager);
 
-        static void set_guard_word(int word);
+        // false, leaving the guard word as it was, if word does not fit
+        // in 16 bits or is 0xFFFF, which starts every compressed packet.
+        static bool set_guard_word(int word);
+
+        static void grab_source(ENetPacket *source);
+        static void drop_source(ENetPacket *source);
     private:
         static uint16_t guard_word;
 
+        void __drop_serializer();
+        void __drop_deserializer();
+
+        bool __check_guard_word();
+
     public:
         typedef std::pair<packet *, ENetPeer *> packet_ref;
 
         class aggregator;
         class separator;
+        class shared_message;
     };
 
     template <packet::stream_mode __smode>
@@ -95,23 +130,81 @@ namespace fungus_net
         static inline constexpr uint32_t get_flags();
     };
 
+    // a message serialized once, in the lone message format, so that it
+    // can be queued for any number of peers.  the bytes live in an
+    // ENetPacket that every peer it is sent to shares; enet frees it once
+    // the last of them is done with it and the shared_message is gone.
+    //
+    // an ENetPacket's reference count is not atomic, so the packet may
+    // only be used on one thread.  one made by make() belongs to no
+    // aggregator, and copy_packet() gives out copies for other threads.
+    class packet::shared_message
+    {
+    private:
+        ENetPacket *pk;
+        stream_mode smode;
+        uint8_t     channel;
+
+        friend class aggregator;
+
+        FUNGUSUTIL_NO_ASSIGN(shared_message)
+    public:
+        shared_message();
+        ~shared_message();
+
+        bool        is_initialized() const;
+        stream_mode get_stream_mode() const;
+        uint8_t     get_channel() const;
+
+        bool make(const endian_converter &endian, const message *m_message);
+
+        // nullptr on failure.  the copy's reference count starts at 0.
+        ENetPacket *copy_packet() const;
+    };
+
     class packet::aggregator
     {
     private:
-        block_allocator<packet, 1024> m_allocator;
+        class buffer_pool;
+
+        fungus_concurrency::concurrent_block_allocator<packet, 1024> m_allocator;
         const endian_converter &endian;
-        std::queue<packet_ref> packets;
+        buffer_pool *m_pool;
+        compressor  *m_compressor;
 
+        // each message is serialized exactly once, straight in to the
+        // aggregate for its (peer, channel, stream mode), framed by a
+        // size word that is patched in afterwards.  The finished buffer
+        // is then handed to enet without being copied.
         class aggregate_serializer_base
         {
         protected:
             bool used;
+            size_t count;
             serializer s;
+            buffer_pool *m_pool;
+            compressor  *m_compressor;
+
+            // while a shared message is the only thing queued, it is
+            // held by reference and sent as is.  anything queued after
+            // it copies it in to s first.
+            ENetPacket *lone_shared;
+
+            void __append_shared(ENetPacket *pk);
+            void __unshare();
+            void __hand_to_enet(ENetPeer *peer, uint8_t channel, uint32_t flags);
         public:
-            aggregate_serializer_base(const endian_converter &endian);
-			virtual ~aggregate_serializer_base() {}
+            aggregate_serializer_base(const endian_converter &endian, buffer_pool *m_pool,
+                                      compressor *m_compressor);
+            virtual ~aggregate_serializer_base();
 
             virtual serializer &get();
+
+            void write_message(const message *m_message);
+            void write_buf(const serializer_buf &buf);
+            void write_shared(ENetPacket *pk);
+            void discard();
+
             virtual void send(ENetPeer *peer, uint8_t channel) = 0;
         };
 
@@ -119,7 +212,8 @@ namespace fungus_net
         class aggregate_serializer: public aggregate_serializer_base
         {
         public:
-            aggregate_serializer(const endian_converter &endian);
+            aggregate_serializer(const endian_converter &endian, buffer_pool *m_pool,
+                                 compressor *m_compressor);
 
             virtual void send(ENetPeer *peer, uint8_t channel);
         };
@@ -127,79 +221,161 @@ namespace fungus_net
         class aggregate
         {
         private:
-            const endian_converter   &endian;
-            aggregate_serializer_base   *seq;
-            aggregate_serializer_base *unseq;
+            aggregate_serializer<stream_mode::sequenced>     seq;
+            aggregate_serializer<stream_mode::unsequenced> unseq;
 
+            FUNGUSUTIL_NO_ASSIGN(aggregate)
         public:
             ENetPeer   *peer;
             uint8_t     channel;
 
-            aggregate(std::pair<ENetPeer *, uint8_t> &pair, const endian_converter &endian);
-
-            aggregate(const aggregate &agg);
-            aggregate(aggregate &&agg);
+            // true while the aggregate is on its peer's queued list.
+            bool        queued;
 
+            aggregate(ENetPeer *peer, uint8_t channel, const endian_converter &endian,
+                      buffer_pool *m_pool, compressor *m_compressor);
             ~aggregate();
 
-            aggregate &operator =(const aggregate &agg);
-            aggregate &operator =(aggregate &&agg);
-
+            aggregate_serializer_base &get_aggregate_serializer(stream_mode smode);
             serializer &get_serializer(stream_mode smode);
             void send();
+            void discard();
         };
 
+        // aggregation state outlives send_all(), so that the aggregates
+        // (and their serializers) of a peer are made once and reset after
+        // every flush.  Only aggregates with something queued are visited
+        // by send_all().  A peer's state is freed by forget_peer().
         class aggregate_map
         {
         private:
             const endian_converter &endian;
+            buffer_pool *m_pool;
+            compressor  *m_compressor;
 
-        public:
-            typedef hash_map<default_hash<uint8_t,    aggregate>, UINT8_MAX * 2> map_agg_type;
-            typedef hash_map<default_hash<ENetPeer *, map_agg_type>>             map_peer_type;
+            struct peer_aggregates
+            {
+                ENetPeer  *peer;
 
-            map_peer_type aggs;
+                // indexed by channel, nullptr until the channel is used.
+                aggregate *channels[UINT8_MAX + 1];
 
-            aggregate_map(const endian_converter &endian);
+                std::vector<aggregate *> queued;
+
+                peer_aggregates(ENetPeer *peer);
+                ~peer_aggregates();
+
+                void send_all();
+                void discard_all();
+            };
+
+            typedef hash_map<default_hash<ENetPeer *, peer_aggregates *, hash_entry_ptr_no_delete>> map_peer_type;
+
+            map_peer_type                  peers;
+            std::vector<peer_aggregates *> queued_peers;
+
+            FUNGUSUTIL_NO_ASSIGN(aggregate_map)
+        public:
+            aggregate_map(const endian_converter &endian, buffer_pool *m_pool, compressor *m_compressor);
             ~aggregate_map();
 
-            aggregate &get_aggregate(std::pair<ENetPeer *, uint8_t> &&pair);
+            // the aggregate for (peer, channel), queued for the next send_all().
+            aggregate &get_aggregate(ENetPeer *peer, uint8_t channel);
+
+            bool any_queued() const;
 
             void send_all();
+            void discard_all();
+
+            void forget_peer(ENetPeer *peer);
             void clear();
         };
 
+        aggregate_map m_aggs;
+
     public:
-        aggregator(const endian_converter &endian);
+        // every aggregate is compressed with codec before it is sent,
+        // if that makes it smaller.  dictionary must outlive the aggregator.
+        aggregator(const endian_converter &endian,
+                   compression_codec codec = compression_codec::none,
+                   const compression_dictionary *dictionary = nullptr);
+        ~aggregator();
 
         packet *create_packet();
         bool destroy_packet(packet *pk);
 
+        // serializes m_message directly in to the outgoing aggregate.
+        bool queue_message(const message *m_message, ENetPeer *peer);
+
+        // copies an already initialized outgoing packet in to the
+        // outgoing aggregate and destroys it.
         void queue_packet(packet *pk, ENetPeer *peer);
 
+        // serializes m_message in to m_shared, which can then be queued
+        // for as many peers as needed without serializing it again.
+        bool make_shared(const message *m_message, shared_message &m_shared);
+        void queue_shared(const shared_message &m_shared, ENetPeer *peer);
+
+        // queues a packet made by shared_message::copy_packet(), taking
+        // a reference of its own.
+        void queue_shared(ENetPacket *pk, stream_mode smode, uint8_t channel, ENetPeer *peer);
+
+        // true if send_all() has anything to send.
+        bool packets_queued() const;
+
         void send_all();
         void clear();
+
+        // drops anything queued for peer and frees its aggregation
+        // state, once the peer has disconnected or been reset.
+        void forget_peer(ENetPeer *peer);
+
+        // may be called from any thread.
+        compression_stats get_compression_stats() const;
+
+        // gives back packet blocks left free since the last call, or with
+        // b_trim every free one; see concurrent_block_allocator::reclaim().
+        // may be called from any thread.  returns the number of bytes freed.
+        size_t reclaim(bool b_trim);
     };
 
     class packet::separator
     {
     private:
-        block_allocator<packet, 1024> m_allocator;
+        fungus_concurrency::concurrent_block_allocator<packet, 1024> m_allocator;
         const endian_converter &endian;
+        compressor *m_compressor;
 
         std::queue<packet *> packets;
 
-        bool create_packet(serializer_buf &buf, stream_mode smode, uint8_t channel);
+        bool create_packet(ENetPacket *source, size_t offset, size_t size,
+                           stream_mode smode, uint8_t channel);
+
+        bool __separate(ENetPacket *source, uint8_t channel);
+        bool __decompress(ENetPacket *source, ENetPacket *&raw);
     public:
-        separator(const endian_converter &endian);
+        // compressed packets are only taken apart if codec is not none;
+        // otherwise they are dropped like any other malformed packet.
+        // dictionary must be the one the sending aggregator used, and
+        // must outlive the separator.  packets that would decompress to
+        // more than max_raw_size bytes are dropped.
+        separator(const endian_converter &endian,
+                  compression_codec codec = compression_codec::none,
+                  const compression_dictionary *dictionary = nullptr,
+                  size_t max_raw_size = default_max_decompressed_size);
         ~separator();
 
         bool destroy_packet(packet *pk);
 
+        // takes ownership of source; it is destroyed once every
+        // packet carved out of it has been destroyed.
         bool separate_packets(ENetPacket *source, uint8_t channel);
 
         bool packets_waiting() const;
         packet *get_packet();
+
+        // as aggregator::reclaim().
+        size_t reclaim(bool b_trim);
     };
 };
 
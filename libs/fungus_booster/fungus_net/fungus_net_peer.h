@@ -127,6 +127,61 @@ namespace fungus_net
             incoming_message(message *m_message, peer_id sender_id);
         };
 
+        /** A counted reference to an incoming message.  A received message is
+          * stored once and shared by the queues of the concrete peer that received
+          * it and of every peer group that references that peer.  Reading it
+          * through a shared_incoming_message never copies or clones it; the message
+          * is destroyed once no queue or shared_incoming_message refers to it.
+          */
+        class FUNGUSNET_API shared_incoming_message
+        {
+        public:
+            class impl;
+        private:
+            impl *pimpl_;
+
+            friend class peer_base;
+        public:
+            /// Constructor.  Refers to no message.
+            shared_incoming_message();
+
+            /** Copy constructor
+              *
+              * @param m_shared the shared_incoming_message to share the reference of.
+              */
+            shared_incoming_message(const shared_incoming_message &m_shared);
+
+            /// Destructor.  Drops the reference, if any.
+            ~shared_incoming_message();
+
+            /** Assignment operator.  Drops the current reference and shares the reference
+              * of m_shared.
+              *
+              * @param m_shared the shared_incoming_message to share the reference of.
+              */
+            shared_incoming_message &operator =(const shared_incoming_message &m_shared);
+
+            /** Get the message referred to.
+              *
+              * @returns the message, or nullptr if this refers to no message.
+              */
+            const message *get_message() const;
+
+            /** Get the concrete peer representing the host that sent the message.
+              *
+              * @returns the peer_id of the sender, or null_peer_id if this refers to no message.
+              */
+            peer_id get_sender_id() const;
+
+            /** Mark the message as read.  It will be skipped by every queue that still
+              * holds it, exactly as if message::mark_as_read() had been called on a clone.
+              */
+            void mark_as_read();
+
+            /// Drop the reference, if any.
+            void reset();
+        };
+
     protected:
         peer();
         virtual ~peer();
@@ -330,6 +385,19 @@ namespace fungus_net
           */
         virtual bool     receive_message(incoming_message &m_in)                                   = 0;
 
+        /** Retrieve the next message waiting in the incoming message queue of this peer as a
+          * shared_incoming_message.  The same messages are retrieved as with receive_message(), but the
+          * message is not handed over: every queue that received it shares the one instance, so no clone
+          * or copy is ever made.  Call shared_incoming_message::mark_as_read() to keep it from being
+          * retrieved from the other queues.
+          *
+          * @param m_shared a reference to the shared_incoming_message in which to place the reference.
+          *
+          * @retval true    the next message waiting in the queue was placed in m_shared and popped off of the queue.
+          * @retval false   no messages were waiting in the queue, and m_shared was reset.
+          */
+        virtual bool     receive_shared_message(shared_incoming_message &m_shared)                  = 0;
+
         /** Discard the next message waiting in the incoming message queue of this peer, if any.  This
           * should never be used in robust code, but is included for completeness.
           */
@@ -14,6 +14,68 @@ namespace fungus_net
 {
     using namespace fungus_util;
 
+    // a received message, stored once and shared by every queue it was
+    // delivered to.  the message is only cloned if a queue hands it out
+    // while another queue still holds it.
+    class peer::shared_incoming_message::impl
+    {
+    private:
+        message *m_message;
+        peer_id  sender_id;
+        size_t   nrefs;
+
+        FUNGUSUTIL_NO_ASSIGN(impl)
+    public:
+        inline impl(const incoming_message &m_in):
+            m_message(m_in.m_message), sender_id(m_in.sender_id), nrefs(1)
+        {}
+
+        inline ~impl()
+        {
+            if (m_message)
+                delete m_message;
+        }
+
+        inline void grab()
+        {
+            ++nrefs;
+        }
+
+        inline void drop()
+        {
+            if (--nrefs == 0)
+                delete this;
+        }
+
+        inline bool is_read() const
+        {
+            return !m_message || m_message->marked_as_read();
+        }
+
+        inline const message *get_message() const {return m_message;}
+        inline peer_id        get_sender_id() const {return sender_id;}
+
+        inline void mark_as_read()
+        {
+            if (m_message)
+                m_message->mark_as_read();
+        }
+
+        // hands the message over; the last holder gets the message itself.
+        inline message *take()
+        {
+            message *m_taken = m_message;
+            if (nrefs > 1)
+                m_taken = m_message->clone();
+            else
+                m_message = nullptr;
+
+            return m_taken;
+        }
+    };
+
+    typedef peer::shared_incoming_message::impl shared_incoming;
+
     class peer_base: public peer, public multi_tree_node<peer_base>
     {
     protected:
@@ -23,7 +85,9 @@ namespace fungus_net
         peer_id  m_id;
         any_type m_data;
 
-        std::queue<incoming_message> m_message_queue_in;
+        std::queue<shared_incoming *> m_message_queue_in;
+
+        void deliver(shared_incoming *m_shared);
     public:
         peer_base(peer_base &&m_peer)                  = delete;
         peer_base(const peer_base &m_peer)             = delete;
@@ -63,6 +127,7 @@ namespace fungus_net
         virtual bool     has_peer(peer *m_peer)   const;
 
         virtual bool     receive_message(incoming_message &m_in);
+        virtual bool     receive_shared_message(shared_incoming_message &m_shared);
         virtual bool     disconnect(uint32_t data, const peer *m_exclusion = nullptr) = 0;
 
         virtual void     discard_message();
@@ -99,8 +164,6 @@ namespace fungus_net
         mode m_mode;
         unified_host::peer *m_unified_peer;
 
-        timestamp m_timeout_start;
-
         std::queue<auth_payload *> m_payloads_in;
         std::queue<auth_payload *> m_payloads_out;
 
@@ -125,12 +188,13 @@ namespace fungus_net
 
         virtual ~peer_concrete();
 
+        // armed by the host while authenticating; re-armed whenever a payload arrives.
+        timeout_node m_auth_timeout;
+
         FUNGUSUTIL_ALWAYS_INLINE inline
-        sec_duration_t auth_timeout_period()
+        bool has_payloads() const
         {
-            return m_state == state::authenticating                                           ?
-                   usec_duration_to_sec(timestamp(timestamp::current_time) - m_timeout_start) :
-                   0.0;
+            return !m_payloads_in.empty();
         }
 
         virtual void push_incoming_message(const incoming_message &m_in);
@@ -138,6 +202,9 @@ namespace fungus_net
         virtual bool send_message(const message *m_message, const peer *m_exclusion = nullptr);
         virtual bool disconnect(uint32_t data, const peer *m_exclusion = nullptr);
 
+        // used by peer_group to send one message to all of its members.
+        bool send_broadcast(unified_host::broadcast &m_broadcast);
+
         FUNGUSUTIL_ALWAYS_INLINE inline
         unified_host::peer *get_unified_peer()
         {
@@ -0,0 +1,68 @@
+#ifndef FUNGUSNET_POLLER_INTERNAL_H
+#define FUNGUSNET_POLLER_INTERNAL_H
+
+#include "fungus_net_defs_internal.h"
+
+#include <vector>
+
+namespace fungus_net
+{
+    using namespace fungus_util;
+
+    // lets the thread in host::dispatch_wait() sleep until dispatch()
+    // has work.
+    //
+    // anything that hands the host work calls notify().  the poller can
+    // also watch notifiers owned by others and the sockets the host
+    // reads.  a waiter calls arm(), checks for work, and then either
+    // wait()s or disarm()s; anything notified after arm() ends the
+    // wait.  only one thread may be armed at a time.
+    //
+    // on linux this is one epoll set holding the sockets and an eventfd
+    // that every watched notifier writes to while armed.  elsewhere the
+    // poller sleeps on its own notifier, and looks at the sockets and
+    // other notifiers only every slice_period.
+    class poller
+    {
+    private:
+        notifier                 m_activity;
+        std::vector<notifier *>  m_watched;
+        std::vector<ENetSocket>  m_sockets;
+        bool                     b_armed;
+
+#ifdef __linux__
+        int epoll_fd;
+        int event_fd;
+#else
+        int epoch;
+#endif
+
+        FUNGUSUTIL_NO_ASSIGN(poller)
+    public:
+        static constexpr nsec_duration_t slice_period = 1000000;
+
+        poller();
+        ~poller();
+
+        FUNGUSUTIL_ALWAYS_INLINE inline void notify()
+        {
+            m_activity.notify();
+        }
+
+        void watch(notifier &m_notifier);
+        bool watch(ENetSocket socket);
+
+        // must be called before anything watched goes away.
+        void unwatch_all();
+
+        void arm();
+        void disarm();
+
+        // sleeps until notified, a socket is readable or timeout runs
+        // out (negative waits forever).  may return early, so the caller
+        // should just dispatch afterwards.  the caller disarms.
+        void wait(nsec_duration_t timeout);
+    };
+}
+
+#endif
@@ -0,0 +1,189 @@
+#ifndef FUNGUSNET_TIMEOUT_INTERNAL_H
+#define FUNGUSNET_TIMEOUT_INTERNAL_H
+
+#include "fungus_net_defs_internal.h"
+
+#include <vector>
+
+namespace fungus_net
+{
+    using namespace fungus_util;
+
+    // embedded in anything that can time out.  the deadline is on the
+    // monotonic_clock, and period_type says which of the timeout periods
+    // it was armed for.
+    struct timeout_node
+    {
+        static constexpr size_t npos = (size_t)-1;
+
+        size_t              heap_index;
+        nsec_duration_t     deadline;
+        timeout_period_type period_type;
+
+        timeout_node():
+            heap_index(npos), deadline(0), period_type(timeout_period_type::count)
+        {}
+
+        FUNGUSUTIL_ALWAYS_INLINE inline bool is_armed() const
+        {
+            return heap_index != npos;
+        }
+    };
+
+    // lowers timeout (negative is none) to t.
+    FUNGUSUTIL_ALWAYS_INLINE inline void lower_timeout(nsec_duration_t &timeout, nsec_duration_t t)
+    {
+        if (timeout < 0 || t < timeout)
+            timeout = t;
+    }
+
+    // a binary min-heap of objects keyed by their timeout deadline.
+    // one queue holds every timeout_period_type, so a dispatch only
+    // looks at the front of the queue instead of scanning every peer.
+    // objects must be disarmed before they are destroyed.
+    template <typename T, timeout_node T::*node>
+    class timeout_queue
+    {
+    private:
+        std::vector<T *> heap;
+
+        FUNGUSUTIL_ALWAYS_INLINE inline nsec_duration_t deadline_at(size_t i) const
+        {
+            return (heap[i]->*node).deadline;
+        }
+
+        FUNGUSUTIL_ALWAYS_INLINE inline void place(size_t i, T *m_obj)
+        {
+            heap[i] = m_obj;
+            (m_obj->*node).heap_index = i;
+        }
+
+        inline void sift_up(size_t i)
+        {
+            T *m_obj = heap[i];
+            nsec_duration_t deadline = (m_obj->*node).deadline;
+
+            while (i > 0)
+            {
+                size_t parent = (i - 1) / 2;
+                if (deadline_at(parent) <= deadline) break;
+
+                place(i, heap[parent]);
+                i = parent;
+            }
+
+            place(i, m_obj);
+        }
+
+        inline void sift_down(size_t i)
+        {
+            T *m_obj = heap[i];
+            nsec_duration_t deadline = (m_obj->*node).deadline;
+
+            size_t n = heap.size();
+            for (;;)
+            {
+                size_t child = i * 2 + 1;
+                if (child >= n) break;
+
+                if (child + 1 < n && deadline_at(child + 1) < deadline_at(child))
+                    ++child;
+
+                if (deadline <= deadline_at(child)) break;
+
+                place(i, heap[child]);
+                i = child;
+            }
+
+            place(i, m_obj);
+        }
+
+        FUNGUSUTIL_NO_ASSIGN(timeout_queue)
+    public:
+        timeout_queue(): heap() {}
+
+        inline bool empty() const
+        {
+            return heap.empty();
+        }
+
+        inline size_t size() const
+        {
+            return heap.size();
+        }
+
+        // arms m_obj, or moves its deadline if it is already armed.
+        inline void arm(T *m_obj, timeout_period_type period_type, nsec_duration_t deadline)
+        {
+            timeout_node &m_node = m_obj->*node;
+            m_node.period_type   = period_type;
+            m_node.deadline      = deadline;
+
+            if (m_node.is_armed())
+            {
+                sift_up(m_node.heap_index);
+                sift_down(m_node.heap_index);
+            }
+            else
+            {
+                heap.push_back(m_obj);
+                sift_up(heap.size() - 1);
+            }
+        }
+
+        inline void disarm(T *m_obj)
+        {
+            timeout_node &m_node = m_obj->*node;
+            if (!m_node.is_armed()) return;
+
+            size_t i = m_node.heap_index;
+            m_node.heap_index = timeout_node::npos;
+
+            T *m_last = heap.back();
+            heap.pop_back();
+
+            if (m_last != m_obj)
+            {
+                place(i, m_last);
+                sift_up(i);
+                sift_down((m_last->*node).heap_index);
+            }
+        }
+
+        // true if an object has expired by now.  otherwise lowers timeout
+        // to when the earliest one will.
+        inline bool is_due(nsec_duration_t now, nsec_duration_t &timeout) const
+        {
+            if (heap.empty())
+                return false;
+
+            if (deadline_at(0) < now)
+                return true;
+
+            lower_timeout(timeout, deadline_at(0) - now + 1);
+            return false;
+        }
+
+        // pops the earliest object whose deadline has passed, if any.
+        inline bool next_expired(nsec_duration_t now, T *&m_obj)
+        {
+            if (heap.empty() || deadline_at(0) >= now)
+                return false;
+
+            m_obj = heap[0];
+            disarm(m_obj);
+
+            return true;
+        }
+
+        inline void clear()
+        {
+            for (T *m_obj: heap)
+                (m_obj->*node).heap_index = timeout_node::npos;
+
+            heap.clear();
+        }
+    };
+}
+
+#endif
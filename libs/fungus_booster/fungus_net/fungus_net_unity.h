@@ -30,7 +30,9 @@ namespace fungus_net
         public:
             host_storage(common_data &m_common_data,
                          uint32_t flags, const ipv4 &m_ipv4,
-                         uint32_t in_bandwidth, uint32_t out_bandwidth);
+                         uint32_t in_bandwidth, uint32_t out_bandwidth,
+                         const dispatch_budget &m_budget,
+                         size_t shard_count);
 
             FUNGUSUTIL_ALWAYS_INLINE
             inline unified_host_base *get_host(unified_host_type type)
@@ -88,6 +90,52 @@ namespace fungus_net
             virtual void operator()(unified_host_base *m_host) {m_host->dispatch();}
         };
 
+        class call_get_dispatch_stats: public host_storage::enumerator
+        {
+        public:
+            dispatch_stats result;
+
+            call_get_dispatch_stats(): result() {}
+
+            virtual void operator()(unified_host_base *m_host)
+            {
+                dispatch_stats m_stats = m_host->get_dispatch_stats();
+
+                result.events_processed += m_stats.events_processed;
+                result.events_remaining += m_stats.events_remaining;
+            }
+        };
+
+        class call_get_compression_stats: public host_storage::enumerator
+        {
+        public:
+            compression_stats result;
+
+            call_get_compression_stats(): result() {}
+
+            virtual void operator()(unified_host_base *m_host)
+            {
+                compression_stats m_stats = m_host->get_compression_stats();
+
+                result.bytes_in  += m_stats.bytes_in;
+                result.bytes_out += m_stats.bytes_out;
+            }
+        };
+
+        class call_reclaim: public host_storage::enumerator
+        {
+        public:
+            bool   b_trim;
+            size_t result;
+
+            call_reclaim(bool b_trim): b_trim(b_trim), result(0) {}
+
+            virtual void operator()(unified_host_base *m_host)
+            {
+                result += m_host->reclaim(b_trim);
+            }
+        };
+
         class call_next_event: public host_storage::enumerator
         {
         public:
@@ -118,6 +166,46 @@ namespace fungus_net
             }
         };
 
+        class call_next_ready_peer: public host_storage::enumerator
+        {
+        public:
+            bool b_got_peer;
+            peer *&m_peer;
+
+            call_next_ready_peer(peer *&m_peer): b_got_peer(false), m_peer(m_peer) {}
+
+            virtual void operator()(unified_host_base *m_host)
+            {
+                if (!b_got_peer)
+                    b_got_peer = m_host->next_ready_peer(m_peer);
+            }
+        };
+
+        class call_watch: public host_storage::enumerator
+        {
+        public:
+            poller &m_poller;
+
+            call_watch(poller &m_poller): m_poller(m_poller) {}
+
+            virtual void operator()(unified_host_base *m_host) {m_host->watch(m_poller);}
+        };
+
+        class call_is_dispatch_pending: public host_storage::enumerator
+        {
+        public:
+            bool b_pending;
+            nsec_duration_t &timeout;
+
+            call_is_dispatch_pending(nsec_duration_t &timeout): b_pending(false), timeout(timeout) {}
+
+            virtual void operator()(unified_host_base *m_host)
+            {
+                if (!b_pending)
+                    b_pending = m_host->is_dispatch_pending(timeout);
+            }
+        };
+
         friend unified_host_instance<unified_host_type::memory> *__unified_memory_host(unified_host_base *m_base);
 
                 uint32_t     flags;
@@ -125,7 +213,9 @@ namespace fungus_net
     public:
         unified_host(common_data &m_common_data,
                      uint32_t flags, const ipv4 &m_ipv4,
-                     uint32_t in_bandwidth = 0, uint32_t out_bandwidth = 0);
+                     uint32_t in_bandwidth = 0, uint32_t out_bandwidth = 0,
+                     const dispatch_budget &m_budget = dispatch_budget(),
+                     size_t shard_count = 1);
 
         unified_host(common_data &m_common_data);
 
@@ -147,6 +237,15 @@ namespace fungus_net
         virtual void dispatch();
         virtual bool next_event(event &m_event);
         virtual bool peek_event(event &m_event) const;
+
+        virtual dispatch_stats get_dispatch_stats() const;
+        virtual compression_stats get_compression_stats() const;
+        virtual size_t            reclaim(bool b_trim);
+
+        virtual void watch(poller &m_poller);
+        virtual bool is_dispatch_pending(nsec_duration_t &timeout);
+
+        virtual bool next_ready_peer(peer *&m_peer);
     };
 }
 
@@ -8,6 +8,8 @@
 
 #include "fungus_net_packet.h"
 #include "fungus_net_defs_internal.h"
+#include "fungus_net_timeout_internal.h"
+#include "fungus_net_poller_internal.h"
 
 namespace fungus_net
 {
@@ -23,7 +25,10 @@ namespace fungus_net
         unified_host_flag_networked = 0x1,
         unified_host_flag_memory    = 0x2,
         unified_host_flag_all       = unified_host_flag_networked |
-                                      unified_host_flag_memory
+                                      unified_host_flag_memory,
+
+        // service the networked host on its own thread.
+        unified_host_flag_io_thread = 0x4
     };
 
     enum reject_reason: uint32_t
@@ -65,6 +70,14 @@ namespace fungus_net
             }
 
             virtual bool timed_out(timeout_period_type period_type, sec_duration_t duration) const = 0;
+
+            // the length of a timeout period, used to compute deadlines.
+            virtual nsec_duration_t get_timeout_period(timeout_period_type period_type) const = 0;
+
+            inline nsec_duration_t deadline(timeout_period_type period_type, nsec_duration_t now) const
+            {
+                return now + get_timeout_period(period_type);
+            }
         };
 
         class default_policy: public policy
@@ -73,7 +86,7 @@ namespace fungus_net
             const size_t max_peers;
             size_t n_peers;
 
-            const sec_duration_t *p_timeout_table;
+            nsec_duration_t timeout_table[timeout_period_type::count];
         public:
             class factory: public policy::factory
             {
@@ -91,6 +104,7 @@ namespace fungus_net
             virtual void drop_peer();
             virtual size_t get_max_peers() const;
             virtual bool timed_out(timeout_period_type period_type, sec_duration_t duration) const;
+            virtual nsec_duration_t get_timeout_period(timeout_period_type period_type) const;
         };
 
         class common_data
@@ -102,12 +116,19 @@ namespace fungus_net
 
             message_factory_manager m_message_factory_manager;
 
+            compression_codec       codec;
+            compression_dictionary  dictionary;
+            size_t                  max_decompressed_size;
+
         public:
             inline common_data(common_data &&m_common_data):
                 m_policy(std::move(m_common_data.m_policy)),
                 max_peers(m_common_data.max_peers),
                 endian(std::move(m_common_data.endian)),
-                m_message_factory_manager(std::move(m_common_data.m_message_factory_manager))
+                m_message_factory_manager(std::move(m_common_data.m_message_factory_manager)),
+                codec(m_common_data.codec),
+                dictionary(std::move(m_common_data.dictionary)),
+                max_decompressed_size(m_common_data.max_decompressed_size)
             {
                 delete m_common_data.m_policy;
                 m_common_data.m_policy = nullptr;
@@ -117,7 +138,10 @@ namespace fungus_net
                 m_policy(nullptr),
                 max_peers(max_peers),
                 endian(),
-                m_message_factory_manager()
+                m_message_factory_manager(),
+                codec(compression_codec::none),
+                dictionary(),
+                max_decompressed_size(default_max_decompressed_size)
             {
                 m_policy = new default_policy(max_peers, timeout_period_map);
             }
@@ -125,7 +149,10 @@ namespace fungus_net
             inline common_data(const policy::factory &m_policy_factory):
                 m_policy(nullptr),
                 endian(),
-                m_message_factory_manager()
+                m_message_factory_manager(),
+                codec(compression_codec::none),
+                dictionary(),
+                max_decompressed_size(default_max_decompressed_size)
             {
                 set_policy(m_policy_factory);
             }
@@ -158,6 +185,121 @@ namespace fungus_net
 
             inline       policy &get_policy()       {return *m_policy;}
             inline const policy &get_policy() const {return *m_policy;}
+
+            // must be set before the instance using it is created.
+            inline void set_compression(compression_codec codec, const compression_dictionary &dictionary,
+                                        size_t max_decompressed_size = default_max_decompressed_size)
+            {
+                this->codec                 = codec;
+                this->dictionary            = dictionary;
+                this->max_decompressed_size = max_decompressed_size;
+            }
+
+            inline compression_codec             get_compression_codec() const      {return codec;}
+            inline const compression_dictionary &get_compression_dictionary() const {return dictionary;}
+            inline size_t                        get_max_decompressed_size() const  {return max_decompressed_size;}
+        };
+
+        // one message on its way to many peers.  networked peers share a
+        // single serialized copy of it, made by the first of them to need
+        // it; every other peer is sent a copy of the message.
+        class broadcast
+        {
+        public:
+            // work a host instance holds back until every peer has been
+            // given the broadcast, keyed by whatever it is done for.  the
+            // broadcast finishes and deletes them as it ends.
+            class deferred
+            {
+            private:
+                deferred   *next;
+                const void *key;
+
+                friend class broadcast;
+            public:
+                inline deferred(const void *key): next(nullptr), key(key) {}
+                virtual ~deferred() {}
+
+                virtual void finish() = 0;
+            };
+        private:
+            const message            *m_message;
+            packet::shared_message    m_shared;
+            const packet::aggregator *m_shared_by;
+
+            // made by get_detached_shared().
+            packet::shared_message    m_detached;
+            bool                      b_detached_failed;
+
+            deferred                 *m_deferred;
+
+            FUNGUSUTIL_NO_ASSIGN(broadcast)
+        public:
+            inline broadcast(const message *m_message):
+                m_message(m_message), m_shared(), m_shared_by(nullptr),
+                m_detached(), b_detached_failed(false), m_deferred(nullptr)
+            {}
+
+            inline ~broadcast()
+            {
+                while (m_deferred)
+                {
+                    deferred *m_next = m_deferred->next;
+
+                    m_deferred->finish();
+                    delete m_deferred;
+
+                    m_deferred = m_next;
+                }
+            }
+
+            inline deferred *find_deferred(const void *key) const
+            {
+                for (deferred *it = m_deferred; it; it = it->next)
+                {
+                    if (it->key == key)
+                        return it;
+                }
+
+                return nullptr;
+            }
+
+            inline void defer(deferred *m_deferred_new)
+            {
+                m_deferred_new->next = m_deferred;
+                m_deferred           = m_deferred_new;
+            }
+
+            // the serialized message, belonging to no aggregator, for
+            // instances that hand copies of it to other threads.  nullptr
+            // if it cannot be made.
+            inline const packet::shared_message *get_detached_shared(const endian_converter &endian)
+            {
+                if (!m_detached.is_initialized() && !b_detached_failed)
+                    b_detached_failed = !m_detached.make(endian, m_message);
+
+                return b_detached_failed ? nullptr : &m_detached;
+            }
+
+            inline const message *get_message() const
+            {
+                return m_message;
+            }
+
+            // the serialized message, made by agg if nobody has made it
+            // yet.  nullptr if agg cannot use the one that was made.
+            inline const packet::shared_message *get_shared(packet::aggregator &agg)
+            {
+                if (!m_shared_by)
+                {
+                    if (!agg.make_shared(m_message, m_shared))
+                        return nullptr;
+
+                    m_shared_by = &agg;
+                }
+
+                return m_shared_by == &agg ? &m_shared : nullptr;
+            }
         };
 
         class peer
@@ -176,6 +318,22 @@ namespace fungus_net
             unified_host_base *parent;
             state m_state;
 
+            // links in the parent host's ready list, valid while b_ready.
+            bool  b_ready;
+            peer *ready_prev;
+            peer *ready_next;
+
+            // tell the parent host this peer has messages waiting
+            // to be received.
+            inline void mark_ready()
+            {
+                if (!b_ready)
+                {
+                    b_ready = true;
+                    parent->__push_ready(this);
+                }
+            }
+
             FUNGUSUTIL_ALWAYS_INLINE static inline constexpr bool can_connect(state m_state)
             {
                 return m_state == state::none ||
@@ -202,6 +360,9 @@ namespace fungus_net
             virtual bool send(const message *m_message) = 0;
             virtual message *receive()                  = 0;
 
+            // sends m_broadcast.get_message() without taking it over.
+            virtual bool send_broadcast(broadcast &m_broadcast);
+
             virtual bool connect(const ipv4 &m_ipv4,        uint32_t data);
             virtual bool connect(unified_host_base *m_host, uint32_t data);
 
@@ -211,7 +372,58 @@ namespace fungus_net
     protected:
         common_data &m_common_data;
 
+        // peers that have received messages since they were
+        // last handed out by next_ready_peer(), first marked first.
+        peer *m_ready_first;
+        peer *m_ready_last;
+
+        inline void __push_ready(peer *m_peer)
+        {
+            m_peer->ready_prev = m_ready_last;
+            m_peer->ready_next = nullptr;
+
+            if (m_ready_last) m_ready_last->ready_next = m_peer;
+            else              m_ready_first            = m_peer;
+
+            m_ready_last = m_peer;
+        }
+
+        inline void __unlink_ready(peer *m_peer)
+        {
+            if (m_peer->ready_prev) m_peer->ready_prev->ready_next = m_peer->ready_next;
+            else                    m_ready_first                  = m_peer->ready_next;
+
+            if (m_peer->ready_next) m_peer->ready_next->ready_prev = m_peer->ready_prev;
+            else                    m_ready_last                   = m_peer->ready_prev;
+
+            m_peer->b_ready = false;
+        }
+
     public:
+        // limits on how much work a single dispatch() may do
+        // when draining incoming events.  0 means no limit.
+        struct dispatch_budget
+        {
+            size_t          max_events;
+            usec_duration_t max_usec;
+
+            dispatch_budget(size_t max_events = 0, usec_duration_t max_usec = 0):
+                max_events(max_events), max_usec(max_usec)
+            {}
+        };
+
+        // what the last dispatch() got through, and how many
+        // events it left queued for the next one.
+        struct dispatch_stats
+        {
+            size_t events_processed;
+            size_t events_remaining;
+
+            dispatch_stats(size_t events_processed = 0, size_t events_remaining = 0):
+                events_processed(events_processed), events_remaining(events_remaining)
+            {}
+        };
+
         struct event
         {
             enum class type: uint8_t
@@ -254,6 +466,28 @@ namespace fungus_net
         virtual void dispatch()                        = 0;
         virtual bool next_event(event &m_event)        = 0;
         virtual bool peek_event(event &m_event) const  = 0;
+
+        virtual dispatch_stats get_dispatch_stats() const = 0;
+
+        // totals for every aggregate this host has compressed.
+        virtual compression_stats get_compression_stats() const = 0;
+
+        // gives back block sets of peers and packets left free since the
+        // last call, or with b_trim every free one.  returns the number
+        // of bytes freed.
+        virtual size_t reclaim(bool b_trim) = 0;
+
+        // hands m_poller whatever should end a wait for dispatch().
+        // m_poller must outlive the host, or be unwatch_all()ed first.
+        virtual void watch(poller &m_poller)                              = 0;
+
+        // true if dispatch() has work now.  otherwise lowers timeout
+        // (negative is none) to the next deadline dispatch() keeps.
+        virtual bool is_dispatch_pending(nsec_duration_t &timeout)        = 0;
+
+        // pops a peer with messages waiting, so that the caller
+        // need only poll receive() on peers that have something.
+        virtual bool next_ready_peer(peer *&m_peer);
     };
 
     template <unified_host_type instance_type>
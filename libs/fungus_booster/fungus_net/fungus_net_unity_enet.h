@@ -3,6 +3,8 @@
 
 #include "fungus_net_unity_base.h"
 
+#include "../fungus_concurrency/fungus_concurrency_ring_buffer.h"
+
 namespace fungus_net
 {
     template <>
@@ -11,7 +13,118 @@ namespace fungus_net
     protected:
         class peer;
 
-        typedef block_allocator<unified_host_instance::peer, 64> peer_block_allocator;
+        typedef fungus_concurrency::concurrent_block_allocator<unified_host_instance::peer, 64> peer_block_allocator;
+
+        class io_shard;
+
+        // in io thread mode every enet host, with its agg and sep, belongs
+        // to the io thread of its shard.  a peer reaches its enet peer
+        // through a link, created by whichever side starts the connection.
+        // once this side releases a link the io thread answers with a
+        // released result, and only then is the link freed, so neither
+        // side ever sees a dangling one.
+        struct io_link
+        {
+            io_shard *m_shard;
+            ENetPeer *enet_peer;  // io thread only
+            peer     *m_peer;     // this thread only
+            bool      b_released; // this thread only
+
+            inline io_link(io_shard *m_shard, ENetPeer *enet_peer = nullptr, peer *m_peer = nullptr):
+                m_shard(m_shard), enet_peer(enet_peer), m_peer(m_peer), b_released(false)
+            {}
+        };
+
+        struct io_command
+        {
+            enum class type: uint8_t
+            {
+                connect,
+                send,
+                send_shared, // pk, on channel data, holding one of its references.
+                disconnect,
+                reset,   // drop the connection and the link.
+                release, // drop the link, letting a disconnect finish.
+                stop
+            };
+
+            type                m_type;
+            packet::stream_mode smode;
+            io_link            *m_link;
+            const message      *m_message;
+            ENetPacket         *pk;
+            uint32_t            data;
+            ENetAddress         enet_addr;
+
+            inline io_command(type m_type = type::stop, io_link *m_link = nullptr,
+                              const message *m_message = nullptr, uint32_t data = 0):
+                m_type(m_type), smode(packet::stream_mode::invalid), m_link(m_link),
+                m_message(m_message), pk(nullptr), data(data), enet_addr()
+            {}
+        };
+
+        // a broadcast's packet for the peers of one shard.  every shard
+        // gets its own copy, since the reference count of an ENetPacket
+        // may only be touched by one thread; the copy's references are
+        // all taken before the first command carrying it is pushed.
+        class io_broadcast: public broadcast::deferred
+        {
+        private:
+            io_shard              *m_shard;
+            ENetPacket            *pk;
+            packet::stream_mode    smode;
+            uint8_t                channel;
+            std::vector<io_link *> m_links;
+
+            FUNGUSUTIL_NO_ASSIGN(io_broadcast)
+        public:
+            inline io_broadcast(io_shard *m_shard, ENetPacket *pk, const packet::shared_message &m_shared):
+                broadcast::deferred(m_shard), m_shard(m_shard), pk(pk),
+                smode(m_shared.get_stream_mode()), channel(m_shared.get_channel()), m_links()
+            {}
+
+            inline void add(io_link *m_link)
+            {
+                m_links.push_back(m_link);
+            }
+
+            virtual void finish()
+            {
+                pk->referenceCount += m_links.size();
+
+                for (io_link *m_link: m_links)
+                {
+                    io_command m_command(io_command::type::send_shared, m_link, nullptr, channel);
+                    m_command.smode = smode;
+                    m_command.pk    = pk;
+
+                    m_shard->push_command(m_command);
+                }
+
+                m_links.clear();
+            }
+        };
+
+        struct io_result
+        {
+            enum class type: uint8_t
+            {
+                connected,
+                received,
+                disconnected,
+                released
+            };
+
+            type      m_type;
+            io_link  *m_link;
+            message  *m_message;
+            uint32_t  data;
+
+            inline io_result(type m_type = type::released, io_link *m_link = nullptr,
+                             message *m_message = nullptr, uint32_t data = 0):
+                m_type(m_type), m_link(m_link), m_message(m_message), data(data)
+            {}
+        };
 
         class peer: unified_host_base::peer
         {
@@ -22,14 +135,16 @@ namespace fungus_net
             ENetHost *enet_host;
             ENetPeer *enet_peer;
 
+            io_link  *m_link;
+
             std::queue<message *> m_in_messages;
 
-            timestamp begin_period;
+            timeout_node m_timeout;
 
             inline peer(unified_host_base *parent):
                 unified_host_base::peer(parent),
                 endian(parent->get_common_data().get_endian_converter()),
-                enet_host(nullptr), enet_peer(nullptr),
+                enet_host(nullptr), enet_peer(nullptr), m_link(nullptr),
                 m_in_messages()
             {
                 enet_parent = static_cast
@@ -43,7 +158,7 @@ namespace fungus_net
             inline peer(unified_host_base *parent, ENetPeer *enet_peer):
                 unified_host_base::peer(parent),
                 endian(parent->get_common_data().get_endian_converter()),
-                enet_host(nullptr), enet_peer(enet_peer),
+                enet_host(nullptr), enet_peer(enet_peer), m_link(nullptr),
                 m_in_messages()
             {
                 enet_parent = static_cast
@@ -63,14 +178,46 @@ namespace fungus_net
                 }
             }
 
+            // an incoming connection in io thread mode.
+            inline peer(unified_host_base *parent, io_link *m_link):
+                unified_host_base::peer(parent),
+                endian(parent->get_common_data().get_endian_converter()),
+                enet_host(nullptr), enet_peer(nullptr), m_link(m_link),
+                m_in_messages()
+            {
+                enet_parent = static_cast
+                    <unified_host_instance
+                    <unified_host_type::networked> *>
+                    (parent);
+
+                if (enet_parent->enet_peer_map.insert(std::move(enet_peer_map_entry(this, this)))
+                    != enet_parent->enet_peer_map.end())
+                {
+                    m_link->m_peer = this;
+                    m_state = state::connected;
+                }
+                else
+                {
+                    m_state      = state::none;
+                    this->m_link = nullptr;
+                }
+            }
+
             virtual ~peer()
             {
                 reset();
             }
 
+            // the key for this peer in enet_peer_map.
+            inline const void *get_map_key() const
+            {
+                return enet_parent->b_io_thread ? (const void *)this : (const void *)enet_peer;
+            }
+
             inline void place_in_m_message(message *m_message)
             {
                 m_in_messages.push(m_message);
+                mark_ready();
             }
 
             inline ENetPeer *get_enet_peer()
@@ -79,22 +226,55 @@ namespace fungus_net
             }
 
             friend class unified_host_instance;
-            friend class block_allocator<unified_host_instance::peer, 64>;
+            friend class fungus_concurrency::concurrent_block_allocator<unified_host_instance::peer, 64>;
         public:
             virtual unified_host_type get_host_type() const {return unified_host_type::networked;}
 
             virtual bool send(const message *m_message)
             {
-                packet *pk = enet_parent->agg.create_packet();
-                if (!pk) return false;
+                // the caller keeps m_message, and the io thread
+                // serializes later, so hand it a copy.
+                if (enet_parent->b_io_thread)
+                {
+                    if (!m_link) return false;
 
-                if (!pk->initialize_outgoing(m_message, endian))
+                    enet_parent->push_io_command(io_command(io_command::type::send, m_link, m_message->copy()));
+                    return true;
+                }
+
+                return enet_parent->agg.queue_message(m_message, enet_peer);
+            }
+
+            virtual bool send_broadcast(broadcast &m_broadcast)
+            {
+                // agg belongs to the io thread, so each shard is handed
+                // a copy of the packet once every peer has been seen.
+                if (enet_parent->b_io_thread)
                 {
-                    enet_parent->agg.destroy_packet(pk);
-                    return false;
+                    if (!m_link) return false;
+
+                    io_broadcast *m_io_broadcast = static_cast<io_broadcast *>(m_broadcast.find_deferred(m_link->m_shard));
+                    if (!m_io_broadcast)
+                    {
+                        const packet::shared_message *m_shared = m_broadcast.get_detached_shared(endian);
+
+                        ENetPacket *pk = m_shared ? m_shared->copy_packet() : nullptr;
+                        if (!pk)
+                            return send(m_broadcast.get_message());
+
+                        m_io_broadcast = new io_broadcast(m_link->m_shard, pk, *m_shared);
+                        m_broadcast.defer(m_io_broadcast);
+                    }
+
+                    m_io_broadcast->add(m_link);
+                    return true;
                 }
 
-                enet_parent->agg.queue_packet(pk, enet_peer);
+                const packet::shared_message *m_shared = m_broadcast.get_shared(enet_parent->agg);
+                if (!m_shared)
+                    return send(m_broadcast.get_message());
+
+                enet_parent->agg.queue_shared(*m_shared, enet_peer);
                 return true;
             }
 
@@ -113,19 +293,39 @@ namespace fungus_net
 
             virtual bool connect(const ipv4 &m_ipv4, uint32_t data)
             {
-                if (!can_connect(get_state()) ||
-                    enet_host == nullptr         ||
-                    enet_peer != nullptr) return false;
-
                 ENetAddress enet_addr;
                 enet_addr.host = m_ipv4.m_host.value;
                 enet_addr.port = m_ipv4.port_i;
 
+                if (enet_parent->b_io_thread)
+                {
+                    if (!can_connect(get_state()) || m_link != nullptr) return false;
+
+                    if (enet_parent->enet_peer_map.find(this) == enet_parent->enet_peer_map.end() &&
+                        enet_parent->enet_peer_map.insert(std::move(enet_peer_map_entry(this, this)))
+                        == enet_parent->enet_peer_map.end()) return false;
+
+                    m_link = new io_link(enet_parent->m_connect_shard, nullptr, this);
+
+                    io_command m_command(io_command::type::connect, m_link, nullptr, data);
+                    m_command.enet_addr = enet_addr;
+                    enet_parent->push_io_command(m_command);
+
+                    enet_parent->arm_timeout(this, connection_timeout);
+                    m_state      = state::connecting;
+
+                    return true;
+                }
+
+                if (!can_connect(get_state()) ||
+                    enet_host == nullptr         ||
+                    enet_peer != nullptr) return false;
+
                 enet_peer = enet_host_connect(enet_host, &enet_addr, UINT8_MAX, (enet_uint32)data);
 
                 if (enet_peer == nullptr) return false;
 
-                begin_period = timestamp::current_time;
+                enet_parent->arm_timeout(this, connection_timeout);
                 m_state      = state::connecting;
 
                 return enet_parent->enet_peer_map.insert(std::move(enet_peer_map_entry(enet_peer, this)))
@@ -138,9 +338,12 @@ namespace fungus_net
 
                 if (success)
                 {
-                    enet_peer_disconnect(enet_peer, data);
+                    if (enet_parent->b_io_thread)
+                        enet_parent->push_io_command(io_command(io_command::type::disconnect, m_link, nullptr, data));
+                    else
+                        enet_peer_disconnect(enet_peer, data);
 
-                    begin_period = timestamp::current_time;
+                    enet_parent->arm_timeout(this, disconnect_timeout);
                     m_state      = state::disconnecting;
                 }
 
@@ -149,8 +352,20 @@ namespace fungus_net
 
             virtual bool reset()
             {
+                enet_parent->m_timeouts.disarm(this);
+
+                if (m_link)
+                {
+                    enet_parent->release_io_link(m_link, io_command::type::reset);
+                    m_link = nullptr;
+
+                    m_state = state::none;
+                }
+
                 if (enet_peer)
                 {
+                    enet_parent->agg.forget_peer(enet_peer);
+
                     enet_peer_reset(enet_peer);
                     enet_peer = nullptr;
 
@@ -161,12 +376,15 @@ namespace fungus_net
             }
         };
 
-        typedef block_allocator_object_hash<ENetPeer *, unified_host_instance::peer,
+        // keyed by ENetPeer, or by the peer itself in io thread mode.
+        typedef block_allocator_object_hash<const void *, unified_host_instance::peer,
                                           peer_block_allocator> enet_peer_hash_type;
 
         typedef hash_map<enet_peer_hash_type>                    enet_peer_map_type;
         typedef typename enet_peer_map_type::entry               enet_peer_map_entry;
 
+        typedef timeout_queue<unified_host_instance::peer, &unified_host_instance::peer::m_timeout> timeout_queue_type;
+
         peer_block_allocator m_allocator;
 
         ENetHost *enet_host;
@@ -176,6 +394,360 @@ namespace fungus_net
         packet::aggregator agg;
         packet::separator  sep;
 
+        timeout_queue_type m_timeouts;
+
+        dispatch_budget m_budget;
+        dispatch_stats  m_stats;
+
+        // one enet host serviced by its own io thread.  commands that do
+        // not fit in a ring wait in the pending queue on their own side,
+        // so neither thread ever blocks on the other.
+        class io_shard
+        {
+        private:
+            unified_host_instance *parent;
+
+            ENetHost *enet_host;
+
+            packet::aggregator agg;
+            packet::separator  sep;
+
+            fungus_concurrency::spsc_ring<io_command> m_commands;
+            fungus_concurrency::spsc_ring<io_result>  m_results;
+
+            std::queue<io_command> m_commands_pending; // owner thread only
+            std::queue<io_result>  m_results_pending;  // io thread only
+
+            thread m_thread;
+
+            // the io thread sleeps in m_wakeup, which watches the socket,
+            // until the socket is readable, a command is pushed or enet
+            // has a timer due.  it notifies m_drained whenever it takes
+            // commands, for a stop() waiting on a full ring.
+            poller   m_wakeup;
+            notifier m_drained;
+
+            // while results wait for room in the ring, the io thread
+            // looks again this often rather than sleeping.
+            static constexpr nsec_duration_t io_retry_period = 1000000;
+
+            FUNGUSUTIL_NO_ASSIGN(io_shard)
+
+            // everything below runs on the io thread.
+
+            inline void push_result(const io_result &m_result)
+            {
+                if (!m_results_pending.empty() || !m_results.push(m_result))
+                    m_results_pending.push(m_result);
+                else
+                    notify_parent();
+            }
+
+            // wakes a dispatch_wait() on the owner thread.
+            inline void notify_parent()
+            {
+                poller *m_poller = parent->m_poller.load();
+                if (m_poller)
+                    m_poller->notify();
+            }
+
+            inline void handle_command(const io_command &m_command)
+            {
+                io_link *m_link = m_command.m_link;
+
+                switch (m_command.m_type)
+                {
+                case io_command::type::connect:
+                    m_link->enet_peer = enet_host_connect(enet_host, &m_command.enet_addr, UINT8_MAX, (enet_uint32)m_command.data);
+
+                    // out of enet peers; nothing will ever connect.
+                    if (m_link->enet_peer)
+                        m_link->enet_peer->data = m_link;
+                    else
+                        push_result(io_result(io_result::type::disconnected, m_link, nullptr,
+                                              (uint32_t)-reject_reason_host_deny));
+                    break;
+                case io_command::type::send:
+                    if (m_link->enet_peer)
+                        agg.queue_message(m_command.m_message, m_link->enet_peer);
+
+                    delete m_command.m_message;
+                    break;
+                case io_command::type::send_shared:
+                    if (m_link->enet_peer)
+                        agg.queue_shared(m_command.pk, m_command.smode, (uint8_t)m_command.data, m_link->enet_peer);
+
+                    packet::drop_source(m_command.pk);
+                    break;
+                case io_command::type::disconnect:
+                    if (m_link->enet_peer)
+                        enet_peer_disconnect(m_link->enet_peer, (enet_uint32)m_command.data);
+                    break;
+                case io_command::type::reset:
+                case io_command::type::release:
+                    if (m_link->enet_peer)
+                    {
+                        m_link->enet_peer->data = nullptr;
+
+                        if (m_command.m_type == io_command::type::reset)
+                        {
+                            agg.forget_peer(m_link->enet_peer);
+                            enet_peer_reset(m_link->enet_peer);
+                        }
+
+                        m_link->enet_peer = nullptr;
+                    }
+
+                    push_result(io_result(io_result::type::released, m_link));
+                    break;
+                case io_command::type::stop:
+                default:
+                    break;
+                };
+            }
+
+            inline void handle_enet_event(ENetEvent &enet_event)
+            {
+                io_link *m_link = static_cast<io_link *>(enet_event.peer->data);
+
+                switch (enet_event.type)
+                {
+                case ENET_EVENT_TYPE_CONNECT:
+                    if (!m_link)
+                    {
+                        m_link = new io_link(this, enet_event.peer);
+                        enet_event.peer->data = m_link;
+                    }
+
+                    push_result(io_result(io_result::type::connected, m_link, nullptr, enet_event.data));
+                    break;
+                case ENET_EVENT_TYPE_RECEIVE:
+                    if (m_link)
+                    {
+                        sep.separate_packets(enet_event.packet, enet_event.channelID);
+
+                        while (sep.packets_waiting())
+                        {
+                            packet *pk = sep.get_packet();
+                            message *m_message = pk->make_message(&parent->m_common_data.get_message_factory_manager());
+
+                            sep.destroy_packet(pk);
+
+                            if (m_message)
+                                push_result(io_result(io_result::type::received, m_link, m_message));
+                        }
+                    }
+                    else
+                        enet_packet_destroy(enet_event.packet);
+
+                    break;
+                case ENET_EVENT_TYPE_DISCONNECT:
+                    agg.forget_peer(enet_event.peer);
+
+                    if (m_link)
+                    {
+                        m_link->enet_peer     = nullptr;
+                        enet_event.peer->data = nullptr;
+
+                        push_result(io_result(io_result::type::disconnected, m_link, nullptr, enet_event.data));
+                    }
+
+                    break;
+                case ENET_EVENT_TYPE_NONE:
+                default:
+                    break;
+                };
+            }
+
+            inline void run()
+            {
+                for (;;)
+                {
+                    bool b_took = false;
+
+                    io_command m_command;
+                    while (m_commands.pop(m_command))
+                    {
+                        if (m_command.m_type == io_command::type::stop)
+                            return;
+
+                        handle_command(m_command);
+                        b_took = true;
+                    }
+
+                    if (b_took)
+                        m_drained.notify();
+
+                    if (!m_results_pending.empty())
+                    {
+                        while (!m_results_pending.empty() && m_results.push(m_results_pending.front()))
+                            m_results_pending.pop();
+
+                        notify_parent();
+                    }
+
+                    agg.send_all();
+
+                    bool b_idle = true;
+
+                    ENetEvent enet_event;
+                    while (enet_host_check_events(enet_host, &enet_event) > 0 ||
+                           enet_host_service(enet_host, &enet_event, 0)   > 0)
+                    {
+                        handle_enet_event(enet_event);
+                        b_idle = false;
+                    }
+
+                    if (b_idle)
+                        wait_for_work();
+                }
+            }
+
+            // arms before looking, so that a command pushed after the
+            // look still ends the wait.
+            inline void wait_for_work()
+            {
+                m_wakeup.arm();
+
+                nsec_duration_t timeout = m_results_pending.empty() ? -1 : io_retry_period;
+
+                enet_uint32 msec;
+                if (enet_host_service_timeout(enet_host, &msec))
+                    lower_timeout(timeout, (nsec_duration_t)msec * 1000000);
+
+                if (m_commands.empty() && timeout != 0)
+                    m_wakeup.wait(timeout);
+
+                m_wakeup.disarm();
+            }
+
+            static void thread_main(void *arg)
+            {
+                static_cast<io_shard *>(arg)->run();
+            }
+        public:
+            inline io_shard(unified_host_instance *parent, ENetHost *enet_host):
+                parent(parent), enet_host(enet_host),
+                agg(parent->m_common_data.get_endian_converter(),
+                    parent->m_common_data.get_compression_codec(),
+                    &parent->m_common_data.get_compression_dictionary()),
+                sep(parent->m_common_data.get_endian_converter(),
+                    parent->m_common_data.get_compression_codec(),
+                    &parent->m_common_data.get_compression_dictionary(),
+                    parent->m_common_data.get_max_decompressed_size()),
+                m_commands(), m_results(),
+                m_commands_pending(), m_results_pending(),
+                m_thread(), m_wakeup(), m_drained()
+            {
+                m_wakeup.watch(enet_host->socket);
+                m_thread.start(&thread_main, this);
+            }
+
+            // stop() must have been called.
+            inline ~io_shard()
+            {
+                m_wakeup.unwatch_all();
+                enet_host_destroy(enet_host);
+            }
+
+            // everything below runs on the thread that owns the host.
+
+            inline void push_command(const io_command &m_command)
+            {
+                if (!m_commands_pending.empty() || !m_commands.push(m_command))
+                    m_commands_pending.push(m_command);
+                else
+                    m_wakeup.notify();
+            }
+
+            // true once nothing is left pending.
+            inline bool flush_commands()
+            {
+                bool b_pushed = false;
+                while (!m_commands_pending.empty() && m_commands.push(m_commands_pending.front()))
+                {
+                    m_commands_pending.pop();
+                    b_pushed = true;
+                }
+
+                if (b_pushed)
+                    m_wakeup.notify();
+
+                return m_commands_pending.empty();
+            }
+
+            inline bool pop_result(io_result &m_result)
+            {
+                return m_results.pop(m_result);
+            }
+
+            inline size_t count_results() const
+            {
+                return m_results.size();
+            }
+
+            inline bool commands_pending() const
+            {
+                return !m_commands_pending.empty();
+            }
+
+            // agg belongs to the io thread, but its stats may be read here.
+            inline compression_stats get_compression_stats() const
+            {
+                return agg.get_compression_stats();
+            }
+
+            // likewise for the allocators under agg and sep.
+            inline size_t reclaim(bool b_trim)
+            {
+                return agg.reclaim(b_trim) + sep.reclaim(b_trim);
+            }
+
+            inline void stop()
+            {
+                push_command(io_command(io_command::type::stop));
+
+                for (;;)
+                {
+                    int epoch = m_drained.get_epoch();
+                    if (flush_commands())
+                        break;
+
+                    m_drained.wait(epoch, -1);
+                }
+
+                m_thread.join();
+            }
+
+            // once stopped, also hands out what the io thread could not
+            // fit in the ring.
+            inline bool pop_result_stopped(io_result &m_result)
+            {
+                if (m_results.pop(m_result))
+                    return true;
+
+                if (m_results_pending.empty())
+                    return false;
+
+                m_result = m_results_pending.front();
+                m_results_pending.pop();
+
+                return true;
+            }
+        };
+
+        // io thread mode.  with more than one listening shard, outgoing
+        // connections get a shard of their own on an unshared port, since
+        // replies on a shared port may land on any of the listeners.
+        const bool b_io_thread;
+
+        std::vector<io_shard *> m_shards;
+        io_shard               *m_connect_shard;
+        size_t                  m_next_shard;
+
+        // set by watch(); the io threads notify it.
+        atomic<poller *>        m_poller;
+
         virtual peer *new_peer(ENetPeer *enet_peer)
         {
             peer *m_peer = m_common_data.get_policy().grab_peer() ? m_allocator.create(this, enet_peer) : nullptr;
@@ -194,6 +766,7 @@ namespace fungus_net
                     peer *m_peer = it->value;
                     m_peer->enet_peer = enet_event.peer;
                     m_peer->m_state = peer::state::connected;
+                    m_timeouts.disarm(m_peer);
 
                     event_queue.push(event(event::type::connected, enet_event.data, m_peer));
                 }
@@ -212,7 +785,6 @@ namespace fungus_net
                     peer *m_peer = it->value;
 
                     sep.separate_packets(enet_event.packet, enet_event.channelID);
-                    enet_packet_destroy(enet_event.packet);
 
                     while (sep.packets_waiting())
                     {
@@ -225,12 +797,18 @@ namespace fungus_net
                             m_peer->place_in_m_message(m_message);
                     }
                 }
+                else
+                    enet_packet_destroy(enet_event.packet);
 
                 break;
             case ENET_EVENT_TYPE_DISCONNECT:
+                agg.forget_peer(enet_event.peer);
+
                 if (it != enet_peer_map.end())
                 {
                     peer *m_peer = it->value;
+                    m_timeouts.disarm(m_peer);
+
                     switch (enet_event.data)
                     {
                     case (uint32_t)-reject_reason_host_deny:
@@ -251,60 +829,337 @@ namespace fungus_net
             };
         }
 
-        inline void check_for_timeouts()
+        // events enet has already pulled off of the socket but
+        // not yet handed to us.
+        inline size_t count_queued_enet_events() const
+        {
+            size_t n = 0;
+
+            for (ENetListIterator it  = enet_list_begin(&enet_host->dispatchQueue);
+                                  it != enet_list_end(&enet_host->dispatchQueue);
+                                  it  = enet_list_next(it))
+            {
+                ENetPeer *enet_peer = (ENetPeer *)((char *)it - offsetof(ENetPeer, dispatchList));
+                size_t n_commands   = enet_list_size(&enet_peer->dispatchedCommands);
+
+                n += n_commands ? n_commands : 1;
+            }
+
+            return n;
+        }
+
+        // services the host until nothing is left or the budget runs out.
+        // enet_host_check_events() hands out what is already queued without
+        // touching the socket; only when that runs dry do we go back to
+        // enet_host_service() to flush and read more datagrams.
+        inline void drain_enet_events()
+        {
+            const bool      b_timed = m_budget.max_usec > 0;
+            nsec_duration_t end     = b_timed ? monotonic_clock::read() + usec_duration_to_nsec(m_budget.max_usec) : 0;
+
+            size_t n = 0;
+            bool   b_exhausted = false;
+
+            ENetEvent enet_event;
+            while (!(b_exhausted = m_budget.max_events > 0 && n >= m_budget.max_events))
+            {
+                if (enet_host_check_events(enet_host, &enet_event) <= 0 &&
+                    enet_host_service(enet_host, &enet_event, 0)   <= 0)
+                    break;
+
+                handle_enet_event(enet_event);
+                ++n;
+
+                if (b_timed && monotonic_clock::read() >= end)
+                {
+                    b_exhausted = true;
+                    break;
+                }
+            }
+
+            m_stats = dispatch_stats(n, b_exhausted ? count_queued_enet_events() : 0);
+        }
+
+        inline void push_io_command(const io_command &m_command)
+        {
+            m_command.m_link->m_shard->push_command(m_command);
+        }
+
+        inline void flush_io_commands()
+        {
+            for (io_shard *m_shard: m_shards)
+                m_shard->flush_commands();
+        }
+
+        inline void release_io_link(io_link *m_link, io_command::type m_type)
+        {
+            m_link->m_peer     = nullptr;
+            m_link->b_released = true;
+
+            push_io_command(io_command(m_type, m_link));
+        }
+
+        // an incoming connection the policy would not take.
+        inline void deny_io_link(io_link *m_link)
+        {
+            push_io_command(io_command(io_command::type::disconnect, m_link, nullptr,
+                                       (uint32_t)-reject_reason_host_deny));
+            release_io_link(m_link, io_command::type::release);
+        }
+
+        inline void handle_io_result(io_result &m_result)
         {
-            for (auto &it: enet_peer_map)
+            io_link *m_link = m_result.m_link;
+            peer    *m_peer = m_link->m_peer;
+
+            switch (m_result.m_type)
             {
-                peer *m_peer = it.value;
-                bool timed_out = false;
-                event m_event;
+            case io_result::type::connected:
+                if (m_peer)
+                {
+                    m_peer->m_state = peer::state::connected;
+                    m_timeouts.disarm(m_peer);
 
-                switch (m_peer->m_state)
+                    event_queue.push(event(event::type::connected, m_result.data, m_peer));
+                }
+                else if (!m_link->b_released)
+                {
+                    m_peer = m_common_data.get_policy().grab_peer() ? m_allocator.create(this, m_link) : nullptr;
+
+                    if (m_peer != nullptr && m_peer->m_link == m_link)
+                        event_queue.push(event(event::type::connected, m_result.data, m_peer));
+                    else
+                        deny_io_link(m_link);
+                }
+                break;
+            case io_result::type::received:
+                if (m_peer)
+                    m_peer->place_in_m_message(m_result.m_message);
+                else
+                    delete m_result.m_message;
+                break;
+            case io_result::type::disconnected:
+                if (m_peer)
                 {
-                case peer::state::connecting:
-                    if (m_common_data.
-                        get_policy().
-                        timed_out(connection_timeout,
-                                  timestamp(timestamp::current_time)
-                                  - m_peer->begin_period))
+                    m_timeouts.disarm(m_peer);
+
+                    switch (m_result.data)
                     {
-                        timed_out = true;
-                        m_event = event(event::type::rejected, reject_reason_host_timeout, m_peer);
-                    }
+                    case (uint32_t)-reject_reason_host_deny:
+                        m_peer->m_state = peer::state::rejected;
+                        event_queue.push(event(event::type::rejected, reject_reason_host_deny, m_peer));
+                        break;
+                    default:
+                        m_peer->m_state = peer::state::disconnected;
+                        event_queue.push(event(event::type::disconnected, m_result.data, m_peer));
+                        break;
+                    };
+                }
+                break;
+            case io_result::type::released:
+                delete m_link;
+                break;
+            };
+        }
+
+        // takes results from the shards in turn, so that one busy shard
+        // cannot use up the whole budget.
+        inline void drain_io_results()
+        {
+            const bool      b_timed = m_budget.max_usec > 0;
+            nsec_duration_t end     = b_timed ? monotonic_clock::read() + usec_duration_to_nsec(m_budget.max_usec) : 0;
+
+            const size_t n_shards = m_shards.size();
+
+            size_t n = 0, n_idle = 0;
+            bool   b_exhausted = false;
+
+            io_result m_result;
+            while (n_idle < n_shards &&
+                   !(b_exhausted = m_budget.max_events > 0 && n >= m_budget.max_events))
+            {
+                io_shard *m_shard = m_shards[m_next_shard];
+                m_next_shard = (m_next_shard + 1) % n_shards;
+
+                if (!m_shard->pop_result(m_result))
+                {
+                    ++n_idle;
+                    continue;
+                }
+
+                n_idle = 0;
+
+                handle_io_result(m_result);
+                ++n;
+
+                if (b_timed && monotonic_clock::read() >= end)
+                {
+                    b_exhausted = true;
+                    break;
+                }
+            }
+
+            size_t n_remaining = 0;
+            if (b_exhausted)
+            {
+                for (io_shard *m_shard: m_shards)
+                    n_remaining += m_shard->count_results();
+            }
+
+            m_stats = dispatch_stats(n, n_remaining);
+        }
+
+        // creates the shards: shard_count listeners sharing the bound
+        // port, plus a connecting shard if there is more than one.  if the
+        // port cannot be shared, fewer listeners are used.
+        inline void start_io_shards(const ipv4 &m_ipv4, uint32_t in_bandwidth, uint32_t out_bandwidth, size_t shard_count)
+        {
+            ENetAddress enet_addr;
+            enet_addr.host = m_ipv4.m_host.value;
+            enet_addr.port = m_ipv4.port_i;
+
+            const size_t peer_count = m_common_data.get_max_peers() + internal_defs::aux_peer_slot_count;
+
+            if (shard_count < 1) shard_count = 1;
+
+            for (size_t i = 0; i < shard_count; ++i)
+            {
+                ENetHost *m_enet_host = shard_count > 1 ?
+                    enet_host_create_shared(&enet_addr, peer_count, internal_defs::all_channel_count, in_bandwidth, out_bandwidth) :
+                    enet_host_create(&enet_addr, peer_count, internal_defs::all_channel_count, in_bandwidth, out_bandwidth);
+
+                if (m_enet_host == nullptr)
                     break;
-                case peer::state::disconnecting:
-                    if (m_common_data.
-                        get_policy().
-                        timed_out(disconnect_timeout,
-                                  timestamp(timestamp::current_time)
-                                  - m_peer->begin_period))
+
+                m_shards.push_back(new io_shard(this, m_enet_host));
+            }
+
+            fungus_util_assert(!m_shards.empty(),
+                "fungus_util::unified_host_instance<networked>::unified_host_instance(): could not create enet host!");
+
+            if (m_shards.size() > 1)
+            {
+                enet_addr.port = ENET_PORT_ANY;
+
+                ENetHost *m_enet_host = enet_host_create(&enet_addr, peer_count, internal_defs::all_channel_count,
+                                                         in_bandwidth, out_bandwidth);
+
+                fungus_util_assert(m_enet_host != nullptr,
+                    "fungus_util::unified_host_instance<networked>::unified_host_instance(): could not create enet host!");
+
+                m_shards.push_back(new io_shard(this, m_enet_host));
+            }
+
+            m_connect_shard = m_shards.back();
+        }
+
+        // called with every peer gone, so every link this side knows of
+        // has been released.
+        inline void stop_io_shards()
+        {
+            for (io_shard *m_shard: m_shards)
+                m_shard->stop();
+
+            // incoming links this side never saw are freed here; the
+            // enet hosts are about to go anyway.
+            for (io_shard *m_shard: m_shards)
+            {
+                io_result m_result;
+                while (m_shard->pop_result_stopped(m_result))
+                {
+                    switch (m_result.m_type)
                     {
-                        timed_out = true;
-                        m_event = event(event::type::disconnected, disconnect_reason_timeout, m_peer);
-                    }
+                    case io_result::type::received:
+                        delete m_result.m_message;
+                        break;
+                    case io_result::type::connected:
+                        if (!m_result.m_link->m_peer && !m_result.m_link->b_released)
+                            delete m_result.m_link;
+                        break;
+                    case io_result::type::released:
+                        delete m_result.m_link;
+                        break;
+                    default:
+                        break;
+                    };
+                }
+
+                delete m_shard;
+            }
+
+            m_shards.clear();
+            m_connect_shard = nullptr;
+        }
+
+        inline void arm_timeout(peer *m_peer, timeout_period_type period_type)
+        {
+            m_timeouts.arm(m_peer, period_type, m_common_data.get_policy().deadline(period_type, monotonic_clock::read()));
+        }
+
+        inline void check_for_timeouts()
+        {
+            if (m_timeouts.empty()) return;
+
+            nsec_duration_t now = monotonic_clock::now();
+
+            peer *m_peer;
+            while (m_timeouts.next_expired(now, m_peer))
+            {
+                switch (m_peer->m_timeout.period_type)
+                {
+                case connection_timeout:
+                    if (m_peer->m_state != peer::state::connecting) continue;
+                    event_queue.push(event(event::type::rejected, reject_reason_host_timeout, m_peer));
+                    break;
+                case disconnect_timeout:
+                    if (m_peer->m_state != peer::state::disconnecting) continue;
+                    event_queue.push(event(event::type::disconnected, disconnect_reason_timeout, m_peer));
                     break;
                 default:
                     continue;
                     break;
                 };
 
-                if (timed_out)
-                {
-                    event_queue.push(m_event);
-                    m_peer->reset();
-                }
+                m_peer->reset();
             }
         }
     public:
-        inline unified_host_instance(common_data &m_common_data, const ipv4 &m_ipv4, uint32_t in_bandwidth = 0, uint32_t out_bandwidth = 0):
+        // with b_io_thread, the host services enet on io threads, and
+        // dispatch() only picks up what they have done.  more than one
+        // shard implies b_io_thread.
+        inline unified_host_instance(common_data &m_common_data, const ipv4 &m_ipv4,
+                                     uint32_t in_bandwidth = 0, uint32_t out_bandwidth = 0,
+                                     const dispatch_budget &m_budget = dispatch_budget(),
+                                     bool b_io_thread = false, size_t shard_count = 1):
             unified_host_base(m_common_data),
             m_allocator(m_common_data.get_max_peers() / 64 + 1),
             enet_host(nullptr),
             enet_peer_map(m_common_data.get_max_peers() * 2, enet_peer_hash_type(m_allocator)),
             event_queue(),
-            agg(m_common_data.get_endian_converter()),
-            sep(m_common_data.get_endian_converter())
+            agg(m_common_data.get_endian_converter(),
+                m_common_data.get_compression_codec(),
+                &m_common_data.get_compression_dictionary()),
+            sep(m_common_data.get_endian_converter(),
+                m_common_data.get_compression_codec(),
+                &m_common_data.get_compression_dictionary(),
+                m_common_data.get_max_decompressed_size()),
+            m_timeouts(),
+            m_budget(m_budget),
+            m_stats(),
+            b_io_thread(b_io_thread || shard_count > 1),
+            m_shards(),
+            m_connect_shard(nullptr),
+            m_next_shard(0),
+            m_poller(nullptr)
         {
+            enet_peer_map.clear();
+
+            if (this->b_io_thread)
+            {
+                start_io_shards(m_ipv4, in_bandwidth, out_bandwidth, shard_count);
+                return;
+            }
+
             ENetAddress enet_addr;
             enet_addr.host = m_ipv4.m_host.value;
             enet_addr.port = m_ipv4.port_i;
@@ -315,8 +1170,6 @@ namespace fungus_net
 
             fungus_util_assert(enet_host != nullptr,
                 "fungus_util::unified_host_instance<networked>::unified_host_instance(): could not create enet host!");
-
-            enet_peer_map.clear();
         }
 
         virtual ~unified_host_instance()
@@ -324,7 +1177,10 @@ namespace fungus_net
             reset_all_peers();
             enet_peer_map.clear();
 
-            enet_host_destroy(enet_host);
+            if (b_io_thread)
+                stop_io_shards();
+            else
+                enet_host_destroy(enet_host);
         }
 
         virtual unified_host_type get_type() const
@@ -365,7 +1221,7 @@ namespace fungus_net
 
             if (success)
             {
-                enet_peer_map.erase(m_native_peer->get_enet_peer());
+                enet_peer_map.erase(m_native_peer->get_map_key());
                 m_common_data.get_policy().drop_peer();
             }
 
@@ -374,11 +1230,16 @@ namespace fungus_net
 
         virtual void dispatch()
         {
-            agg.send_all();
-
-            ENetEvent enet_event;
-            if (enet_host_service(enet_host, &enet_event, 0) > 0)
-                handle_enet_event(enet_event);
+            if (b_io_thread)
+            {
+                flush_io_commands();
+                drain_io_results();
+            }
+            else
+            {
+                agg.send_all();
+                drain_enet_events();
+            }
 
             check_for_timeouts();
         }
@@ -406,6 +1267,76 @@ namespace fungus_net
             else
                 return false;
         }
+        virtual dispatch_stats get_dispatch_stats() const
+        {
+            return m_stats;
+        }
+
+        virtual compression_stats get_compression_stats() const
+        {
+            if (!b_io_thread)
+                return agg.get_compression_stats();
+
+            compression_stats m_compression_stats;
+            for (const io_shard *m_shard: m_shards)
+            {
+                compression_stats m_shard_stats = m_shard->get_compression_stats();
+
+                m_compression_stats.bytes_in  += m_shard_stats.bytes_in;
+                m_compression_stats.bytes_out += m_shard_stats.bytes_out;
+            }
+
+            return m_compression_stats;
+        }
+
+        virtual size_t reclaim(bool b_trim)
+        {
+            size_t n_bytes = b_trim ? m_allocator.trim() : m_allocator.reclaim();
+
+            if (!b_io_thread)
+                return n_bytes + agg.reclaim(b_trim) + sep.reclaim(b_trim);
+
+            for (io_shard *m_shard: m_shards)
+                n_bytes += m_shard->reclaim(b_trim);
+
+            return n_bytes;
+        }
+
+        virtual void watch(poller &m_poller)
+        {
+            this->m_poller.store(&m_poller);
+
+            if (!b_io_thread)
+                m_poller.watch(enet_host->socket);
+        }
+
+        virtual bool is_dispatch_pending(nsec_duration_t &timeout)
+        {
+            if (b_io_thread)
+            {
+                for (io_shard *m_shard: m_shards)
+                {
+                    if (m_shard->count_results() > 0 || m_shard->commands_pending())
+                        return true;
+                }
+            }
+            else
+            {
+                if (agg.packets_queued() || m_stats.events_remaining > 0)
+                    return true;
+
+                enet_uint32 msec;
+                if (enet_host_service_timeout(enet_host, &msec))
+                {
+                    if (msec == 0)
+                        return true;
+
+                    lower_timeout(timeout, (nsec_duration_t)msec * 1000000);
+                }
+            }
+
+            return m_timeouts.is_due(monotonic_clock::read(), timeout);
+        }
     };
 }
 
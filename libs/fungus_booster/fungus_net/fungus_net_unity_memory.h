@@ -19,13 +19,16 @@ namespace fungus_net
             }
         };
 
-        typedef fungus_concurrency::inlined::comm_tplt<message *, __discard_functor> comm_type;
-        typedef comm_type::channel_id                                                channel_id;
-        typedef comm_type::event                                                     event;
+        // dispatch() runs every host dispatch, so messages held back by a
+        // full ring go out on the next one.
+        typedef fungus_concurrency::inlined::comm_tplt<message *, __discard_functor,
+                                                       fungus_concurrency::spsc_ring> comm_type;
+        typedef comm_type::channel_id                                                 channel_id;
+        typedef comm_type::event                                                      event;
 
         enum {null_channel_id = comm_type::null_channel_id};
     private:
-        fungus_concurrency::inlined::comm_tplt<message *, __discard_functor> impl_;
+        comm_type impl_;
 
     public:
         FUNGUSUTIL_ALWAYS_INLINE inline __memory_host(size_t max_channels):
@@ -45,6 +48,8 @@ namespace fungus_net
         FUNGUSUTIL_ALWAYS_INLINE inline bool       peek_event(event &m_event) const                  {return impl_.peek_event(m_event);}
         FUNGUSUTIL_ALWAYS_INLINE inline bool       get_event(event &m_event)                         {return impl_.get_event(m_event);}
         FUNGUSUTIL_ALWAYS_INLINE inline void       clear_events()                                    {       impl_.clear_events();}
+        FUNGUSUTIL_ALWAYS_INLINE inline bool       has_activity(nsec_duration_t &timeout)            {return impl_.has_activity(timeout);}
+        FUNGUSUTIL_ALWAYS_INLINE inline notifier  &get_activity_notifier()                           {return impl_.get_activity_notifier();}
     };
 
     unified_host_instance<unified_host_type::memory> *__unified_memory_host(unified_host_base *m_base);
@@ -55,7 +60,7 @@ namespace fungus_net
     protected:
         class peer;
 
-        typedef block_allocator<unified_host_instance::peer, 64> peer_block_allocator;
+        typedef fungus_concurrency::concurrent_block_allocator<unified_host_instance::peer, 64> peer_block_allocator;
 
         class peer: unified_host_base::peer
         {
@@ -67,7 +72,7 @@ namespace fungus_net
 
             std::queue<message *> m_in_messages;
 
-            timestamp begin_period;
+            timeout_node m_timeout;
 
             inline peer(unified_host_base *parent):
                 unified_host_base::peer(parent),
@@ -114,6 +119,9 @@ namespace fungus_net
                 message *m_message;
                 while (m_host->channel_receive(m_id, m_message))
                     m_in_messages.push(m_message);
+
+                if (!m_in_messages.empty())
+                    mark_ready();
             }
 
             inline __memory_host::channel_id get_channel_id()
@@ -122,7 +130,7 @@ namespace fungus_net
             }
 
             friend class unified_host_instance;
-            friend class block_allocator<unified_host_instance::peer, 64>;
+            friend class fungus_concurrency::concurrent_block_allocator<unified_host_instance::peer, 64>;
         public:
             virtual unified_host_type get_host_type() const {return unified_host_type::memory;}
 
@@ -156,7 +164,7 @@ namespace fungus_net
                 m_id = m_host->open_channel(o_host_inst->m_host, data);
                 if (m_id == __memory_host::null_channel_id) return false;
 
-                begin_period = timestamp::current_time;
+                host_parent->arm_timeout(this, connection_timeout);
                 m_state      = state::connecting;
 
                 return host_parent->m_peer_map.insert(std::move(peer_map_entry(m_id, this)))
@@ -170,7 +178,7 @@ namespace fungus_net
 
                 if (success)
                 {
-                    begin_period = timestamp::current_time;
+                    host_parent->arm_timeout(this, disconnect_timeout);
                     m_state      = state::disconnecting;
                 }
 
@@ -187,6 +195,8 @@ namespace fungus_net
                     m_state = state::none;
                 }
 
+                host_parent->m_timeouts.disarm(this);
+
                 return true;
             }
         };
@@ -197,11 +207,16 @@ namespace fungus_net
         typedef hash_map<peer_hash_type>                    peer_map_type;
         typedef typename peer_map_type::entry               peer_map_entry;
 
+        typedef timeout_queue<unified_host_instance::peer, &unified_host_instance::peer::m_timeout> timeout_queue_type;
+
         peer_block_allocator m_allocator;
 
         __memory_host      *m_host;
         peer_map_type     m_peer_map;
         std::queue<event> event_queue;
+        dispatch_stats    m_stats;
+
+        timeout_queue_type m_timeouts;
 
         virtual peer *new_peer(__memory_host::channel_id m_id)
         {
@@ -221,6 +236,7 @@ namespace fungus_net
                     peer *m_peer = it->value;
                     m_peer->m_id = m_host_event.id;
                     m_peer->m_state = peer::state::connected;
+                    m_timeouts.disarm(m_peer);
 
                     event_queue.push(event(event::type::connected, m_host_event.data, m_peer));
                 }
@@ -237,6 +253,8 @@ namespace fungus_net
                 if (it != m_peer_map.end())
                 {
                     peer *m_peer = it->value;
+                    m_timeouts.disarm(m_peer);
+
                     switch (m_host_event.data)
                     {
                     case -reject_reason_host_deny:
@@ -256,48 +274,36 @@ namespace fungus_net
             };
         }
 
+        inline void arm_timeout(peer *m_peer, timeout_period_type period_type)
+        {
+            m_timeouts.arm(m_peer, period_type, m_common_data.get_policy().deadline(period_type, monotonic_clock::read()));
+        }
+
         inline void check_for_timeouts()
         {
-            for (auto &it: m_peer_map)
-            {
-                peer *m_peer = it.value;
-                bool timed_out = false;
-                event m_event;
+            if (m_timeouts.empty()) return;
 
-                switch (m_peer->m_state)
+            nsec_duration_t now = monotonic_clock::now();
+
+            peer *m_peer;
+            while (m_timeouts.next_expired(now, m_peer))
+            {
+                switch (m_peer->m_timeout.period_type)
                 {
-                case peer::state::connecting:
-                    if (m_common_data.
-                        get_policy().
-                        timed_out(connection_timeout,
-                                  timestamp(timestamp::current_time)
-                                  - m_peer->begin_period))
-                    {
-                        timed_out = true;
-                        m_event = event(event::type::rejected, reject_reason_host_timeout, m_peer);
-                    }
+                case connection_timeout:
+                    if (m_peer->m_state != peer::state::connecting) continue;
+                    event_queue.push(event(event::type::rejected, reject_reason_host_timeout, m_peer));
                     break;
-                case peer::state::disconnecting:
-                    if (m_common_data.
-                        get_policy().
-                        timed_out(disconnect_timeout,
-                                  timestamp(timestamp::current_time)
-                                  - m_peer->begin_period))
-                    {
-                        timed_out = true;
-                        m_event = event(event::type::disconnected, disconnect_reason_timeout, m_peer);
-                    }
+                case disconnect_timeout:
+                    if (m_peer->m_state != peer::state::disconnecting) continue;
+                    event_queue.push(event(event::type::disconnected, disconnect_reason_timeout, m_peer));
                     break;
                 default:
                     continue;
                     break;
                 };
 
-                if (timed_out)
-                {
-                    event_queue.push(m_event);
-                    m_peer->reset();
-                }
+                m_peer->reset();
             }
         }
     public:
@@ -306,7 +312,9 @@ namespace fungus_net
             m_allocator(m_common_data.get_max_peers() / 64 + 1),
             m_host(nullptr),
             m_peer_map(m_common_data.get_max_peers() * 2, peer_hash_type(m_allocator)),
-            event_queue()
+            event_queue(),
+            m_stats(),
+            m_timeouts()
         {
             m_host = new __memory_host(m_common_data.get_max_peers());
 
@@ -373,9 +381,16 @@ namespace fungus_net
 
             m_host->dispatch();
 
+            size_t n = 0;
+
             __memory_host::event m_host_event;
             while (m_host->get_event(m_host_event))
+            {
                 handle_host_event(m_host_event);
+                ++n;
+            }
+
+            m_stats = dispatch_stats(n, 0);
 
             check_for_timeouts();
         }
@@ -403,6 +418,33 @@ namespace fungus_net
             else
                 return false;
         }
+
+        virtual dispatch_stats get_dispatch_stats() const
+        {
+            return m_stats;
+        }
+
+        // memory hosts never serialize, so there is nothing to compress.
+        virtual compression_stats get_compression_stats() const
+        {
+            return compression_stats();
+        }
+
+        virtual size_t reclaim(bool b_trim)
+        {
+            return b_trim ? m_allocator.trim() : m_allocator.reclaim();
+        }
+
+        virtual void watch(poller &m_poller)
+        {
+            m_poller.watch(m_host->get_activity_notifier());
+        }
+
+        virtual bool is_dispatch_pending(nsec_duration_t &timeout)
+        {
+            return m_host->has_activity(timeout) ||
+                   m_timeouts.is_due(monotonic_clock::read(), timeout);
+        }
     };
 }
 
@@ -125,6 +125,52 @@ namespace fungus_net
         }
     }
 
+    inline void host::impl::reclaim_memory(bool b_trim)
+    {
+        if (b_trim)
+        {
+            m_peer_concrete_allocator.trim();
+            m_peer_group_allocator.trim();
+        }
+        else
+        {
+            m_peer_concrete_allocator.reclaim();
+            m_peer_group_allocator.reclaim();
+        }
+
+        if (m_unified_host)
+            m_unified_host->reclaim(b_trim);
+    }
+
+    inline void host::impl::drain_submissions()
+    {
+        submission m_submission;
+        while (m_submissions.pop(m_submission))
+        {
+            send_message(m_submission.m_id, m_submission.m_message,
+                         m_submission.b_exclusion ? &m_submission.m_exclusion_id : nullptr);
+        }
+    }
+
+    inline void host::impl::discard_submissions()
+    {
+        submission m_submission;
+        while (m_submissions.pop(m_submission))
+            delete m_submission.m_message;
+    }
+
+    inline void host::impl::publish_peer(peer_id m_id, peer *m_peer)
+    {
+        write_lock guard(m_reader_mutex);
+        m_virtual_peers_by_id.insert(virtual_peer_by_id_map::entry(m_id, m_peer));
+    }
+
+    inline void host::impl::unpublish_peer(peer_id m_id)
+    {
+        write_lock guard(m_reader_mutex);
+        m_virtual_peers_by_id.erase(m_id);
+    }
+
     inline peer_concrete *host::impl::create_peer_concrete(unified_host::peer *m_unified_peer, peer_concrete::mode m_mode)
     {
         peer_id m_id = alloc_peer_id();
@@ -144,9 +190,9 @@ namespace fungus_net
         m_peers_by_unified_peer.insert(peer_by_unified_peer_map::entry(m_unified_peer, m_peer_concrete));
 
         if (m_peer_concrete->get_state() == peer::state::authenticating)
-            m_peers_authenticating.insert(peer_concrete_map::entry(m_peer_concrete, _s_nil()));
+            begin_authenticating(m_peer_concrete);
 
-        m_virtual_peers_by_id.insert(virtual_peer_by_id_map::entry(m_id, m_peer_concrete));
+        publish_peer(m_id, m_peer_concrete);
 
         m_group_all->add_member(m_peer_concrete);
         return m_peer_concrete;
@@ -163,9 +209,9 @@ namespace fungus_net
         m_peers_by_unified_peer.erase(m_peer_concrete->get_unified_peer());
 
         if (m_peer_concrete->get_state() == peer::state::authenticating)
-            m_peers_authenticating.erase(m_peer_concrete);
+            end_authenticating(m_peer_concrete);
 
-        m_virtual_peers_by_id.erase(m_id);
+        unpublish_peer(m_id);
 
         free_peer_id(m_id);
 
@@ -173,6 +219,21 @@ namespace fungus_net
         m_unified_host->destroy_peer(m_unified_peer);
     }
 
+    inline void host::impl::begin_authenticating(peer_concrete *m_peer_concrete)
+    {
+        // connect() gets here outside of dispatch(), where m_dispatch_time
+        // may be a second old, or 0 before the first dispatch.
+        m_peers_authenticating.insert(peer_concrete_map::entry(m_peer_concrete, _s_nil()));
+        m_auth_timeouts.arm(m_peer_concrete, auth_timeout,
+                            m_common_data.get_policy().deadline(auth_timeout, monotonic_clock::read()));
+    }
+
+    inline void host::impl::end_authenticating(peer_concrete *m_peer_concrete)
+    {
+        m_peers_authenticating.erase(m_peer_concrete);
+        m_auth_timeouts.disarm(m_peer_concrete);
+    }
+
     inline peer_group *host::impl::create_group_internal(peer_id m_id)
     {
         peer_group *m_peer_group =
@@ -183,7 +244,7 @@ namespace fungus_net
             );
 
         m_groups_by_id.insert(group_by_id_map::entry(m_id, m_peer_group));
-        m_virtual_peers_by_id.insert(virtual_peer_by_id_map::entry(m_id, m_peer_group));
+        publish_peer(m_id, m_peer_group);
 
         return m_peer_group;
     }
@@ -193,7 +254,7 @@ namespace fungus_net
         if (m_peer_concrete)
         {
             m_peer_concrete->set_state(peer::state::authenticating);
-            m_peers_authenticating.insert(peer_concrete_map::entry(m_peer_concrete, _s_nil()));
+            begin_authenticating(m_peer_concrete);
         }
         else
             m_peer_concrete = create_peer_concrete(m_unified_host_event.m_peer, peer_concrete::mode::server);
@@ -276,6 +337,8 @@ namespace fungus_net
     template <unified_host_type __type, typename... argT>
     inline peer_concrete *host::impl::connect_internal(auth_payload *m_payload, argT&&... argV)
     {
+        wake();
+
         unified_host::peer *m_unified_peer = m_unified_host->new_peer(__type);
 
         if (!m_unified_peer->connect(std::forward<argT>(argV)...))
@@ -298,49 +361,39 @@ namespace fungus_net
 
     inline void host::impl::check_for_auth_payloads()
     {
-        std::queue<peer_concrete *> m_peers_finished_authenticating;
-
-        for (auto &entry: m_peers_authenticating)
+        for (peer_concrete *m_peer_concrete: m_peers_with_payloads)
         {
-            peer_concrete *m_peer_concrete = entry.key;
-
-            if (m_common_data.get_policy().timed_out(auth_timeout, m_peer_concrete->auth_timeout_period()))
+            auth_payload *m_payload;
+            while ((m_payload = m_peer_concrete->next_payload()))
             {
-                m_event_queue.push(event(event::type::auth_timeout,
-                                         m_peer_concrete->get_id(),
-                                         m_peer_concrete->get_user_data(), 0));
+                m_event_queue.push(event(m_peer_concrete->get_id(),
+                                         m_peer_concrete->get_user_data(),
+                                         m_payload));
 
-                destroy_peer_concrete(m_peer_concrete);
-            }
-            else
-            {
-                auth_payload *m_payload;
-                while ((m_payload = m_peer_concrete->next_payload()))
+                auth_status m_status = m_payload->get_status();
+                if (m_status == auth_status::success)
                 {
-                    m_event_queue.push(event(m_peer_concrete->get_id(),
-                                             m_peer_concrete->get_user_data(),
-                                             m_payload));
-
-                    switch (m_payload->get_status())
-                    {
-                    case auth_status::success:
-                        m_peer_concrete->set_state(peer::state::connected);
-                        m_peers_finished_authenticating.push(m_peer_concrete);
-                        break;
-                    case auth_status::failure:
-                        destroy_peer_concrete(m_peer_concrete);
-                        break;
-                    default:
-                        break;
-                    };
+                    end_authenticating(m_peer_concrete);
+                    m_peer_concrete->set_state(peer::state::connected);
+                }
+                else if (m_status == auth_status::failure)
+                {
+                    destroy_peer_concrete(m_peer_concrete);
+                    break;
                 }
             }
         }
 
-        while (!m_peers_finished_authenticating.empty())
+        m_peers_with_payloads.clear();
+
+        peer_concrete *m_peer_concrete;
+        while (m_auth_timeouts.next_expired(m_dispatch_time, m_peer_concrete))
         {
-            m_peers_authenticating.erase(m_peers_finished_authenticating.front());
-            m_peers_finished_authenticating.pop();
+            m_event_queue.push(event(event::type::auth_timeout,
+                                     m_peer_concrete->get_id(),
+                                     m_peer_concrete->get_user_data(), 0));
+
+            destroy_peer_concrete(m_peer_concrete);
         }
     }
 
@@ -372,8 +425,12 @@ namespace fungus_net
         m_peers_by_unified_peer(),
         m_peers_by_id(),
         m_peers_authenticating(),
+        m_auth_timeouts(),
+        m_peers_with_payloads(),
         m_groups_by_id(),
         m_virtual_peers_by_id(),
+        m_reader_mutex(),
+        b_running(false),
 
         // message intercept map
         m_intercept_map(),
@@ -387,12 +444,22 @@ namespace fungus_net
         // peer id allocation stuff
         m_id_ctr(0),
         m_recycled_ids(),
-        m_free_ids()
+        m_free_ids(),
+
+        m_dispatch_time(0),
+        m_reclaim_time(0),
+
+        // concurrent send queue
+        m_submissions(),
+        m_concurrent_send(false),
+
+        m_poller()
     {}
 
     host::impl::~impl()
     {
         if (m_unified_host) stop();
+        discard_submissions();
     }
 
     bool host::impl::start(uint32_t flags, size_t max_peers, const networked_host_args &m_net_args, const timeout_period_args &m_time_args)
@@ -405,23 +472,43 @@ namespace fungus_net
 
         m_common_data.get_message_factory_manager().clear_factories();
         m_common_data.get_message_factory_manager().add_factory(payload_message::factory());
+        m_common_data.get_message_factory_manager().freeze();
         m_common_data.get_endian_converter().lazy_register_numeric_types();
-        m_common_data.set_policy(unified_host::default_policy::factory(max_peers, m_timeout_periods));
+        {
+            write_lock guard(m_reader_mutex);
+            m_common_data.set_policy(unified_host::default_policy::factory(max_peers, m_timeout_periods));
+        }
+        m_common_data.set_compression(m_net_args.compression, m_net_args.dictionary,
+                                      m_net_args.max_decompressed_size);
 
         uint32_t m_unified_host_flags =
             ((flags & flag_support_memory_connection)    ? unified_host_flag_memory    : 0)|
-            ((flags & flag_support_networked_connection) ? unified_host_flag_networked : 0);
+            ((flags & flag_support_networked_connection) ? unified_host_flag_networked : 0)|
+            ((flags & flag_network_thread)               ? unified_host_flag_io_thread : 0);
 
         bool success = m_unified_host.create(m_common_data,
                                              m_unified_host_flags, m_net_args.m_ipv4,
-                                             m_net_args.in_bandwidth, m_net_args.out_bandwidth);
+                                             m_net_args.in_bandwidth, m_net_args.out_bandwidth,
+                                             unified_host::dispatch_budget(m_net_args.max_dispatch_events,
+                                                                           m_net_args.max_dispatch_usec),
+                                             m_net_args.shard_count);
 
         if (success)
+        {
             m_group_all = create_group_internal(all_peer_id);
+            m_unified_host->watch(m_poller);
+
+            write_lock guard(m_reader_mutex);
+            b_running = true;
+
+            // anything still queued was meant for a previous run.
+            discard_submissions();
+            m_concurrent_send.store((flags & flag_concurrent_send) != 0);
+        }
 
         m_peers_by_id.insert(peer_by_id_map::entry(null_peer_id, nullptr));
         m_groups_by_id.insert(group_by_id_map::entry(null_peer_id, nullptr));
-        m_virtual_peers_by_id.insert(virtual_peer_by_id_map::entry(null_peer_id, nullptr));
+        publish_peer(null_peer_id, nullptr);
 
         return success;
     }
@@ -432,6 +519,13 @@ namespace fungus_net
 
         if (success)
         {
+            // readers stop finding peers before any is destroyed.
+            {
+                write_lock guard(m_reader_mutex);
+                b_running = false;
+                m_virtual_peers_by_id.clear();
+            }
+
             for (auto &entry: m_groups_by_id)
             {
                 if (entry.value != nullptr)
@@ -447,19 +541,32 @@ namespace fungus_net
             m_peers_by_unified_peer.clear();
             m_peers_by_id.clear();
             m_peers_authenticating.clear();
+            m_auth_timeouts.clear();
             m_groups_by_id.clear();
-            m_virtual_peers_by_id.clear();
             m_intercept_map.clear();
 
             event m_event;
             while (next_event(m_event));
             m_event_queue.clear_callbacks();
 
+            // end a dispatch_wait() on another thread.
+            wake();
+            m_poller.unwatch_all();
+
             m_unified_host->destroy_all_peers();
             m_unified_host.destroy();
 
+            reclaim_memory(true);
+
+            // nothing is left to decode messages, so the tables and
+            // factories retired while running can go.
+            m_common_data.get_message_factory_manager().unfreeze();
+
             m_group_all = nullptr;
 
+            m_concurrent_send.store(false);
+            discard_submissions();
+
             garbage_collect_peer_ids();
         }
 
@@ -468,17 +575,20 @@ namespace fungus_net
 
     bool host::impl::is_running() const
     {
-        return m_unified_host;
+        read_lock guard(m_reader_mutex);
+        return b_running;
     }
 
     size_t host::impl::get_max_peers() const
     {
+        read_lock guard(m_reader_mutex);
         return m_common_data.get_max_peers();
     }
 
     peer *host::impl::get_peer(peer_id m_id)
     {
-        if (!m_unified_host) return NULL;
+        read_lock guard(m_reader_mutex);
+        if (!b_running) return NULL;
 
         auto it = m_virtual_peers_by_id.find(m_id);
         return it != m_virtual_peers_by_id.end() ? it->value : nullptr;
@@ -486,7 +596,8 @@ namespace fungus_net
 
     const peer *host::impl::get_peer(peer_id m_id) const
     {
-        if (!m_unified_host) return NULL;
+        read_lock guard(m_reader_mutex);
+        if (!b_running) return NULL;
 
         auto it = m_virtual_peers_by_id.find(m_id);
         return it != m_virtual_peers_by_id.end() ? it->value : nullptr;
@@ -534,7 +645,7 @@ namespace fungus_net
             m_id = m_peer->get_id();
 
             m_groups_by_id.erase(m_id);
-            m_virtual_peers_by_id.erase(m_id);
+            unpublish_peer(m_id);
 
             free_peer_id(m_id);
 
@@ -589,6 +700,8 @@ namespace fungus_net
         if (!m_peer)                                   return false;
         if (m_peer->get_state() == peer::state::group) return false;
 
+        wake();
+
         peer_concrete *m_peer_concrete = static_cast<peer_concrete *>(m_peer);
         bool success = m_peer_concrete->send_payload(m_payload);
 
@@ -623,6 +736,8 @@ namespace fungus_net
 
         fungus_util_assert(data != (uint32_t)-reject_reason_host_deny, _m_assert_string);
 
+        wake();
+
         peer_base *m_peer_base = static_cast<peer_base *>(m_peer);
         return m_peer_base->disconnect(data, m_exclusion);
     }
@@ -640,6 +755,64 @@ namespace fungus_net
                false;
     }
 
+    bool host::impl::send_message(peer_id m_id, const message *m_message, const peer_id *m_exclusion_id)
+    {
+        wake();
+
+        peer *m_peer      = get_peer(m_id);
+        peer *m_exclusion = m_exclusion_id ? get_peer(*m_exclusion_id) : nullptr;
+
+        bool success = m_peer && (!m_exclusion_id || m_exclusion);
+        if (success && m_peer->get_state() == peer::state::group)
+            return m_peer->send_message(m_message, m_exclusion);
+
+        // a networked peer serializes the message straight in to its
+        // aggregate and leaves it to us.  a memory peer takes over what
+        // it is sent, so it is handed a copy the way a group would.
+        if (success)
+        {
+            success = !m_exclusion || !m_exclusion->has_peer(m_peer);
+            if (success)
+            {
+                peer_concrete *m_peer_concrete = static_cast<peer_concrete *>(m_peer);
+
+                if (m_peer_concrete->get_unified_peer()->get_host_type() == unified_host_type::networked)
+                    success = m_peer_concrete->send_message(m_message);
+                else
+                {
+                    unified_host::broadcast m_broadcast(m_message);
+                    success = m_peer_concrete->send_broadcast(m_broadcast);
+                }
+            }
+        }
+
+        delete m_message;
+        return success;
+    }
+
+    bool host::impl::submit_message(peer_id m_id, const message *m_message, const peer_id *m_exclusion_id)
+    {
+        if (!m_concurrent_send.load()) return false;
+
+        submission m_submission;
+        m_submission.m_message      = m_message;
+        m_submission.m_id           = m_id;
+        m_submission.m_exclusion_id = m_exclusion_id ? *m_exclusion_id : null_peer_id;
+        m_submission.b_exclusion    = m_exclusion_id != nullptr;
+
+        if (!m_submissions.push(m_submission))
+            return false;
+
+        wake();
+        return true;
+    }
+
+    void host::impl::flush_submissions()
+    {
+        if (m_unified_host)
+            drain_submissions();
+    }
+
     bool host::impl::dispatch()
     {
         bool success = false;
@@ -647,24 +820,35 @@ namespace fungus_net
         if (m_unified_host)
         {
             garbage_collect_peer_ids();
+            drain_submissions();
 
             m_unified_host->dispatch();
+            m_dispatch_time = monotonic_clock::now();
 
             unified_host::event m_unified_host_event;
             while (m_unified_host->next_event(m_unified_host_event))
                 process_unified_host_event(m_unified_host_event);
 
-            for (auto &entry: m_peers_by_id)
+            unified_host::peer *m_unified_peer;
+            while (m_unified_host->next_ready_peer(m_unified_peer))
             {
-                peer_concrete *m_peer_concrete = entry.value;
-                if (m_peer_concrete == nullptr) continue;
+                auto it = m_peers_by_unified_peer.find(m_unified_peer);
+                if (it == m_peers_by_unified_peer.end()) continue;
 
-                unified_host::peer *m_unified_peer = m_peer_concrete->get_unified_peer();
+                peer_concrete *m_peer_concrete = static_cast<peer_concrete *>(it->value);
 
                 message *m_message;
                 peer_id  m_id = m_peer_concrete->get_id();
                 while ((m_message = m_unified_peer->receive()))
                     m_peer_concrete->push_incoming_message(peer::incoming_message(m_message, m_id));
+
+                if (m_peer_concrete->get_state() == peer::state::authenticating &&
+                    m_peer_concrete->has_payloads())
+                {
+                    m_auth_timeouts.arm(m_peer_concrete, auth_timeout,
+                                        m_common_data.get_policy().deadline(auth_timeout, m_dispatch_time));
+                    m_peers_with_payloads.push_back(m_peer_concrete);
+                }
             }
 
             check_for_auth_payloads();
@@ -672,12 +856,66 @@ namespace fungus_net
 
             m_event_queue.process_events();
 
+            if (m_dispatch_time - m_reclaim_time >= reclaim_period)
+            {
+                reclaim_memory(false);
+                m_reclaim_time = m_dispatch_time;
+            }
+
             success = true;
         }
 
         return success;
     }
 
+    bool host::impl::begin_wait(nsec_duration_t &timeout)
+    {
+        if (!m_unified_host) return false;
+
+        // arm before looking, so anything that turns up after we look
+        // still ends the wait.
+        m_poller.arm();
+
+        nsec_duration_t now = monotonic_clock::update();
+
+        bool b_pending = !m_submissions.empty() ||
+                         m_auth_timeouts.is_due(now, timeout) ||
+                         m_unified_host->is_dispatch_pending(timeout);
+
+        if (b_pending)
+            m_poller.disarm();
+
+        return !b_pending;
+    }
+
+    void host::impl::end_wait()
+    {
+        m_poller.disarm();
+    }
+
+    poller &host::impl::get_poller()
+    {
+        return m_poller;
+    }
+
+    bool host::impl::get_dispatch_stats(dispatch_stats &m_stats) const
+    {
+        if (!m_unified_host) return false;
+
+        unified_host::dispatch_stats m_unified_stats = m_unified_host->get_dispatch_stats();
+        m_stats = dispatch_stats(m_unified_stats.events_processed, m_unified_stats.events_remaining);
+
+        return true;
+    }
+
+    bool host::impl::get_compression_stats(compression_stats &m_stats) const
+    {
+        if (!m_unified_host) return false;
+
+        m_stats = m_unified_host->get_compression_stats();
+        return true;
+    }
+
     bool host::impl::next_event(event &m_event)
     {
         bool success = peek_event(m_event);
@@ -836,17 +1074,21 @@ namespace fungus_net
                      const timeout_period_args &m_time_args)                                {lock guard(m); return pimpl_ && pimpl_->start(flags, max_peers, m_net_args, m_time_args);}
     bool host::stop()                                                                       {lock guard(m); return pimpl_ && pimpl_->stop();}
 
-    bool   host::is_running()    const                                                      {lock guard(m); return pimpl_ && pimpl_->is_running();}
-    size_t host::get_max_peers() const                                                      {lock guard(m); return pimpl_ && pimpl_->get_max_peers();}
+    // the read-only queries don't take the host lock.  the impl guards
+    // what they read with a reader lock of its own, and the factory manager
+    // and endian converter live as long as the impl does.
+
+    bool   host::is_running()    const                                                      {return pimpl_ && pimpl_->is_running();}
+    size_t host::get_max_peers() const                                                      {return pimpl_ ? pimpl_->get_max_peers() : 0;}
 
-          peer *host::get_peer(peer_id m_id)                                                {lock guard(m); return pimpl_ ? pimpl_->get_peer(m_id) : nullptr;}
-    const peer *host::get_peer(peer_id m_id) const                                          {lock guard(m); return pimpl_ ? pimpl_->get_peer(m_id) : nullptr;}
+          peer *host::get_peer(peer_id m_id)                                                {return pimpl_ ? pimpl_->get_peer(m_id) : nullptr;}
+    const peer *host::get_peer(peer_id m_id) const                                          {return pimpl_ ? pimpl_->get_peer(m_id) : nullptr;}
 
-          message_factory_manager &host::get_message_factory_manager()                      {lock guard(m); static message_factory_manager __temp_mfm; return pimpl_ ? pimpl_->get_message_factory_manager() : __temp_mfm;}
-    const message_factory_manager &host::get_message_factory_manager() const                {lock guard(m); static message_factory_manager __temp_mfm; return pimpl_ ? pimpl_->get_message_factory_manager() : __temp_mfm;}
+          message_factory_manager &host::get_message_factory_manager()                      {static message_factory_manager __temp_mfm; return pimpl_ ? pimpl_->get_message_factory_manager() : __temp_mfm;}
+    const message_factory_manager &host::get_message_factory_manager() const                {static message_factory_manager __temp_mfm; return pimpl_ ? pimpl_->get_message_factory_manager() : __temp_mfm;}
 
-          endian_converter &host::get_endian_converter()                                    {lock guard(m); static endian_converter __temp_ec; return pimpl_ ? pimpl_->get_endian_converter() : __temp_ec;}
-    const endian_converter &host::get_endian_converter() const                              {lock guard(m); static endian_converter __temp_ec; return pimpl_ ? pimpl_->get_endian_converter() : __temp_ec;}
+          endian_converter &host::get_endian_converter()                                    {static endian_converter __temp_ec; return pimpl_ ? pimpl_->get_endian_converter() : __temp_ec;}
+    const endian_converter &host::get_endian_converter() const                              {static endian_converter __temp_ec; return pimpl_ ? pimpl_->get_endian_converter() : __temp_ec;}
 
     peer *host::create_group()                                                              {lock guard(m); return pimpl_ ?  pimpl_->create_group() : nullptr;}
     bool  host::destroy_group(peer *m_peer)                                                 {lock guard(m); return pimpl_ && pimpl_->destroy_group(m_peer);}
@@ -876,8 +1118,76 @@ namespace fungus_net
     bool host::disconnect(peer *m_peer, uint32_t data, const peer *m_exclusion)             {lock guard(m); return pimpl_ && pimpl_->disconnect(m_peer, data, m_exclusion);}
     bool host::disconnect(peer_id m_id, uint32_t data, peer_id m_exclusion_id)              {lock guard(m); return pimpl_ && pimpl_->disconnect(m_id, data, m_exclusion_id);}
 
+    bool host::send_message(peer_id m_id, const message *m_message)
+    {
+        if (pimpl_ && pimpl_->submit_message(m_id, m_message, nullptr))
+            return true;
+
+        lock guard(m);
+        if (!pimpl_)
+        {
+            delete m_message;
+            return false;
+        }
+
+        pimpl_->flush_submissions();
+        return pimpl_->send_message(m_id, m_message, nullptr);
+    }
+
+    bool host::send_message(peer_id m_id, const message *m_message, peer_id m_exclusion_id)
+    {
+        if (pimpl_ && pimpl_->submit_message(m_id, m_message, &m_exclusion_id))
+            return true;
+
+        lock guard(m);
+        if (!pimpl_)
+        {
+            delete m_message;
+            return false;
+        }
+
+        pimpl_->flush_submissions();
+        return pimpl_->send_message(m_id, m_message, &m_exclusion_id);
+    }
+
     bool host::dispatch()                                                                   {lock guard(m); return pimpl_ && pimpl_->dispatch();}
 
+    bool host::dispatch_wait(sec_duration_t timeout)
+    {
+        return dispatch_wait_nsec(timeout < 0 ? -1 : sec_duration_to_nsec(timeout));
+    }
+
+    bool host::dispatch_wait_nsec(nsec_duration_t wait_timeout)
+    {
+        lock guard(m);
+        if (!pimpl_) return false;
+
+        // called from inside another host call, such as a callback, we
+        // could only drop one hold of m and would sleep holding the rest.
+        if (m.get_depth() > 1) return false;
+
+        // whatever ends the wait, whether work or a deadline, is for
+        // dispatch() to handle.
+        if (pimpl_->begin_wait(wait_timeout))
+        {
+            // the poller belongs to the impl, so it outlives a stop() made
+            // while we sleep.
+            poller &m_poller = pimpl_->get_poller();
+
+            m.unlock();
+            m_poller.wait(wait_timeout);
+            m.lock();
+
+            if (!pimpl_) return false;
+            pimpl_->end_wait();
+        }
+
+        return pimpl_->dispatch();
+    }
+
+    bool host::get_dispatch_stats(dispatch_stats &m_stats) const                            {lock guard(m); return pimpl_ && pimpl_->get_dispatch_stats(m_stats);}
+    bool host::get_compression_stats(compression_stats &m_stats) const                      {lock guard(m); return pimpl_ && pimpl_->get_compression_stats(m_stats);}
+
     bool host::next_event(event &m_event)                                                   {lock guard(m); return pimpl_ && pimpl_->next_event(m_event);}
     bool host::peek_event(event &m_event) const                                             {lock guard(m); return pimpl_ && pimpl_->peek_event(m_event);}
 
@@ -2,48 +2,260 @@
 #include "fungus_net_message_factory_manager.h"
 #include "fungus_net_defs_internal.h"
 
+#include <algorithm>
+#include <vector>
+
 namespace fungus_net
 {
     class message_factory_manager::impl
     {
     private:
+        // factories are owned by the manager rather than the map, so
+        // that a removed one can outlive its entry; see __drop().
         class factory_map_hash:
-            public default_hash_no_replace<message_type, message::factory *>
+            public default_hash_no_replace<message_type, message::factory *, hash_entry_ptr_no_delete>
         {};
 
         typedef hash_map<factory_map_hash> map_type;
 
+        // types at or above this go to the sparse part of a table.
+        static constexpr message_type max_dense_type = 4096;
+        static constexpr size_t       min_dense      = 64;
+
+        // readers of a published table never say when they are done
+        // with it, so a table replaced while frozen is only freed by
+        // unfreeze().  a new table is only needed when the dense part
+        // must grow or a sparse type is added, and past this many such
+        // changes they are refused until the map is unfrozen.
+        static constexpr size_t max_retired_tables = 16;
+
+        // a snapshot of the map.  types in [0, n_dense) are looked up
+        // directly; the few outliers (negative or large types, such as
+        // the payload type) are kept sorted and binary searched.  the
+        // slots of types it holds are changed in place, so only a type
+        // it has no slot for needs a new table.
+        struct table
+        {
+            struct sparse_entry
+            {
+                message_type               type;
+                atomic<message::factory *> factory;
+            };
+
+            atomic<message::factory *> *dense;
+            size_t                      n_dense;
+
+            sparse_entry               *sparse;
+            size_t                      n_sparse;
+
+            table *retired;
+
+            inline table(const map_type &factories, table *retired, size_t n_dense_min):
+                dense(nullptr), n_dense(min_dense), sparse(nullptr), n_sparse(0),
+                retired(retired)
+            {
+                size_t n_dense_used = n_dense_min;
+                for (auto it = factories.begin(); it != factories.end(); ++it)
+                {
+                    if (it->key >= 0 && it->key < max_dense_type)
+                        n_dense_used = std::max(n_dense_used, (size_t)it->key + 1);
+                    else
+                        ++n_sparse;
+                }
+
+                // room to grow, so that most types added later fit.
+                while (n_dense < n_dense_used) n_dense <<= 1;
+                n_dense = std::min(n_dense, (size_t)max_dense_type);
+
+                dense  = new atomic<message::factory *>[n_dense];
+                sparse = new sparse_entry[n_sparse];
+
+                std::vector<message_type> sparse_types;
+                sparse_types.reserve(n_sparse);
+
+                for (auto it = factories.begin(); it != factories.end(); ++it)
+                {
+                    if (it->key >= 0 && it->key < max_dense_type)
+                        dense[it->key].store(it->value, memory_order_relaxed);
+                    else
+                        sparse_types.push_back(it->key);
+                }
+
+                std::sort(sparse_types.begin(), sparse_types.end());
+
+                for (size_t i = 0; i < n_sparse; ++i)
+                {
+                    sparse[i].type = sparse_types[i];
+                    sparse[i].factory.store(factories.find(sparse_types[i])->value, memory_order_relaxed);
+                }
+            }
+
+            inline ~table()
+            {
+                delete[] dense;
+                delete[] sparse;
+
+                if (retired) delete retired;
+            }
+
+            // nullptr if this table has no slot for type.
+            FUNGUSUTIL_ALWAYS_INLINE inline
+            atomic<message::factory *> *find_slot(message_type type) const
+            {
+                if ((size_t)type < n_dense)
+                    return &dense[type];
+
+                size_t lo = 0, hi = n_sparse;
+                while (lo < hi)
+                {
+                    size_t mid = (lo + hi) / 2;
+                    if (sparse[mid].type < type)
+                        lo = mid + 1;
+                    else
+                        hi = mid;
+                }
+
+                return (lo < n_sparse && sparse[lo].type == type) ? &sparse[lo].factory : nullptr;
+            }
+
+            FUNGUSUTIL_ALWAYS_INLINE inline
+            const message::factory *find(message_type type) const
+            {
+                atomic<message::factory *> *slot = find_slot(type);
+                return slot ? slot->load(memory_order_acquire) : nullptr;
+            }
+
+            FUNGUSUTIL_NO_ASSIGN(table)
+        };
+
         mutable  mutex m;
         map_type factories;
+
+        // null until freeze().  a table replaced while frozen stays on
+        // its successor's retired chain.
+        atomic<table *> published;
+        size_t          n_retired_tables;
+
+        // removed while frozen, and perhaps still in a reader's hands.
+        std::vector<message::factory *> retired_factories;
+
+        inline void __publish(size_t n_dense_min)
+        {
+            table *m_old = published.load(memory_order_relaxed);
+            if (m_old) ++n_retired_tables;
+
+            published.store(new table(factories, m_old, n_dense_min), memory_order_release);
+        }
+
+        inline void __drop(message::factory *factory)
+        {
+            if (published.load(memory_order_relaxed))
+                retired_factories.push_back(factory);
+            else
+                delete factory;
+        }
     public:
-        inline impl(): m(), factories() {}
+        inline impl(): m(), factories(), published(nullptr), n_retired_tables(0), retired_factories() {}
 
         inline ~impl()
         {
-            factories.clear();
+            unfreeze();
+            clear_factories();
         }
 
         inline bool add_factory(message::factory &&factory)
         {
             lock guard(m);
 
-            return factories.insert(map_type::entry(factory.get_type(), factory.move())) != factories.end();
+            message_type type = factory.get_type();
+            if (factories.find(type) != factories.end())
+                return false;
+
+            table *m_table = published.load(memory_order_relaxed);
+            atomic<message::factory *> *slot = m_table ? m_table->find_slot(type) : nullptr;
+
+            if (m_table && !slot && n_retired_tables >= max_retired_tables)
+                return false;
+
+            message::factory *m_factory = factory.move();
+            factories.insert(map_type::entry(type, m_factory));
+
+            if (slot)
+                slot->store(m_factory, memory_order_release);
+            else if (m_table)
+                __publish(type >= 0 && type < max_dense_type ? (size_t)type + 1 : 0);
+
+            return true;
         }
 
         inline bool remove_factory(message_type type)
         {
             lock guard(m);
 
-            return factories.erase(type);
+            auto it = factories.find(type);
+            if (it == factories.end())
+                return false;
+
+            // every type in the map has a slot in the published table.
+            table *m_table = published.load(memory_order_relaxed);
+            if (m_table)
+                m_table->find_slot(type)->store(nullptr, memory_order_release);
+
+            __drop(it->value);
+            factories.erase(type);
+
+            return true;
         }
 
         inline void clear_factories()
         {
+            lock guard(m);
+
+            table *m_table = published.load(memory_order_relaxed);
+            for (auto it = factories.begin(); it != factories.end(); ++it)
+            {
+                if (m_table)
+                    m_table->find_slot(it->key)->store(nullptr, memory_order_release);
+
+                __drop(it->value);
+            }
+
             factories.clear();
         }
 
+        inline void freeze()
+        {
+            lock guard(m);
+
+            if (!published.load(memory_order_relaxed))
+                __publish(0);
+        }
+
+        inline void unfreeze()
+        {
+            lock guard(m);
+
+            table *m_table = published.exchange(nullptr);
+            if (m_table) delete m_table;
+
+            for (auto m_factory: retired_factories)
+                delete m_factory;
+
+            retired_factories.clear();
+            n_retired_tables = 0;
+        }
+
+        inline bool is_frozen() const
+        {
+            return published.load() != nullptr;
+        }
+
         inline const message::factory *get_factory(message_type type) const
         {
+            table *m_table = published.load(memory_order_acquire);
+            if (m_table)
+                return m_table->find(type);
+
             lock guard(m);
 
             auto it = factories.find(type);
@@ -83,6 +295,21 @@ namespace fungus_net
         if (pimpl_) pimpl_->clear_factories();
     }
 
+    void message_factory_manager::freeze()
+    {
+        if (pimpl_) pimpl_->freeze();
+    }
+
+    void message_factory_manager::unfreeze()
+    {
+        if (pimpl_) pimpl_->unfreeze();
+    }
+
+    bool message_factory_manager::is_frozen() const
+    {
+        return pimpl_ ? pimpl_->is_frozen() : false;
+    }
+
     const message::factory *message_factory_manager::get_factory(message_type type) const
     {
         return pimpl_ ? pimpl_->get_factory(type) : nullptr;
@@ -61,39 +61,33 @@ namespace fungus_net
         return m_little_map.find(m_intercept.m_type) != m_little_map.end();
     }
 
-    bool message_intercept::map::intercept(message *m_message, peer_id sender_id, peer *m_peer)
+    bool message_intercept::map::intercepts(message_type m_type, const peer *m_peer) const
     {
-        peer_id  m_id        = m_peer->get_id();
-        any_type m_user_data = m_peer->get_user_data();
-
-        auto it = m_big_map.find(m_id);
+        auto it = m_big_map.find(m_peer->get_id());
         if (it == m_big_map.end())
             return false;
 
-        auto &m_little_map = it->value;
-
-        bool b_intercepted = m_little_map.find(m_message->get_type()) != m_little_map.end();
+        const auto &m_little_map = it->value;
+        return m_little_map.find(m_type) != m_little_map.end();
+    }
 
-        if (b_intercepted && !m_message->marked_as_read())
-        {
-            m_message->mark_as_read();
-            m_intercepted_messages.push
+    void message_intercept::map::intercept(message *m_message, peer_id sender_id, peer *m_peer)
+    {
+        m_message->mark_as_read();
+        m_intercepted_messages.push
+        (
+            intercepted_message
             (
-                intercepted_message
+                message_intercept
                 (
-                    message_intercept
-                    (
-                        m_message->get_type(),
-                        m_id
-                    ),
-                    m_message,
-                    sender_id,
-                    std::move(m_user_data)
-                )
-            );
-        }
-
-        return b_intercepted;
+                    m_message->get_type(),
+                    m_peer->get_id()
+                ),
+                m_message,
+                sender_id,
+                m_peer->get_user_data()
+            )
+        );
     }
 
     bool message_intercept::map::next_intercepted_message(intercepted_message &m_intercepted)
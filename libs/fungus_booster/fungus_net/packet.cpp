@@ -1,4 +1,10 @@
 #include "fungus_net_packet.h"
+#include "fungus_net_compression_internal.h"
+
+#include "../fungus_util/fungus_util_buffer_pool.h"
+
+#include <algorithm>
+#include <vector>
 
 // included for test purposes
 #include <set>
@@ -46,26 +52,18 @@ namespace fungus_net
     packet::packet():
         smode(stream_mode::sequenced),  channel(0),
         dest(destination::outgoing),    initialized(false),
-        ds(nullptr), s(nullptr), buf()
+        ds(nullptr), s(nullptr), buf(),
+        source(nullptr)
         {}
 
     packet::~packet()
     {
-        if (initialized)
-        {
-            switch (dest)
-            {
-            case destination::incoming:
-                delete ds;
-                break;
-            case destination::outgoing:
-                delete s;
-                break;
-            default:
-                fungus_util_assert(false, "Attempted to destroy packet with unknown destination type!");
-                break;
-            };
-        }
+        if (source)
+            drop_source(source);
+
+        // either may be left over from a packet that failed to initialize.
+        __drop_deserializer();
+        __drop_serializer();
     }
 
     bool packet::initialize_outgoing(const message *m_message, const endian_converter &endian)
@@ -78,9 +76,9 @@ namespace fungus_net
 
         fungus_util_assert(smode != stream_mode::invalid, "packet::initialize_outgoing(): invalid stream mode!\n");
 
-        s = new serializer(endian);
+        s = new(&stream_storage) serializer(endian);
 
-        *s << any_type(guard_word) << any_type(m_message->get_type());
+        *s << guard_word << m_message->get_type();
 
         m_message->serialize_data(*s);
         buf.set(s->buf, s->size);
@@ -99,8 +97,44 @@ namespace fungus_net
         this->channel = channel;
 
         this->buf.set(buf.buf, buf.size);
-        ds = new deserializer(endian, this->buf.buf, this->buf.size);
+        ds = new(&stream_storage) deserializer(endian, this->buf.buf, this->buf.size);
+
+        return __check_guard_word();
+    }
+
+    bool packet::initialize_incoming(ENetPacket *source, size_t offset, size_t size,
+                                     stream_mode smode, uint8_t channel,
+                                     const endian_converter &endian)
+    {
+        if (initialized) return false;
+        if (offset + size > source->dataLength) return false;
+
+        dest          = destination::incoming;
+        this->smode   = smode;
+        this->channel = channel;
+
+        grab_source(source);
+        this->source = source;
+
+        ds = new(&stream_storage) deserializer(endian, (const char *)source->data + offset, size);
 
+        return __check_guard_word();
+    }
+
+    void packet::__drop_serializer()
+    {
+        if (s) s->~serializer();
+        s = nullptr;
+    }
+
+    void packet::__drop_deserializer()
+    {
+        if (ds) ds->~deserializer();
+        ds = nullptr;
+    }
+
+    bool packet::__check_guard_word()
+    {
         uint16_t guard_word_test = 0;
         *ds >> guard_word_test;
 
@@ -108,7 +142,8 @@ namespace fungus_net
             initialized = true;
         else
         {
-            delete ds;
+            __drop_deserializer();
+
             initialized = false;
         }
 
@@ -125,16 +160,14 @@ namespace fungus_net
         switch (dest)
         {
         case destination::incoming:
-            delete ds;
-            ds = nullptr;
+            __drop_deserializer();
             dest = destination::outgoing;
             break;
         case destination::outgoing:
-            delete s;
-            s = nullptr;
+            __drop_serializer();
             dest = destination::incoming;
 
-            ds = new deserializer(endian, buf.buf, buf.size);
+            ds = new(&stream_storage) deserializer(endian, buf.buf, buf.size);
             *ds >> guard_word_test;
 
             if (guard_word_test != guard_word)
@@ -185,9 +218,26 @@ namespace fungus_net
         return m_message;
     }
 
-    void packet::set_guard_word(int word)
+    bool packet::set_guard_word(int word)
     {
+        if (word < 0 || word >= UINT16_MAX)
+            return false;
+
         guard_word = word;
+        return true;
+    }
+
+    // received ENetPackets are owned by us once enet hands them
+    // over, so their reference count is free to track borrowers.
+    void packet::grab_source(ENetPacket *source)
+    {
+        ++source->referenceCount;
+    }
+
+    void packet::drop_source(ENetPacket *source)
+    {
+        if (--source->referenceCount == 0)
+            enet_packet_destroy(source);
     }
 
     inline constexpr uint32_t __enet_flags<packet::stream_mode::sequenced>::get_flags()
@@ -200,10 +250,110 @@ namespace fungus_net
         return ENET_PACKET_FLAG_UNSEQUENCED;
     }
 
-    packet::aggregator::aggregator(const endian_converter &endian):
-        m_allocator(), endian(endian), packets()
+    // Outgoing aggregate buffers are handed to enet as they are
+    // (ENET_PACKET_FLAG_NO_ALLOCATE), so they may outlive the aggregator
+    // while enet still holds them.  Every buffer is prefixed with a header
+    // naming its pool, and the pool is deleted once its owner and all of
+    // its buffers have let go of it.  The buffers themselves are recycled
+    // by size class through a fungus_util::buffer_pool.
+    class packet::aggregator::buffer_pool: public serializer_allocator
+    {
+    private:
+        struct header
+        {
+            buffer_pool *pool;
+            size_t       cap;
+            char        *base; // must come last, see find_base().
+        };
+
+        fungus_util::buffer_pool bufs;
+
+        size_t nrefs;
+        bool   orphaned;
+
+        static inline header *__get_header(char *base)
+        {
+            return (header *)(base - sizeof(header));
+        }
+
+        ~buffer_pool() {}
+    public:
+        buffer_pool(): bufs(sizeof(header)), nrefs(1), orphaned(false) {}
+
+        virtual char *allocate(size_t cap)
+        {
+            char *base = bufs.allocate_at_least(cap);
+
+            header *h = __get_header(base);
+            h->pool = this;
+            h->cap  = cap;
+            h->base = base;
+
+            ++nrefs;
+            return base;
+        }
+
+        virtual void deallocate(char *base, size_t cap)
+        {
+            if (orphaned)
+                delete[] (char *)__get_header(base);
+            else
+                bufs.deallocate(base, __get_header(base)->cap);
+
+            if (--nrefs == 0)
+                delete this;
+        }
+
+        void release()
+        {
+            orphaned = true;
+            bufs.trim();
+
+            if (--nrefs == 0)
+                delete this;
+        }
+
+        // the word right before the data handed to enet always holds
+        // the base of the buffer.  For an aggregate that is the end of
+        // the header, and for a lone message it is the (unsent) size
+        // word, which send() overwrites.
+        static inline char *find_base(const void *data)
+        {
+            char *base;
+            memcpy(&base, (const char *)data - sizeof(char *), sizeof(char *));
+            return base;
+        }
+
+        static inline void set_base(char *base, char *at)
+        {
+            memcpy(at, &base, sizeof(char *));
+        }
+
+        static void free_enet_packet(ENetPacket *pk)
+        {
+            char *base = find_base(pk->data);
+            header *h  = __get_header(base);
+
+            h->pool->deallocate(base, h->cap);
+        }
+    };
+
+    packet::aggregator::aggregator(const endian_converter &endian,
+                                   compression_codec codec,
+                                   const compression_dictionary *dictionary):
+        m_allocator(), endian(endian), m_pool(new buffer_pool()),
+        m_compressor(new compressor(codec, dictionary)),
+        m_aggs(endian, m_pool, m_compressor)
     {}
 
+    packet::aggregator::~aggregator()
+    {
+        clear();
+        m_pool->release();
+
+        delete m_compressor;
+    }
+
     packet *packet::aggregator::create_packet()
     {
         return m_allocator.create();
@@ -214,41 +364,116 @@ namespace fungus_net
         return m_allocator.destroy(pk);
     }
 
+    bool packet::aggregator::queue_message(const message *m_message, ENetPeer *peer)
+    {
+        stream_mode smode = from_m_message_stream_mode(m_message->get_stream_mode());
+        if (smode == stream_mode::invalid) return false;
+
+        auto &agg = m_aggs.get_aggregate(peer, m_message->get_channel());
+        agg.get_aggregate_serializer(smode).write_message(m_message);
+
+        return true;
+    }
+
     void packet::aggregator::queue_packet(packet *pk, ENetPeer *peer)
     {
-        packets.push(packet_ref(pk, peer));
+        auto &agg = m_aggs.get_aggregate(peer, pk->get_channel());
+        agg.get_aggregate_serializer(pk->get_stream_mode()).write_buf(pk->buf);
+
+        m_allocator.destroy(pk);
     }
 
-    void packet::aggregator::send_all()
+    bool packet::aggregator::make_shared(const message *m_message, shared_message &m_shared)
     {
-        aggregate_map agg_map(endian);
+        if (m_shared.is_initialized()) return false;
+
+        stream_mode smode = from_m_message_stream_mode(m_message->get_stream_mode());
+        if (smode == stream_mode::invalid) return false;
 
-        const bool b_singleton = (packets.size() == 1);
+        // laid out like a lone message in an aggregate, so the word in
+        // front of the data holds the buffer base for free_enet_packet().
+        serializer s(endian, 1024, m_pool);
+        s << (size_t)0 << guard_word << m_message->get_type();
+        m_message->serialize_data(s);
 
-        while (!packets.empty())
+        buffer_pool::set_base(s.buf, s.buf);
+
+        const char *data   = s.buf + sizeof(size_t);
+        size_t      length = s.size - sizeof(size_t);
+
+        size_t cap;
+        char  *buf = s.detach(cap);
+
+        uint32_t flags = smode == stream_mode::sequenced                           ?
+                         __enet_flags<stream_mode::sequenced>::get_flags()   :
+                         __enet_flags<stream_mode::unsequenced>::get_flags();
+
+        ENetPacket *pk = enet_packet_create(data, length, flags | ENET_PACKET_FLAG_NO_ALLOCATE);
+        if (!pk)
         {
-            packet     *pk      = packets.front().first;
-            ENetPeer   *peer    = packets.front().second;
+            m_pool->deallocate(buf, cap);
+            return false;
+        }
 
-            uint8_t     channel = pk->get_channel();
-            stream_mode smode   = pk->get_stream_mode();
+        pk->freeCallback = &buffer_pool::free_enet_packet;
+        packet::grab_source(pk);
 
-            packets.pop();
+        m_shared.pk      = pk;
+        m_shared.smode   = smode;
+        m_shared.channel = m_message->get_channel();
 
-            auto &agg = agg_map.get_aggregate(std::pair<ENetPeer *, uint8_t>(peer, channel));
-            if (b_singleton)
-                agg.get_serializer(smode) << any_type(pk->buf);
-            else
-                agg.get_serializer(smode) << any_type(pk->buf.size) << any_type(pk->buf);
+        return true;
+    }
 
-            m_allocator.destroy(pk);
-        };
+    void packet::aggregator::queue_shared(const shared_message &m_shared, ENetPeer *peer)
+    {
+        queue_shared(m_shared.pk, m_shared.smode, m_shared.channel, peer);
+    }
+
+    void packet::aggregator::queue_shared(ENetPacket *pk, stream_mode smode, uint8_t channel, ENetPeer *peer)
+    {
+        auto &agg = m_aggs.get_aggregate(peer, channel);
+        agg.get_aggregate_serializer(smode).write_shared(pk);
+    }
+
+    bool packet::aggregator::packets_queued() const
+    {
+        return m_aggs.any_queued();
+    }
+
+    void packet::aggregator::send_all()
+    {
+        m_aggs.send_all();
+    }
+
+    void packet::aggregator::clear()
+    {
+        m_aggs.discard_all();
+        m_aggs.clear();
+    }
+
+    void packet::aggregator::forget_peer(ENetPeer *peer)
+    {
+        m_aggs.forget_peer(peer);
+    }
 
-        agg_map.send_all();
+    compression_stats packet::aggregator::get_compression_stats() const
+    {
+        return m_compressor->get_stats();
+    }
+
+    size_t packet::aggregator::reclaim(bool b_trim)
+    {
+        return b_trim ? m_allocator.trim() : m_allocator.reclaim();
     }
 
-    packet::separator::separator(const endian_converter &endian):
-        m_allocator(), endian(endian), packets()
+    packet::separator::separator(const endian_converter &endian,
+                                 compression_codec codec,
+                                 const compression_dictionary *dictionary,
+                                 size_t max_raw_size):
+        m_allocator(), endian(endian),
+        m_compressor(new compressor(codec, dictionary, max_raw_size)),
+        packets()
     {}
 
     packet::separator::~separator()
@@ -256,12 +481,15 @@ namespace fungus_net
         packet *pk;
         while ((pk = get_packet()) != nullptr)
             m_allocator.destroy(pk);
+
+        delete m_compressor;
     }
 
-    bool packet::separator::create_packet(serializer_buf &buf, stream_mode smode, uint8_t channel)
+    bool packet::separator::create_packet(ENetPacket *source, size_t offset, size_t size,
+                                          stream_mode smode, uint8_t channel)
     {
         packet *pk   = m_allocator.create();
-        bool success = pk->initialize_incoming(buf, smode, channel, endian);
+        bool success = pk->initialize_incoming(source, offset, size, smode, channel, endian);
 
         if (success)
             packets.push(pk);
@@ -276,7 +504,46 @@ namespace fungus_net
         return m_allocator.destroy(pk);
     }
 
+    bool packet::separator::__decompress(ENetPacket *source, ENetPacket *&raw)
+    {
+        const char *data = (const char *)source->data;
+        size_t      size = source->dataLength;
+        size_t      raw_size;
+
+        raw = nullptr;
+        if (!m_compressor->read_header(data, size, endian, raw_size)) return false;
+
+        uint32_t flags = source->flags & (ENET_PACKET_FLAG_RELIABLE | ENET_PACKET_FLAG_UNSEQUENCED);
+
+        raw = enet_packet_create(nullptr, raw_size, flags);
+        if (!raw) return false;
+
+        if (!m_compressor->decompress(data, size, (char *)raw->data, raw_size, endian))
+        {
+            enet_packet_destroy(raw);
+            raw = nullptr;
+        }
+
+        return raw != nullptr;
+    }
+
     bool packet::separator::separate_packets(ENetPacket *source, uint8_t channel)
+    {
+        if (!m_compressor->is_enabled() ||
+            !compressor::is_compressed((const char *)source->data, source->dataLength, endian))
+            return __separate(source, channel);
+
+        ENetPacket *raw;
+        bool success = __decompress(source, raw);
+
+        // the compressed bytes are no longer needed either way.
+        packet::grab_source(source);
+        packet::drop_source(source);
+
+        return success && __separate(raw, channel);
+    }
+
+    bool packet::separator::__separate(ENetPacket *source, uint8_t channel)
     {
         deserializer ds(endian, (char *)source->data, source->dataLength);
         stream_mode smode = source->flags & ENET_PACKET_FLAG_RELIABLE ?
@@ -292,11 +559,12 @@ namespace fungus_net
 
         ds.reset();
 
+        // hold the source while carving so it cannot go away early.
+        packet::grab_source(source);
+
         if (b_singleton)
         {
-            serializer_buf buf((char *)source->data, source->dataLength);
-
-            if (!create_packet(buf, smode, channel))
+            if (!create_packet(source, 0, source->dataLength, smode, channel))
                 success = false;
         }
         else
@@ -306,19 +574,33 @@ namespace fungus_net
                 size_t size = 0;
 
                 ds >> size;
-                if (size != 0)
+                if (ds.eof)
                 {
-                    serializer_buf buf(size);
-                    ds >> buf;
-
-                    if (!create_packet(buf, smode, channel))
+                    success = false;
+                    b_get   = false;
+                }
+                else if (size != 0)
+                {
+                    if (size > ds.size - ds.i)
+                    {
                         success = false;
+                        b_get   = false;
+                    }
+                    else
+                    {
+                        if (!create_packet(source, ds.i, size, smode, channel))
+                            success = false;
+
+                        ds.i += size;
+                    }
                 }
                 else
                     b_get = false;
             }
         }
 
+        packet::drop_source(source);
+
         return success;
     }
 
@@ -340,8 +622,49 @@ namespace fungus_net
         return pk;
     }
 
-    packet::aggregator::aggregate_map::aggregate_map(const endian_converter &endian):
-        endian(endian), aggs()
+    size_t packet::separator::reclaim(bool b_trim)
+    {
+        return b_trim ? m_allocator.trim() : m_allocator.reclaim();
+    }
+
+    packet::aggregator::aggregate_map::peer_aggregates::peer_aggregates(ENetPeer *peer):
+        peer(peer), queued()
+    {
+        memset(channels, 0, sizeof(channels));
+    }
+
+    packet::aggregator::aggregate_map::peer_aggregates::~peer_aggregates()
+    {
+        for (aggregate *agg: channels)
+            delete agg;
+    }
+
+    void packet::aggregator::aggregate_map::peer_aggregates::send_all()
+    {
+        for (aggregate *agg: queued)
+        {
+            agg->send();
+            agg->queued = false;
+        }
+
+        queued.clear();
+    }
+
+    void packet::aggregator::aggregate_map::peer_aggregates::discard_all()
+    {
+        for (aggregate *agg: queued)
+        {
+            agg->discard();
+            agg->queued = false;
+        }
+
+        queued.clear();
+    }
+
+    packet::aggregator::aggregate_map::aggregate_map(const endian_converter &endian, buffer_pool *m_pool,
+                                                     compressor *m_compressor):
+        endian(endian), m_pool(m_pool), m_compressor(m_compressor),
+        peers(), queued_peers()
     {
     }
 
@@ -351,171 +674,377 @@ namespace fungus_net
     }
 
     packet::aggregator::aggregate &packet::aggregator::aggregate_map::
-        get_aggregate(std::pair<ENetPeer *, uint8_t> &&pair)
+        get_aggregate(ENetPeer *peer, uint8_t channel)
     {
-        auto it = aggs.find((ENetPeer *&)pair.first);
-        if (it == aggs.end())
-            it = aggs.insert(map_peer_type::entry(pair.first, std::move(map_agg_type())));
+        auto it = peers.find(peer);
+        if (it == peers.end())
+            it = peers.insert(map_peer_type::entry(peer, new peer_aggregates(peer)));
+
+        peer_aggregates *m_peer_aggs = it->value;
+
+        aggregate *&agg = m_peer_aggs->channels[channel];
+        if (!agg)
+            agg = new aggregate(peer, channel, endian, m_pool, m_compressor);
+
+        if (!agg->queued)
+        {
+            if (m_peer_aggs->queued.empty())
+                queued_peers.push_back(m_peer_aggs);
 
-        auto jt = it->value.find(pair.second);
-        if (jt == it->value.end())
-            jt = it->value.insert(map_agg_type::entry(pair.second, std::move(aggregate(pair, endian))));
+            m_peer_aggs->queued.push_back(agg);
+            agg->queued = true;
+        }
 
-        return jt->value;
+        return *agg;
+    }
+
+    bool packet::aggregator::aggregate_map::any_queued() const
+    {
+        return !queued_peers.empty();
     }
 
     void packet::aggregator::aggregate_map::send_all()
     {
-        for (auto &it: aggs)
+        for (peer_aggregates *m_peer_aggs: queued_peers)
+            m_peer_aggs->send_all();
+
+        queued_peers.clear();
+    }
+
+    void packet::aggregator::aggregate_map::discard_all()
+    {
+        for (peer_aggregates *m_peer_aggs: queued_peers)
+            m_peer_aggs->discard_all();
+
+        queued_peers.clear();
+    }
+
+    void packet::aggregator::aggregate_map::forget_peer(ENetPeer *peer)
+    {
+        auto it = peers.find(peer);
+        if (it == peers.end()) return;
+
+        peer_aggregates *m_peer_aggs = it->value;
+        if (!m_peer_aggs->queued.empty())
         {
-            for (auto &jt: it.value)
-                jt.value.send();
+            m_peer_aggs->discard_all();
+            queued_peers.erase(std::find(queued_peers.begin(), queued_peers.end(), m_peer_aggs));
         }
+
+        peers.erase(peer);
+        delete m_peer_aggs;
     }
 
     void packet::aggregator::aggregate_map::clear()
     {
-        aggs.clear();
+        discard_all();
+
+        for (auto &it: peers)
+            delete it.value;
+
+        peers.clear();
     }
 
-    packet::aggregator::aggregate_serializer_base::
-        aggregate_serializer_base(const endian_converter &endian):
-        used(false), s(endian)
+    packet::shared_message::shared_message():
+        pk(nullptr), smode(stream_mode::invalid), channel(0)
     {}
 
-    serializer &packet::aggregator::aggregate_serializer_base::get()
+    packet::shared_message::~shared_message()
     {
-        used = true;
-        return s;
+        if (pk)
+            packet::drop_source(pk);
     }
 
-    template <packet::stream_mode __smode>
-    packet::aggregator::aggregate_serializer<__smode>::
-        aggregate_serializer(const endian_converter &endian):
-        aggregate_serializer_base(endian)
+    bool packet::shared_message::is_initialized() const
+    {
+        return pk != nullptr;
+    }
+
+    packet::stream_mode packet::shared_message::get_stream_mode() const
+    {
+        return smode;
+    }
+
+    uint8_t packet::shared_message::get_channel() const
+    {
+        return channel;
+    }
+
+    bool packet::shared_message::make(const endian_converter &endian, const message *m_message)
+    {
+        if (pk) return false;
+
+        stream_mode smode = from_m_message_stream_mode(m_message->get_stream_mode());
+        if (smode == stream_mode::invalid) return false;
+
+        serializer s(endian, 1024);
+        s << guard_word << m_message->get_type();
+        m_message->serialize_data(s);
+
+        uint32_t flags = smode == stream_mode::sequenced                           ?
+                         __enet_flags<stream_mode::sequenced>::get_flags()   :
+                         __enet_flags<stream_mode::unsequenced>::get_flags();
+
+        pk = enet_packet_create(s.buf, s.size, flags);
+        if (!pk) return false;
+
+        packet::grab_source(pk);
+
+        this->smode   = smode;
+        this->channel = m_message->get_channel();
+
+        return true;
+    }
+
+    ENetPacket *packet::shared_message::copy_packet() const
+    {
+        return pk ? enet_packet_create(pk->data, pk->dataLength, pk->flags & ~ENET_PACKET_FLAG_NO_ALLOCATE) : nullptr;
+    }
+
+    packet::aggregator::aggregate_serializer_base::
+        aggregate_serializer_base(const endian_converter &endian, buffer_pool *m_pool,
+                                  compressor *m_compressor):
+        used(false), count(0), s(endian, 1024, m_pool), m_pool(m_pool),
+        m_compressor(m_compressor), lone_shared(nullptr)
     {}
 
-    template <packet::stream_mode __smode>
-    void packet::aggregator::aggregate_serializer<__smode>::
-        send(ENetPeer *peer, uint8_t channel)
+    packet::aggregator::aggregate_serializer_base::~aggregate_serializer_base()
     {
-        if (used)
-        {
-            s << any_type((size_t)0);
+        if (lone_shared)
+            packet::drop_source(lone_shared);
+    }
 
-            ENetPacket *pk = enet_packet_create(s.buf, s.size,
-                                                __enet_flags<__smode>::
-                                                get_flags());
-            enet_peer_send(peer, channel, pk);
+    void packet::aggregator::aggregate_serializer_base::__append_shared(ENetPacket *pk)
+    {
+        serializer &s = get();
+        s << (size_t)pk->dataLength;
 
-            s.reset();
-            used = false;
+        while (s.cap - s.size < pk->dataLength) s._grow();
+        memcpy(s.buf + s.size, pk->data, pk->dataLength);
+        s.size += pk->dataLength;
+    }
+
+    void packet::aggregator::aggregate_serializer_base::__unshare()
+    {
+        if (lone_shared)
+        {
+            __append_shared(lone_shared);
+
+            packet::drop_source(lone_shared);
+            lone_shared = nullptr;
         }
     }
 
-    packet::aggregator::aggregate::aggregate(std::pair<ENetPeer *, uint8_t> &pair,
-                                             const endian_converter &endian):
-        endian(endian), peer(pair.first), channel(pair.second)
+    serializer &packet::aggregator::aggregate_serializer_base::get()
     {
-          seq = new aggregate_serializer<stream_mode::sequenced>(endian);
-        unseq = new aggregate_serializer<stream_mode::unsequenced>(endian);
+        used = true;
+        return s;
     }
 
-    packet::aggregator::aggregate::aggregate(const aggregate &agg):
-        endian(agg.endian),
-        seq(nullptr), unseq(nullptr),
-        peer(agg.peer), channel(agg.channel)
+    void packet::aggregator::aggregate_serializer_base::write_message(const message *m_message)
     {
-          seq = new aggregate_serializer<stream_mode::sequenced>(endian);
-        unseq = new aggregate_serializer<stream_mode::unsequenced>(endian);
+        __unshare();
+        serializer &s = get();
+
+        size_t at = s.size;
+        s << (size_t)0;
+
+        size_t begin = s.size;
+        s << guard_word << m_message->get_type();
+        m_message->serialize_data(s);
+
+        size_t size = s.endian.convert(s.size - begin);
+        memcpy(s.buf + at, &size, sizeof(size_t));
+
+        ++count;
     }
 
-    packet::aggregator::aggregate::aggregate(aggregate &&agg):
-        endian(agg.endian),
-        seq(agg.seq), unseq(agg.unseq),
-        peer(agg.peer), channel(agg.channel)
+    void packet::aggregator::aggregate_serializer_base::discard()
     {
-        agg.seq   = nullptr;
-        agg.unseq = nullptr;
+        if (lone_shared)
+        {
+            packet::drop_source(lone_shared);
+            lone_shared = nullptr;
+        }
+
+        s.reset();
+        used  = false;
+        count = 0;
     }
 
-    packet::aggregator::aggregate::~aggregate()
+    void packet::aggregator::aggregate_serializer_base::write_buf(const serializer_buf &buf)
     {
-        send();
+        __unshare();
+        get() << buf.size << buf;
+        ++count;
+    }
 
-        if (seq && unseq)
+    void packet::aggregator::aggregate_serializer_base::write_shared(ENetPacket *pk)
+    {
+        if (!used)
         {
-            delete   seq;
-            delete unseq;
+            packet::grab_source(pk);
+            lone_shared = pk;
+
+            used  = true;
+            count = 1;
+        }
+        else
+        {
+            __unshare();
+            __append_shared(pk);
+
+            ++count;
         }
     }
 
-    packet::aggregator::aggregate &packet::aggregator::aggregate::
-        operator =(const aggregate &agg)
+    fungus_util_constexpr_assert(sizeof(size_t) >= sizeof(char *), size_word_holds_pointer);
+
+    void packet::aggregator::aggregate_serializer_base::
+        __hand_to_enet(ENetPeer *peer, uint8_t channel, uint32_t flags)
     {
-        if (seq && unseq)
+        if (lone_shared)
         {
-            delete seq;
-            delete unseq;
+            // enet takes its own reference for every peer it is sent to.
+            enet_peer_send(peer, channel, lone_shared);
+
+            packet::drop_source(lone_shared);
+            lone_shared = nullptr;
+
+            return;
         }
 
-        peer    = agg.peer;
-        channel = agg.channel;
+        const char *data;
+        size_t      length;
 
-          seq = agg.seq;
-        unseq = agg.unseq;
+        if (count == 1)
+        {
+            // a lone message is sent without the aggregate framing.
+            data   = s.buf + sizeof(size_t);
+            length = s.size - sizeof(size_t);
 
-        return *this;
-    }
+            buffer_pool::set_base(s.buf, s.buf);
+        }
+        else
+        {
+            s << (size_t)0;
 
-    packet::aggregator::aggregate &packet::aggregator::aggregate::
-        operator =(aggregate &&agg)
-    {
-        if (seq && unseq)
+            data   = s.buf;
+            length = s.size;
+        }
+
+        size_t cap;
+        char  *buf = s.detach(cap);
+
+        if (m_compressor->is_enabled() && length >= compressor::min_size)
+        {
+            // compressed in to a buffer of its own, with its base in
+            // the word before the data like any other.
+            size_t z_cap = next_pow2(sizeof(char *) + compressor::get_bound(length));
+            char  *z_buf = m_pool->allocate(z_cap);
+
+            size_t z_length = m_compressor->compress(data, length, z_buf + sizeof(char *),
+                                                     z_cap - sizeof(char *), s.endian);
+
+            m_compressor->count(length, z_length ? z_length : length);
+
+            if (z_length)
+            {
+                m_pool->deallocate(buf, cap);
+                buffer_pool::set_base(z_buf, z_buf);
+
+                buf    = z_buf;
+                cap    = z_cap;
+                data   = z_buf + sizeof(char *);
+                length = z_length;
+            }
+            else
+                m_pool->deallocate(z_buf, z_cap);
+        }
+
+        ENetPacket *pk = enet_packet_create(data, length, flags | ENET_PACKET_FLAG_NO_ALLOCATE);
+        if (pk)
         {
-            delete seq;
-            delete unseq;
+            pk->freeCallback = &buffer_pool::free_enet_packet;
+
+            if (enet_peer_send(peer, channel, pk) < 0)
+                enet_packet_destroy(pk);
         }
+        else
+            m_pool->deallocate(buf, cap);
+    }
 
-        peer    = agg.peer;
-        channel = agg.channel;
+    template <packet::stream_mode __smode>
+    packet::aggregator::aggregate_serializer<__smode>::
+        aggregate_serializer(const endian_converter &endian, buffer_pool *m_pool,
+                             compressor *m_compressor):
+        aggregate_serializer_base(endian, m_pool, m_compressor)
+    {}
 
-          seq = agg.seq;
-        unseq = agg.unseq;
+    template <packet::stream_mode __smode>
+    void packet::aggregator::aggregate_serializer<__smode>::
+        send(ENetPeer *peer, uint8_t channel)
+    {
+        if (used)
+        {
+            __hand_to_enet(peer, channel, __enet_flags<__smode>::get_flags());
 
-        agg.seq   = nullptr;
-        agg.unseq = nullptr;
+            s.reset();
+            used  = false;
+            count = 0;
+        }
+    }
 
-        return *this;
+    packet::aggregator::aggregate::aggregate(ENetPeer *peer, uint8_t channel,
+                                             const endian_converter &endian,
+                                             buffer_pool *m_pool,
+                                             compressor *m_compressor):
+          seq(endian, m_pool, m_compressor),
+        unseq(endian, m_pool, m_compressor),
+        peer(peer), channel(channel), queued(false)
+    {}
+
+    packet::aggregator::aggregate::~aggregate()
+    {
+        discard();
     }
 
-    serializer &packet::aggregator::aggregate::get_serializer(stream_mode smode)
+    packet::aggregator::aggregate_serializer_base &packet::aggregator::aggregate::
+        get_aggregate_serializer(stream_mode smode)
     {
         switch (smode)
         {
         case stream_mode::sequenced:
-            return seq->get();
+            return seq;
             break;
         case stream_mode::unsequenced:
-            return unseq->get();
+            return unseq;
             break;
         default:
             fungus_util_assert(false,
-                "packet::aggregator::aggregate::get_serializer(): unknown stream mode!\n");
-				
-			// keep the compiler happy.
-			return unseq->get();
+                "packet::aggregator::aggregate::get_aggregate_serializer(): unknown stream mode!\n");
+
+            // keep the compiler happy.
+            return unseq;
             break;
         };
     }
 
+    serializer &packet::aggregator::aggregate::get_serializer(stream_mode smode)
+    {
+        return get_aggregate_serializer(smode).get();
+    }
+
+    void packet::aggregator::aggregate::discard()
+    {
+          seq.discard();
+        unseq.discard();
+    }
+
     void packet::aggregator::aggregate::send()
     {
-        if (seq && unseq)
-        {
-              seq->send(peer, channel);
-            unseq->send(peer, channel);
-        }
+          seq.send(peer, channel);
+        unseq.send(peer, channel);
     }
 
 // TEST SHIT, HIDE ME ON DISTRO!
@@ -559,7 +1088,7 @@ namespace fungus_net
     protected:
         virtual void serialize_data(serializer &s) const
         {
-            s << any_type(str) << any_type(host_i);
+            s << str << host_i;
         }
 
         virtual void deserialize_data(deserializer &s)
@@ -688,8 +1217,6 @@ namespace fungus_net
                         fungus_util_assert(hosts[i]->sep.separate_packets(event.packet, event.channelID),
                             "failed to separate packets!\n");
 
-                        enet_packet_destroy(event.packet);
-
                         std::cout << "  receiving messages: ";
                         while (hosts[i]->sep.packets_waiting())
                         {
@@ -11,6 +11,46 @@ namespace fungus_net
         m_message(m_message), sender_id(sender_id)
     {}
 
+    peer::shared_incoming_message::shared_incoming_message(): pimpl_(nullptr) {}
+    peer::shared_incoming_message::shared_incoming_message(const shared_incoming_message &m_shared):
+        pimpl_(m_shared.pimpl_)
+    {
+        if (pimpl_) pimpl_->grab();
+    }
+
+    peer::shared_incoming_message::~shared_incoming_message()
+    {
+        reset();
+    }
+
+    peer::shared_incoming_message &peer::shared_incoming_message::operator =(const shared_incoming_message &m_shared)
+    {
+        // m_shared may be *this, which reset() would empty.
+        impl *m_impl = m_shared.pimpl_;
+        if (m_impl) m_impl->grab();
+        reset();
+
+        pimpl_ = m_impl;
+        return *this;
+    }
+
+    const message *peer::shared_incoming_message::get_message() const {return pimpl_ ? pimpl_->get_message()   : nullptr;}
+    peer_id peer::shared_incoming_message::get_sender_id() const      {return pimpl_ ? pimpl_->get_sender_id() : null_peer_id;}
+
+    void peer::shared_incoming_message::mark_as_read()
+    {
+        if (pimpl_) pimpl_->mark_as_read();
+    }
+
+    void peer::shared_incoming_message::reset()
+    {
+        if (pimpl_)
+        {
+            pimpl_->drop();
+            pimpl_ = nullptr;
+        }
+    }
+
     peer::peer()  = default;
     peer::~peer() = default;
 
@@ -31,40 +71,52 @@ namespace fungus_net
 
     void peer_base::discard_message()
     {
-        incoming_message m_in;
-        if (receive_message(m_in))
-            delete m_in.m_message;
+        shared_incoming_message m_shared;
+        receive_shared_message(m_shared);
     }
 
     void peer_base::discard_all_messages()
     {
-        incoming_message m_in;
-        while (receive_message(m_in))
-            delete m_in.m_message;
+        while (!m_message_queue_in.empty())
+        {
+            m_message_queue_in.front()->drop();
+            m_message_queue_in.pop();
+        }
     }
 
     void peer_base::push_incoming_message(const incoming_message &m_in)
     {
-        if (!m_intercept_map.intercept(m_in.m_message, m_in.sender_id, this))
-        {
-            m_message_queue_in.push(m_in);
+        // hold a reference of our own while the message is delivered.
+        shared_incoming *m_shared = new shared_incoming(m_in);
 
-            auto it_factory =
-                multi_tree_iterator_factory
-                <
-                    peer_base,
-                    multi_tree_iterator_target::groups
-                >(this);
+        deliver(m_shared);
+        m_shared->drop();
+    }
 
-            for (auto &entry: it_factory)
-            {
-                entry.key->push_incoming_message
-                (
-                    incoming_message(m_in.m_message->clone(),
-                                     m_in.sender_id)
-                );
-            }
+    void peer_base::deliver(shared_incoming *m_shared)
+    {
+        // read (or intercepted) further down; every queue would skip it.
+        if (m_shared->is_read())
+            return;
+
+        if (m_intercept_map.intercepts(m_shared->get_message()->get_type(), this))
+        {
+            m_intercept_map.intercept(m_shared->take(), m_shared->get_sender_id(), this);
+            return;
         }
+
+        m_shared->grab();
+        m_message_queue_in.push(m_shared);
+
+        auto it_factory =
+            multi_tree_iterator_factory
+            <
+                peer_base,
+                multi_tree_iterator_target::groups
+            >(this);
+
+        for (auto &entry: it_factory)
+            entry.key->deliver(m_shared);
     }
 
     void peer_base::set_user_data(any_type &&data)
@@ -215,25 +267,44 @@ namespace fungus_net
         m_in.m_message = nullptr;
         m_in.sender_id = null_peer_id;
 
-        while (!m_message_queue_in.empty())
+        while (!m_message_queue_in.empty() && !success)
         {
-            m_in = m_message_queue_in.front();
+            shared_incoming *m_shared = m_message_queue_in.front();
             m_message_queue_in.pop();
 
-            if (m_in.m_message->marked_as_read())
+            if (!m_shared->is_read())
             {
-                delete m_in.m_message;
+                m_in.sender_id = m_shared->get_sender_id();
+                m_in.m_message = m_shared->take();
 
-                m_in.m_message = nullptr;
-                m_in.sender_id = null_peer_id;
-            }
-            else
-            {
                 success = true;
-                break;
             }
+
+            m_shared->drop();
         }
 
         return success;
     }
+
+    bool peer_base::receive_shared_message(shared_incoming_message &m_shared)
+    {
+        m_shared.reset();
+
+        while (!m_message_queue_in.empty())
+        {
+            shared_incoming *m_next = m_message_queue_in.front();
+            m_message_queue_in.pop();
+
+            // the queue's reference becomes m_shared's.
+            if (!m_next->is_read())
+            {
+                m_shared.pimpl_ = m_next;
+                return true;
+            }
+
+            m_next->drop();
+        }
+
+        return false;
+    }
 }
@@ -16,11 +16,11 @@ namespace fungus_net
                   ),
         m_mode(m_mode),
         m_unified_peer(m_unified_peer),
-        m_timeout_start(timestamp::current_time),
         m_payloads_in(), m_payloads_out(),
         m_payload_factory(m_payload_factory),
         m_message_to_payload_converter(endian),
-        m_payload_to_message_converter()
+        m_payload_to_message_converter(),
+        m_auth_timeout()
     {}
 
     peer_concrete::~peer_concrete()
@@ -50,7 +50,6 @@ namespace fungus_net
             if (m_message)
             {
                 m_payloads_in.push(m_message_to_payload_converter(m_message));
-                m_timeout_start = timestamp::current_time;
                 b_is_payload = true;
             }
         }
@@ -68,6 +67,13 @@ namespace fungus_net
                false;
     }
 
+    bool peer_concrete::send_broadcast(unified_host::broadcast &m_broadcast)
+    {
+        return m_state == state::connected                   ?
+               m_unified_peer->send_broadcast(m_broadcast)   :
+               false;
+    }
+
     bool peer_concrete::disconnect(uint32_t data, const peer *m_exclusion)
     {
         bool success = false;
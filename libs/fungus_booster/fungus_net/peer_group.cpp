@@ -2,15 +2,19 @@
 
 namespace fungus_net
 {
+    // serializes the message at most once for all of the members,
+    // instead of copying it for each of them.
     class __send_enum: public peer::enumerator
     {
     public:
         bool success;
         const message *m_message;
+        unified_host::broadcast m_broadcast;
 
         inline __send_enum(const message *m_message):
             success(true),
-            m_message(m_message)
+            m_message(m_message),
+            m_broadcast(m_message)
         {}
 
         inline ~__send_enum()
@@ -20,7 +24,12 @@ namespace fungus_net
 
         virtual void operator()(peer *m_peer)
         {
-            if (!m_peer->send_message(m_message->copy(), nullptr))
+            // an empty group is a leaf too, with nobody to send to.
+            if (m_peer->get_state() == peer::state::group)
+                return;
+
+            peer_concrete *m_peer_concrete = static_cast<peer_concrete *>(m_peer);
+            if (!m_peer_concrete->send_broadcast(m_broadcast))
                 success = false;
         }
     };
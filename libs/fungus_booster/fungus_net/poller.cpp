@@ -0,0 +1,153 @@
+#include "fungus_net_poller_internal.h"
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <climits>
+#endif
+
+namespace fungus_net
+{
+#ifdef __linux__
+    poller::poller():
+        m_activity(), m_watched(), m_sockets(), b_armed(false),
+        epoll_fd(-1), event_fd(-1)
+    {
+        epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+        fungus_util_assert(epoll_fd >= 0 && event_fd >= 0,
+            "fungus_net::poller::poller(): could not create the epoll set!");
+
+        epoll_event m_event;
+        m_event.events   = EPOLLIN;
+        m_event.data.u64 = 0;
+
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, event_fd, &m_event);
+    }
+
+    poller::~poller()
+    {
+        unwatch_all();
+
+        close(event_fd);
+        close(epoll_fd);
+    }
+
+    bool poller::watch(ENetSocket socket)
+    {
+        epoll_event m_event;
+        m_event.events   = EPOLLIN;
+        m_event.data.u64 = 0;
+
+        bool success = epoll_ctl(epoll_fd, EPOLL_CTL_ADD, socket, &m_event) == 0;
+        if (success)
+            m_sockets.push_back(socket);
+
+        return success;
+    }
+
+    void poller::unwatch_all()
+    {
+        disarm();
+
+        for (ENetSocket socket: m_sockets)
+            epoll_ctl(epoll_fd, EPOLL_CTL_DEL, socket, nullptr);
+
+        m_sockets.clear();
+        m_watched.clear();
+    }
+
+    void poller::arm()
+    {
+        if (b_armed) return;
+
+        m_activity.attach_eventfd(event_fd);
+        for (notifier *m_notifier: m_watched)
+            m_notifier->attach_eventfd(event_fd);
+
+        b_armed = true;
+    }
+
+    void poller::disarm()
+    {
+        if (!b_armed) return;
+
+        m_activity.detach_eventfd();
+        for (notifier *m_notifier: m_watched)
+            m_notifier->detach_eventfd();
+
+        b_armed = false;
+    }
+
+    void poller::wait(nsec_duration_t timeout)
+    {
+        int msec = -1;
+        if (timeout >= 0)
+            msec = timeout / 1000000 >= INT_MAX ? INT_MAX : (int)((timeout + 999999) / 1000000);
+
+        epoll_event m_events[4];
+        epoll_wait(epoll_fd, m_events, 4, msec);
+
+        // leave the eventfd unreadable for the next wait.
+        uint64_t count;
+        ssize_t  n = read(event_fd, &count, sizeof(count));
+        (void)n;
+    }
+#else
+    poller::poller():
+        m_activity(), m_watched(), m_sockets(), b_armed(false),
+        epoch(0)
+    {}
+
+    poller::~poller()
+    {
+        unwatch_all();
+    }
+
+    bool poller::watch(ENetSocket socket)
+    {
+        m_sockets.push_back(socket);
+        return true;
+    }
+
+    void poller::unwatch_all()
+    {
+        disarm();
+
+        m_sockets.clear();
+        m_watched.clear();
+    }
+
+    void poller::arm()
+    {
+        epoch   = m_activity.get_epoch();
+        b_armed = true;
+    }
+
+    void poller::disarm()
+    {
+        b_armed = false;
+    }
+
+    void poller::wait(nsec_duration_t timeout)
+    {
+        if (!m_watched.empty() || !m_sockets.empty())
+        {
+            if (timeout < 0 || timeout > slice_period)
+                timeout = slice_period;
+        }
+
+        m_activity.wait(epoch, timeout);
+    }
+#endif
+
+    void poller::watch(notifier &m_notifier)
+    {
+        // a notifier watched while armed would never be detached.
+        fungus_util_assert(!b_armed, "fungus_net::poller::watch(): cannot watch while armed!");
+        m_watched.push_back(&m_notifier);
+    }
+}
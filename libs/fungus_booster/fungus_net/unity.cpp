@@ -29,13 +29,16 @@ namespace fungus_net
 
     unified_host::host_storage::host_storage(common_data &m_common_data,
                                              uint32_t flags, const ipv4 &m_ipv4,
-                                             uint32_t in_bandwidth, uint32_t out_bandwidth):
+                                             uint32_t in_bandwidth, uint32_t out_bandwidth,
+                                             const dispatch_budget &m_budget,
+                                             size_t shard_count):
         m_common_data(m_common_data),
         m_networked_host(), m_memory_host()
     {
         if (flags & unified_host_flag_networked)
             m_networked_host.create(m_common_data, m_ipv4,
-                                    in_bandwidth, out_bandwidth);
+                                    in_bandwidth, out_bandwidth, m_budget,
+                                    (flags & unified_host_flag_io_thread) != 0, shard_count);
 
         if (flags & unified_host_flag_memory)
             m_memory_host.create(m_common_data);
@@ -43,14 +46,16 @@ namespace fungus_net
 
     unified_host::unified_host(common_data &m_common_data):
         unified_host_base(m_common_data), flags(unified_host_flag_memory),
-        m_host_storage(m_common_data, unified_host_flag_memory, ipv4(), 0, 0)
+        m_host_storage(m_common_data, unified_host_flag_memory, ipv4(), 0, 0, dispatch_budget(), 1)
     {}
 
     unified_host::unified_host(common_data &m_common_data,
         uint32_t flags, const ipv4 &m_ipv4,
-        uint32_t in_bandwidth, uint32_t out_bandwidth):
+        uint32_t in_bandwidth, uint32_t out_bandwidth,
+        const dispatch_budget &m_budget,
+        size_t shard_count):
         unified_host_base(m_common_data), flags(flags),
-        m_host_storage(m_common_data, flags, m_ipv4, in_bandwidth, out_bandwidth)
+        m_host_storage(m_common_data, flags, m_ipv4, in_bandwidth, out_bandwidth, m_budget, shard_count)
     {}
 
     unified_host::~unified_host() {}
@@ -95,6 +100,8 @@ namespace fungus_net
 
     void unified_host::dispatch()
     {
+        monotonic_clock::update();
+
         call_dispatch m_call;
         m_host_storage.enumerate(m_call, flags);
     }
@@ -113,6 +120,47 @@ namespace fungus_net
         return m_call.b_got_event;
     }
 
+    bool unified_host::next_ready_peer(peer *&m_peer)
+    {
+        call_next_ready_peer m_call(m_peer);
+        m_host_storage.enumerate(m_call, flags);
+        return m_call.b_got_peer;
+    }
+
+    unified_host::dispatch_stats unified_host::get_dispatch_stats() const
+    {
+        call_get_dispatch_stats m_call;
+        m_host_storage.enumerate(m_call, flags);
+        return m_call.result;
+    }
+
+    compression_stats unified_host::get_compression_stats() const
+    {
+        call_get_compression_stats m_call;
+        m_host_storage.enumerate(m_call, flags);
+        return m_call.result;
+    }
+
+    size_t unified_host::reclaim(bool b_trim)
+    {
+        call_reclaim m_call(b_trim);
+        m_host_storage.enumerate(m_call, flags);
+        return m_call.result;
+    }
+
+    void unified_host::watch(poller &m_poller)
+    {
+        call_watch m_call(m_poller);
+        m_host_storage.enumerate(m_call, flags);
+    }
+
+    bool unified_host::is_dispatch_pending(nsec_duration_t &timeout)
+    {
+        call_is_dispatch_pending m_call(timeout);
+        m_host_storage.enumerate(m_call, flags);
+        return m_call.b_pending;
+    }
+
 // TEST SHIT
 
     class test_m_message2: public protocol_message
@@ -154,7 +202,7 @@ namespace fungus_net
     protected:
         virtual void serialize_data(serializer &s) const
         {
-            s << any_type(str) << any_type(host_i);
+            s << str << host_i;
         }
 
         virtual void deserialize_data(deserializer &s)
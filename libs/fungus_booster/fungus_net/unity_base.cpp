@@ -14,8 +14,11 @@ namespace fungus_net
     }
 
     unified_host_base::default_policy::default_policy(size_t max_peers, const sec_duration_t *p_timeout_table):
-        max_peers(max_peers), n_peers(0), p_timeout_table(p_timeout_table)
-    {}
+        max_peers(max_peers), n_peers(0)
+    {
+        for (size_t i = 0; i < timeout_period_type::count; ++i)
+            timeout_table[i] = sec_duration_to_nsec(p_timeout_table[i]);
+    }
 
     bool unified_host_base::default_policy::grab_peer()
     {
@@ -45,7 +48,7 @@ namespace fungus_net
         case connection_timeout:
         case disconnect_timeout:
         case auth_timeout:
-            return p_timeout_table[period_type] < duration;
+            return timeout_table[period_type] < sec_duration_to_nsec(duration);
             break;
         default:
             return false;
@@ -53,14 +56,38 @@ namespace fungus_net
         };
     }
 
+    nsec_duration_t unified_host_base::default_policy::get_timeout_period(timeout_period_type period_type) const
+    {
+        switch (period_type)
+        {
+        case connection_timeout:
+        case disconnect_timeout:
+        case auth_timeout:
+            return timeout_table[period_type];
+            break;
+        default:
+            return 0;
+            break;
+        };
+    }
+
     unified_host_base::peer::peer(unified_host_base *parent):
-        parent(parent), m_state(state::none)
+        parent(parent), m_state(state::none),
+        b_ready(false), ready_prev(nullptr), ready_next(nullptr)
     {}
 
+    bool unified_host_base::peer::send_broadcast(broadcast &m_broadcast)
+    {
+        return send(m_broadcast.get_message()->copy());
+    }
+
     unified_host_base::peer::~peer()
     {
         fungus_util_assert(can_connect(m_state),
             "fungus_net::unified_host_base::peer::~peer(): attempted to destroy peer before disconnecting or resetting!");
+
+        if (b_ready)
+            parent->__unlink_ready(this);
     }
 
     unified_host_base *unified_host_base::peer::get_parent()            const {return parent;}
@@ -72,7 +99,9 @@ namespace fungus_net
     bool unified_host_base::peer::reset() {return false;}
 
     unified_host_base::unified_host_base(common_data &m_common_data):
-        m_common_data(m_common_data)
+        m_common_data(m_common_data),
+        m_ready_first(nullptr),
+        m_ready_last(nullptr)
     {}
 
     unified_host_base::~unified_host_base() {}
@@ -86,4 +115,15 @@ namespace fungus_net
     {
         return m_common_data;
     }
+
+    bool unified_host_base::next_ready_peer(peer *&m_peer)
+    {
+        if (!m_ready_first)
+            return false;
+
+        m_peer = m_ready_first;
+        __unlink_ready(m_peer);
+
+        return true;
+    }
 };
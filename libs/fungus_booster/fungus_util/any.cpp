@@ -1,79 +1,121 @@
 #include "fungus_util_any.h"
+#include "fungus_util_buffer_pool.h"
 
 namespace fungus_util
 {
-    serializer_buf::serializer_buf(const serializer_buf &b): buf(nullptr), size(b.size)
+    static inline char *__buf_alloc(size_t size, size_t &cap)
+    {
+        cap = size;
+        return buffer_pool::local_allocate(cap);
+    }
+
+    static inline void __buf_free(char *buf, size_t cap)
+    {
+        if (!buf) return;
+
+        if (cap)
+            buffer_pool::local_deallocate(buf, cap);
+        else
+            delete[] buf;
+    }
+
+    serializer_buf::serializer_buf(const serializer_buf &b): buf(nullptr), size(b.size), cap(0)
     {
         if (b.size && b.buf)
         {
-            buf = new char[size];
+            buf = __buf_alloc(size, cap);
             memcpy(buf, b.buf, size);
         }
     }
 
-    serializer_buf::serializer_buf(const char *buf, const size_t size): buf(nullptr), size(size)
+    serializer_buf::serializer_buf(const char *buf, const size_t size): buf(nullptr), size(size), cap(0)
     {
         if (size && buf)
         {
-            this->buf = new char[size];
+            this->buf = __buf_alloc(size, cap);
             memcpy(this->buf, buf, size);
         }
     }
 
-    serializer_buf::serializer_buf(const size_t size): buf(nullptr), size(size)
+    serializer_buf::serializer_buf(const size_t size): buf(nullptr), size(size), cap(0)
     {
         if (size)
-            this->buf = new char[size];
+            this->buf = __buf_alloc(size, cap);
     }
 
     serializer_buf::~serializer_buf()
     {
-        if (buf) delete[] buf;
+        __buf_free(buf, cap);
     }
 
     void serializer_buf::set(const char *buf, const size_t size)
     {
-        if (this->buf) delete[] this->buf;
+        // buf may point in to the buffer being replaced.
+        char  *obuf = this->buf;
+        size_t ocap = cap;
+
         this->buf  = nullptr;
         this->size = size;
+        this->cap  = 0;
 
         if (size && buf)
         {
-            this->buf = new char[size];
+            this->buf = __buf_alloc(size, cap);
             memcpy(this->buf, buf, size);
         }
+
+        __buf_free(obuf, ocap);
     }
 
     void serializer_buf::set(const size_t size)
     {
-        if (buf) delete[] buf;
+        __buf_free(buf, cap);
 
         buf = nullptr;
+        cap = 0;
         this->size = size;
 
-        if (size) buf = new char[size];
+        if (size) buf = __buf_alloc(size, cap);
     }
 
     serializer_buf &serializer_buf::operator =(const serializer_buf &b)
     {
-        set(b.buf, b.size);
+        if (this != &b)
+            set(b.buf, b.size);
+
         return *this;
     }
 
-    serializer::serializer(const endian_converter &endian, size_t init_cap):
+    static inline char *__serializer_alloc(serializer_allocator *allocator, size_t cap)
+    {
+        return allocator ? allocator->allocate(cap) : buffer_pool::local_allocate(cap);
+    }
+
+    static inline void __serializer_free(serializer_allocator *allocator, char *buf, size_t cap)
+    {
+        if (allocator)
+            allocator->deallocate(buf, cap);
+        else
+            buffer_pool::local_deallocate(buf, cap);
+    }
+
+    serializer::serializer(const endian_converter &endian, size_t init_cap,
+                           serializer_allocator *allocator):
         endian(endian),
         cap(init_cap), size(0), buf(nullptr),
-        error(false), fail(false)
+        error(false), fail(false),
+        allocator(allocator), init_cap(init_cap)
     {
         if (!is_pow2(cap))
             cap = next_pow2(cap);
 
-        buf = new char[cap];
+        this->init_cap = cap;
+        buf = __serializer_alloc(allocator, cap);
     }
 
     serializer::~serializer()
     {
-        delete[] buf;
+        if (buf) __serializer_free(allocator, buf, cap);
     }
 
     void serializer::reset()
@@ -88,18 +130,40 @@ namespace fungus_util
         _buf.set(buf, size);
     }
 
+    char *serializer::detach(size_t &_cap)
+    {
+        char *dbuf = buf;
+        _cap = cap;
+
+        buf  = nullptr;
+        cap  = 0;
+        size = 0;
+
+        return dbuf;
+    }
+
     void serializer::_grow()
     {
-        char *nbuf = new char[cap <<= 1];
+        if (!buf)
+        {
+            cap = init_cap;
+            buf = __serializer_alloc(allocator, cap);
+
+            return;
+        }
+
+        size_t ncap = cap << 1;
+        char  *nbuf = __serializer_alloc(allocator, ncap);
 
         memcpy(nbuf, buf, size);
 
-        delete[] buf;
+        __serializer_free(allocator, buf, cap);
         buf = nbuf;
+        cap = ncap;
     }
 
     deserializer::deserializer(const endian_converter &endian, const char *buf, const size_t size):
-        endian(endian), buf(buf), size(size), i(0) {}
+        endian(endian), buf(buf), size(size), i(0), eof(false) {}
 
     void deserializer::reset() {i = 0;}
 
@@ -117,23 +181,23 @@ namespace fungus_util
 
     static const char str_marker = (const char)234;
 
-    size_t any_type::string_container::serialize(const endian_converter &endian, char *buf, size_t buf_len) const
+    static inline size_t __serialize_str(const char *str, size_t len, char *buf, size_t buf_len)
     {
-        size_t size = content.size() + 2;
+        size_t size = len + 2;
 
         if (size > buf_len)
             return -1;
         else
         {
             buf[0] = str_marker;
-            memcpy(buf + 1, content.c_str(), content.size());
+            memcpy(buf + 1, str, len);
             buf[size - 1] = '\0';
         }
 
         return size;
     }
 
-    size_t any_type::string_container::deserialize(const endian_converter &endian, const char *buf, size_t buf_len)
+    static inline size_t __deserialize_str(std::string &content, const char *buf, size_t buf_len)
     {
         content.clear();
 
@@ -143,12 +207,32 @@ namespace fungus_util
         const char *str_ptr = buf + 1;
         size_t i, b_rem = buf_len - 1;
 
-        for (i = 0; i < b_rem && str_ptr[i]; ++i)
-            content.push_back(str_ptr[i]);
+        for (i = 0; i < b_rem && str_ptr[i]; ++i);
+        content.assign(str_ptr, i);
 
         return i >= b_rem ? i + 1 : content.size() + 2;
     }
 
+    static inline size_t __deserialize_buf(serializer_buf &content, const char *buf, size_t buf_len)
+    {
+        if (content.size > buf_len)
+            return 0;
+        else
+            memcpy(content.buf, buf, content.size);
+
+        return content.size;
+    }
+
+    size_t any_type::string_container::serialize(const endian_converter &endian, char *buf, size_t buf_len) const
+    {
+        return __serialize_str(content.c_str(), content.size(), buf, buf_len);
+    }
+
+    size_t any_type::string_container::deserialize(const endian_converter &endian, const char *buf, size_t buf_len)
+    {
+        return __deserialize_str(content, buf, buf_len);
+    }
+
     any_type::buf_container::buf_container(const serializer_buf &_content): content(_content) {}
     const std::type_info &any_type::buf_container::get_type() const {return typeid(serializer_buf);}
     any_type::container_base *any_type::buf_container::clone() const {return new buf_container(content);}
@@ -173,12 +257,7 @@ namespace fungus_util
 
     size_t any_type::buf_container::deserialize(const endian_converter &endian, const char *buf, size_t buf_len)
     {
-        if (content.size > buf_len)
-            return 0;
-        else
-            memcpy(content.buf, buf, content.size);
-
-        return content.size;
+        return __deserialize_buf(content, buf, buf_len);
     }
 
     any_type::any_type():                          container(nullptr) {}
@@ -248,6 +327,57 @@ namespace fungus_util
         return s;
     }
 
+    static inline void __put_str(serializer &s, const char *str, size_t len)
+    {
+        while (s.cap - s.size < len + 2) s._grow();
+        s.size += __serialize_str(str, len, s.buf + s.size, s.cap - s.size);
+    }
+
+    serializer &operator <<(serializer &s, const char *str)
+    {
+        __put_str(s, str, strlen(str));
+        return s;
+    }
+
+    serializer &operator <<(serializer &s, const std::string &str)
+    {
+        __put_str(s, str.c_str(), str.size());
+        return s;
+    }
+
+    serializer &operator <<(serializer &s, const serializer_buf &_buf)
+    {
+        while (s.cap - s.size < _buf.size) s._grow();
+
+        if (_buf.size)
+            memcpy(s.buf + s.size, _buf.buf, _buf.size);
+
+        s.size += _buf.size;
+        return s;
+    }
+
+    deserializer &operator >>(deserializer &ds, std::string &str)
+    {
+        size_t n = __deserialize_str(str, ds.buf + ds.i, ds.size - ds.i);
+        if (n == 0)
+            ds.eof = true;
+        else
+            ds.i += n;
+
+        return ds;
+    }
+
+    deserializer &operator >>(deserializer &ds, serializer_buf &_buf)
+    {
+        size_t n = __deserialize_buf(_buf, ds.buf + ds.i, ds.size - ds.i);
+        if (n == 0)
+            ds.eof = true;
+        else
+            ds.i += n;
+
+        return ds;
+    }
+
     namespace detail
     {
         deserializer &op_get(deserializer &ds, any_type &_any)
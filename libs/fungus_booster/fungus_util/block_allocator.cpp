@@ -0,0 +1,102 @@
+#include "fungus_util_block_allocator.h"
+
+#ifdef FUNGUSUTIL_POSIX
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif
+
+namespace fungus_util
+{
+    static const size_t __huge_page_size = 2 * 1024 * 1024;
+
+    static inline size_t __round_up(size_t n, size_t to)
+    {
+        return (n + to - 1) / to * to;
+    }
+
+#ifdef FUNGUSUTIL_POSIX
+    static inline size_t __page_size()
+    {
+        static const size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+        return page_size;
+    }
+
+    // a set smaller than a page would waste most of its mapping, so
+    // unless huge pages were asked for it comes from the heap, and can't
+    // be decommitted.  every mapped set is at least a page, so the size
+    // alone tells them apart.
+    static inline bool __block_slab_on_heap(size_t bytes)
+    {
+        return bytes < __page_size();
+    }
+
+    void *__block_slab_alloc(size_t &bytes, uint32_t flags)
+    {
+        if (__block_slab_on_heap(bytes) &&
+            !(flags & (block_allocator_flag_huge_pages | block_allocator_flag_thp)))
+            return ::operator new(bytes, std::nothrow);
+
+        void *p = MAP_FAILED;
+
+#ifdef MAP_HUGETLB
+        // a set much smaller than a huge page would mostly be waste.
+        if ((flags & block_allocator_flag_huge_pages) && bytes >= __huge_page_size / 2)
+        {
+            size_t huge_bytes = __round_up(bytes, __huge_page_size);
+
+            // fails if no huge pages have been reserved.
+            p = mmap(nullptr, huge_bytes, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (p != MAP_FAILED)
+                bytes = huge_bytes;
+        }
+#endif
+
+        if (p == MAP_FAILED)
+        {
+            bytes = __round_up(bytes, __page_size());
+
+            p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (p == MAP_FAILED)
+                return nullptr;
+
+            // only the aligned huge pages inside the set can be used.
+#ifdef MADV_HUGEPAGE
+            if ((flags & block_allocator_flag_thp) && bytes >= __huge_page_size)
+                madvise(p, bytes, MADV_HUGEPAGE);
+#endif
+        }
+
+        return p;
+    }
+
+    void __block_slab_free(void *p, size_t bytes)
+    {
+        if (__block_slab_on_heap(bytes))
+            ::operator delete(p);
+        else
+            munmap(p, bytes);
+    }
+
+    bool __block_slab_decommit(void *p, size_t bytes)
+    {
+        return !__block_slab_on_heap(bytes) && madvise(p, bytes, MADV_DONTNEED) == 0;
+    }
+#else
+    void *__block_slab_alloc(size_t &bytes, uint32_t flags)
+    {
+        return ::operator new(bytes, std::nothrow);
+    }
+
+    void __block_slab_free(void *p, size_t bytes)
+    {
+        ::operator delete(p);
+    }
+
+    bool __block_slab_decommit(void *p, size_t bytes)
+    {
+        return false;
+    }
+#endif
+}
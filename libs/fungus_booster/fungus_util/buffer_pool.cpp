@@ -0,0 +1,126 @@
+#include "fungus_util_buffer_pool.h"
+
+namespace fungus_util
+{
+    constexpr size_t buffer_pool::default_max_cached_bytes;
+    constexpr size_t buffer_pool::default_max_cached_cap;
+
+    buffer_pool::buffer_pool(size_t header_bytes, size_t max_cached_bytes, size_t max_cached_cap):
+        header_bytes(header_bytes), max_cached_bytes(max_cached_bytes), max_cached_cap(max_cached_cap)
+    {}
+
+    buffer_pool::~buffer_pool()
+    {
+        trim();
+    }
+
+    char *buffer_pool::allocate_at_least(size_t &cap)
+    {
+        size_t c = class_of(cap);
+        cap = (size_t)1 << c;
+
+        std::vector<char *> &bufs = free_bufs[c];
+        if (!bufs.empty())
+        {
+            char *buf = bufs.back();
+            bufs.pop_back();
+
+            ++stats[c].hits;
+            --stats[c].cached;
+
+            return buf;
+        }
+
+        ++stats[c].misses;
+        return __new_buf(cap);
+    }
+
+    char *buffer_pool::allocate(size_t cap)
+    {
+        return allocate_at_least(cap);
+    }
+
+    void buffer_pool::deallocate(char *buf, size_t cap)
+    {
+        if (!buf) return;
+
+        size_t c = class_of(cap);
+        cap = (size_t)1 << c;
+
+        // always keep a few, however big the class.
+        std::vector<char *> &bufs = free_bufs[c];
+        if (cap <= max_cached_cap && (bufs.size() < 4 || (bufs.size() + 1) * cap <= max_cached_bytes))
+        {
+            bufs.push_back(buf);
+            ++stats[c].cached;
+        }
+        else
+            __delete_buf(buf);
+    }
+
+    void buffer_pool::trim()
+    {
+        for (size_t c = 0; c < n_classes; ++c)
+        {
+            for (auto buf: free_bufs[c])
+                __delete_buf(buf);
+
+            free_bufs[c].clear();
+            stats[c].cached = 0;
+        }
+    }
+
+    buffer_pool::class_stats buffer_pool::get_class_stats(size_t size_class) const
+    {
+        return size_class < n_classes ? stats[size_class] : class_stats();
+    }
+
+    static __thread buffer_pool *__local_pool      = nullptr;
+    static __thread bool         __local_pool_dead = false;
+
+    // deletes the thread's pool as it exits.
+    struct __local_pool_reaper
+    {
+        ~__local_pool_reaper()
+        {
+            buffer_pool *pool = __local_pool;
+
+            __local_pool      = nullptr;
+            __local_pool_dead = true;
+
+            delete pool;
+        }
+    };
+
+    static thread_local __local_pool_reaper __local_reaper;
+
+    buffer_pool *buffer_pool::local()
+    {
+        if (!__local_pool && !__local_pool_dead)
+        {
+            __local_pool = new buffer_pool();
+            (void)&__local_reaper;
+        }
+
+        return __local_pool;
+    }
+
+    char *buffer_pool::local_allocate(size_t &cap)
+    {
+        buffer_pool *pool = local();
+        if (pool)
+            return pool->allocate_at_least(cap);
+
+        cap = (size_t)1 << class_of(cap);
+        return new char[cap];
+    }
+
+    void buffer_pool::local_deallocate(char *buf, size_t cap)
+    {
+        buffer_pool *pool = local();
+        if (pool)
+            pool->deallocate(buf, cap);
+        else
+            delete[] buf;
+    }
+}
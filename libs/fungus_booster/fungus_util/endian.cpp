@@ -15,44 +15,79 @@ namespace fungus_util
     endian_converter::endian_converter():
         m(),
 #ifdef FUNGUSUTIL_CPP11_PARTIAL
-        type_regs(100),
+        type_regs(new __endian_reg_map_type(100)),
 #else
-        type_regs(),
+        type_regs(new __endian_reg_map_type()),
 #endif
+        type_regs_retired(),
+        __static_numeric(false),
         __lazy_init_numeric(false)
     {}
 
     endian_converter::endian_converter(endian_converter &&endian):
         m(),
-#ifdef FUNGUSUTIL_CPP11_PARTIAL
-        type_regs(std::move(endian.type_regs)),
-#else
-        type_regs(endian.type_regs),
-#endif
+        type_regs(endian.type_regs.exchange(nullptr)),
+        type_regs_retired(std::move(endian.type_regs_retired)),
+        __static_numeric(endian.__static_numeric.load()),
         __lazy_init_numeric(endian.__lazy_init_numeric)
     {}
 
+    endian_converter::~endian_converter()
+    {
+        __endian_reg_map_type *regs = type_regs.load();
+        if (regs) delete regs;
+
+        for (auto it: type_regs_retired)
+            delete it;
+    }
+
+    void endian_converter::__publish(__endian_reg_map_type *regs)
+    {
+        __endian_reg_map_type *old_regs = type_regs.exchange(regs);
+        if (old_regs)
+            type_regs_retired.push_back(old_regs);
+    }
+
     void endian_converter::register_type(const endian_registration &et)
     {
         lock guard(m);
+
+        const __endian_reg_map_type *regs = type_regs.load();
+        __endian_reg_map_type *nregs = regs ? new __endian_reg_map_type(*regs) : new __endian_reg_map_type();
+
 #ifdef FUNGUSUTIL_CPP11_PARTIAL
-        type_regs.insert(__endian_reg_map_type::entry(et.get_type(), et));
+        nregs->insert(__endian_reg_map_type::entry(et.get_type(), et));
 #else
-        type_regs[et.get_type()] = et;
+        (*nregs)[et.get_type()] = et;
 #endif
+
+        __publish(nregs);
     }
 
     void endian_converter::unregister_type(const type_info_wrap &info)
     {
         lock guard(m);
-        type_regs.erase(info);
+
+        // the static types may no longer all be registered, so
+        // fall back to looking every type up in the map.
+        __static_numeric.store(false);
+
+        const __endian_reg_map_type *regs = type_regs.load();
+        if (!regs) return;
+
+        __endian_reg_map_type *nregs = new __endian_reg_map_type(*regs);
+        nregs->erase(info);
+
+        __publish(nregs);
     }
 
     bool endian_converter::type_registered(const type_info_wrap &info, int &target_endian) const
     {
-        lock guard(const_cast<mutex &>(m));
-        auto it = type_regs.find(info);
-        if (it != type_regs.end())
+        const __endian_reg_map_type *regs = type_regs.load();
+        if (!regs) return false;
+
+        auto it = regs->find(info);
+        if (it != regs->end())
         {
 #ifdef FUNGUSUTIL_CPP11_PARTIAL
             target_endian = it->value.get_net_endian();
@@ -70,18 +105,36 @@ namespace fungus_util
         lock guard(m);
         if (!__lazy_init_numeric)
         {
-            register_type<int16_t>();
-            register_type<int32_t>();
-            register_type<int64_t>();
+            const __endian_reg_map_type *regs = type_regs.load();
+            __endian_reg_map_type *nregs = regs ? new __endian_reg_map_type(*regs) : new __endian_reg_map_type();
 
-            register_type<uint16_t>();
-            register_type<uint32_t>();
-            register_type<uint64_t>();
+            const endian_registration numeric_regs[] =
+            {
+                endian_registration::get<int16_t>(),
+                endian_registration::get<int32_t>(),
+                endian_registration::get<int64_t>(),
+
+                endian_registration::get<uint16_t>(),
+                endian_registration::get<uint32_t>(),
+                endian_registration::get<uint64_t>(),
+
+                endian_registration::get<float>(),
+                endian_registration::get<double>()
+            };
+
+            for (auto &et: numeric_regs)
+            {
+#ifdef FUNGUSUTIL_CPP11_PARTIAL
+                nregs->insert(__endian_reg_map_type::entry(et.get_type(), et));
+#else
+                (*nregs)[et.get_type()] = et;
+#endif
+            }
 
-            register_type<float>();
-            register_type<double>();
+            __publish(nregs);
 
             __lazy_init_numeric = true;
+            __static_numeric.store(true);
         }
     }
 }
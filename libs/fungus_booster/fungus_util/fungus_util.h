@@ -5,6 +5,7 @@
 #include "fungus_util_common.h"
 #include "fungus_util_timestamp.h"
 #include "fungus_util_any.h"
+#include "fungus_util_buffer_pool.h"
 #include "fungus_util_clone_map.h"
 #include "fungus_util_endian.h"
 #include "fungus_util_pow2.h"
@@ -13,6 +13,7 @@
 #include <exception>
 #include <typeinfo>
 #include <cstring>
+#include <type_traits>
 #include "fungus_util_pow2.h"
 #include "fungus_util_endian.h"
 #include "fungus_util_common.h"
@@ -35,11 +36,16 @@ namespace fungus_util
         char *buf;
         size_t size;
 
+        // the size class buf was drawn from buffer_pool::local() with,
+        // or 0 if buf was put there by hand and is to be delete[]d.
+        size_t cap;
+
         inline serializer_buf(serializer_buf &&b):
-            buf(b.buf), size(b.size)
+            buf(b.buf), size(b.size), cap(b.cap)
         {
             b.buf  = nullptr;
             b.size = 0;
+            b.cap  = 0;
         }
 
         serializer_buf(const serializer_buf &b);
@@ -75,9 +81,10 @@ namespace fungus_util
             char m_size_bytes[sizeof(size_t)];
             m_is.read(m_size_bytes, sizeof(size_t)); // read the size of the ensuing data block
 
-            memcpy(&size, m_size_bytes, sizeof(size_t));
+            size_t m_size;
+            memcpy(&m_size, m_size_bytes, sizeof(size_t));
 
-            set(size);
+            set(m_size);
             m_is.read(buf, size);             // read the data block
 
             return (bool)m_is;
@@ -88,11 +95,18 @@ namespace fungus_util
 
         inline serializer_buf &operator =(serializer_buf &&b)
         {
-            buf  = b.buf;
-            size = b.size;
+            if (this != &b)
+            {
+                set(nullptr, 0);
 
-            b.buf  = nullptr;
-            b.size = 0;
+                buf  = b.buf;
+                size = b.size;
+                cap  = b.cap;
+
+                b.buf  = nullptr;
+                b.size = 0;
+                b.cap  = 0;
+            }
 
             return *this;
         }
@@ -100,6 +114,17 @@ namespace fungus_util
         serializer_buf &operator =(const serializer_buf &b);
     };
 
+    // Lets a serializer take its buffers from somewhere other than
+    // the thread's buffer_pool.  Capacities are always powers of two.
+    class FUNGUSUTIL_API serializer_allocator
+    {
+    public:
+        virtual ~serializer_allocator() {}
+
+        virtual char *allocate(size_t cap) = 0;
+        virtual void  deallocate(char *buf, size_t cap) = 0;
+    };
+
     struct FUNGUSUTIL_API serializer
     {
         const endian_converter &endian;
@@ -109,12 +134,21 @@ namespace fungus_util
 
         bool error, fail;
 
-        serializer(const endian_converter &endian, size_t init_cap = 64);
+        serializer_allocator *allocator;
+        size_t init_cap;
+
+        serializer(const endian_converter &endian, size_t init_cap = 64,
+                   serializer_allocator *allocator = nullptr);
         ~serializer();
 
         void reset();
         void get_buf(serializer_buf &_buf) const;
 
+        // hands the buffer (and the responsibility for giving it back
+        // to the allocator) to the caller.  A new buffer is allocated
+        // on the next write.
+        char *detach(size_t &_cap);
+
         void _grow();
     };
 
@@ -395,15 +429,6 @@ namespace fungus_util
         FUNGUSUTIL_API deserializer &op_get(deserializer &ds, any_type &_any);
     }
 
-    template <typename T>
-    deserializer &operator >>(deserializer &ds, T &o)
-    {
-        any_type _any(o);
-        detail::op_get(ds, _any);
-        o = any_cast<T>(_any);
-        return ds;
-    }
-
     template<typename T> T *any_cast(any_type *any)
     {
         return any && any->get_type() == typeid(T) ?
@@ -425,6 +450,88 @@ namespace fungus_util
         return *result;
     }
 
+    // Strings and raw buffers are written straight in to the serializer
+    // with the same wire format their any_type containers use, so there
+    // is no need to box them up first.
+    FUNGUSUTIL_API serializer &operator <<(serializer &s, const char *str);
+    FUNGUSUTIL_API serializer &operator <<(serializer &s, const std::string &str);
+    FUNGUSUTIL_API serializer &operator <<(serializer &s, const serializer_buf &_buf);
+
+    FUNGUSUTIL_API deserializer &operator >>(deserializer &ds, std::string &str);
+    FUNGUSUTIL_API deserializer &operator >>(deserializer &ds, serializer_buf &_buf);
+
+    // Arithmetic types and enums take the fast path, which copies the
+    // (endian converted) value directly in to or out of the buffer.
+    // Anything else still goes through an any_type container.
+    template <typename T>
+    struct __serialize_direct
+    {
+        enum {value = std::is_arithmetic<T>::value || std::is_enum<T>::value};
+    };
+
+    template <bool _b_direct, typename T>
+    struct __serialize_impl;
+
+    template <typename T>
+    struct __serialize_impl<true, T>
+    {
+        FUNGUSUTIL_ALWAYS_INLINE
+        static inline void __put(serializer &s, const T &o)
+        {
+            while (s.cap - s.size < sizeof(T)) s._grow();
+
+            T data = s.endian.convert(o);
+            memcpy(s.buf + s.size, &data, sizeof(T));
+            s.size += sizeof(T);
+        }
+
+        FUNGUSUTIL_ALWAYS_INLINE
+        static inline void __get(deserializer &ds, T &o)
+        {
+            if (ds.size - ds.i < sizeof(T))
+            {
+                ds.eof = true;
+                return;
+            }
+
+            memcpy(&o, ds.buf + ds.i, sizeof(T));
+            o = ds.endian.convert(o);
+            ds.i += sizeof(T);
+        }
+    };
+
+    template <typename T>
+    struct __serialize_impl<false, T>
+    {
+        FUNGUSUTIL_ALWAYS_INLINE
+        static inline void __put(serializer &s, const T &o)
+        {
+            s << any_type(o);
+        }
+
+        FUNGUSUTIL_ALWAYS_INLINE
+        static inline void __get(deserializer &ds, T &o)
+        {
+            any_type _any(o);
+            detail::op_get(ds, _any);
+            o = any_cast<T>(_any);
+        }
+    };
+
+    template <typename T>
+    inline serializer &operator <<(serializer &s, const T &o)
+    {
+        __serialize_impl<__serialize_direct<T>::value, T>::__put(s, o);
+        return s;
+    }
+
+    template <typename T>
+    inline deserializer &operator >>(deserializer &ds, T &o)
+    {
+        __serialize_impl<__serialize_direct<T>::value, T>::__get(ds, o);
+        return ds;
+    }
+
     FUNGUSUTIL_API bool cmp_anys(const any_type &a, const any_type &b);
 
     inline bool operator ==(const any_type &a, const any_type &b)
@@ -5,8 +5,32 @@
 #include "fungus_util_constexpr.h"
 #include "fungus_util_hash_map.h"
 
+#include <new>
+
 namespace fungus_util
 {
+    enum block_allocator_flags: uint32_t
+    {
+        block_allocator_flag_none       = 0x0,
+
+        // back block sets of at least half a huge page with MAP_HUGETLB
+        // pages, falling back to ordinary pages if none are reserved.
+        block_allocator_flag_huge_pages = 0x1,
+
+        // ask for transparent huge pages with madvise(MADV_HUGEPAGE)
+        // for block sets of at least a huge page.
+        block_allocator_flag_thp        = 0x2
+    };
+
+    // the memory under block sets.  sets of at least a page, or with a
+    // huge page flag, are mapped, and bytes is rounded up to the page
+    // size used; smaller ones come from the heap.  decommit gives the
+    // pages of a mapped set back to the os without unmapping them; they
+    // read as zeroes when next touched.
+    FUNGUSUTIL_API void *__block_slab_alloc(size_t &bytes, uint32_t flags);
+    FUNGUSUTIL_API void  __block_slab_free(void *p, size_t bytes);
+    FUNGUSUTIL_API bool  __block_slab_decommit(void *p, size_t bytes);
+
 #ifndef FUNGUSUTIL_NO_BLOCK_ALLOCATOR
     template <typename blockT, size_t n_blocks>
     class block_allocator
@@ -25,71 +49,141 @@ namespace fungus_util
         fungus_util_constexpr_assert(n_blocks > 0, n_blocks_check);
         static constexpr size_t block_tize = sizeof(block_t);
 
-        block_set **m_block_sets;
+        // every set is on the list of all sets.  sets with a free block
+        // are also on the free list, those still holding memory first and
+        // decommitted ones (which are always empty) after them, so that
+        // create() takes the head in O(1) and only touches a decommitted
+        // set once every other one is full.
+        block_set *m_all_sets;
+        block_set *m_free_sets;
+        block_set *m_free_sets_last;
+
         size_t n_block_sets;
         size_t n_alloced;
 
-        struct _s_nil {};
-        typedef hash_map<default_hash<block_set *, _s_nil>> set_map;
-        set_map m_set_map;
+        size_t   committed_bytes;
+        uint32_t flags;
 
-        FUNGUSUTIL_ALWAYS_INLINE inline void expand()
+        FUNGUSUTIL_ALWAYS_INLINE inline void free_push_front(block_set *m_set)
         {
-            size_t n_block_sets_new = n_block_sets << 1;
-            block_set **m_block_sets_new = new block_set *[n_block_sets_new];
+            m_set->free_prev = nullptr;
+            m_set->free_next = m_free_sets;
 
-            for (size_t i = 0; i < n_block_sets; ++i)
-                m_block_sets_new[i] = m_block_sets[i];
+            if (m_free_sets)
+                m_free_sets->free_prev = m_set;
+            else
+                m_free_sets_last = m_set;
 
-            if (n_block_sets_new > m_set_map.table_size() / 3 * 2)
-                m_set_map.rehash(n_block_sets_new * 2);
+            m_free_sets = m_set;
+        }
+
+        FUNGUSUTIL_ALWAYS_INLINE inline void free_push_back(block_set *m_set)
+        {
+            m_set->free_prev = m_free_sets_last;
+            m_set->free_next = nullptr;
+
+            if (m_free_sets_last)
+                m_free_sets_last->free_next = m_set;
+            else
+                m_free_sets = m_set;
+
+            m_free_sets_last = m_set;
+        }
+
+        FUNGUSUTIL_ALWAYS_INLINE inline void free_unlink(block_set *m_set)
+        {
+            if (m_set->free_prev) m_set->free_prev->free_next = m_set->free_next;
+            else                  m_free_sets                 = m_set->free_next;
+
+            if (m_set->free_next) m_set->free_next->free_prev = m_set->free_prev;
+            else                  m_free_sets_last            = m_set->free_prev;
+        }
 
-            for (size_t i = n_block_sets; i < n_block_sets_new; ++i)
+        inline bool add_set()
+        {
+            size_t bytes = block_tize * n_blocks;
+
+            void *p = __block_slab_alloc(bytes, flags);
+            if (!p)
+                return false;
+
+            block_set *m_set = new block_set(static_cast<block_t *>(p), bytes);
+
+            m_set->all_next = m_all_sets;
+            m_all_sets = m_set;
+
+            free_push_front(m_set);
+
+            ++n_block_sets;
+            committed_bytes += bytes;
+
+            return true;
+        }
+
+        // doubles the number of sets.
+        FUNGUSUTIL_ALWAYS_INLINE inline void expand()
+        {
+            for (size_t i = 0, n = n_block_sets; i < n; ++i)
             {
-                m_block_sets_new[i] = new block_set();
-                m_set_map.insert(std::move(typename set_map::entry(m_block_sets_new[i], _s_nil())));
+                if (!add_set())
+                    break;
             }
+        }
+
+        FUNGUSUTIL_ALWAYS_INLINE inline bool decommit(block_set *m_set)
+        {
+            if (!__block_slab_decommit(m_set->m_blocks, m_set->bytes))
+                return false;
+
+            m_set->b_decommitted = true;
+            committed_bytes -= m_set->bytes;
 
-            delete[] m_block_sets;
+            free_unlink(m_set);
+            free_push_back(m_set);
 
-            m_block_sets = m_block_sets_new;
-            n_block_sets = n_block_sets_new;
+            return true;
         }
 
         FUNGUSUTIL_NO_ASSIGN(block_allocator);
     public:
         FUNGUSUTIL_ALWAYS_INLINE inline block_allocator(block_allocator &&m_block_allocator):
-            m_block_sets(m_block_allocator.m_block_sets),
+            m_all_sets(m_block_allocator.m_all_sets),
+            m_free_sets(m_block_allocator.m_free_sets),
+            m_free_sets_last(m_block_allocator.m_free_sets_last),
             n_block_sets(m_block_allocator.n_block_sets),
             n_alloced(m_block_allocator.n_alloced),
-            m_set_map(std::move(m_block_allocator.m_set_map))
+            committed_bytes(m_block_allocator.committed_bytes),
+            flags(m_block_allocator.flags)
         {
-            m_block_allocator.m_block_sets = nullptr;
+            m_block_allocator.m_all_sets       = nullptr;
+            m_block_allocator.m_free_sets      = nullptr;
+            m_block_allocator.m_free_sets_last = nullptr;
+            m_block_allocator.n_block_sets     = 0;
         }
 
-        FUNGUSUTIL_ALWAYS_INLINE inline block_allocator(size_t n_block_sets = 1):
-            m_block_sets(nullptr),
-            n_block_sets(n_block_sets == 0 ? 1 : n_block_sets),
+        FUNGUSUTIL_ALWAYS_INLINE inline block_allocator(size_t n_block_sets = 1, uint32_t flags = block_allocator_flag_none):
+            m_all_sets(nullptr),
+            m_free_sets(nullptr),
+            m_free_sets_last(nullptr),
+            n_block_sets(0),
             n_alloced(0),
-            m_set_map(n_block_sets * 2)
+            committed_bytes(0),
+            flags(flags)
         {
-            m_block_sets = new block_set *[n_block_sets];
-
-            for (size_t i = 0; i < n_block_sets; ++i)
-            {
-                m_block_sets[i] = new block_set();
-                m_set_map.insert(std::move(typename set_map::entry(m_block_sets[i], _s_nil())));
-            }
+            for (size_t i = 0; i < (n_block_sets == 0 ? 1 : n_block_sets); ++i)
+                add_set();
         }
 
         FUNGUSUTIL_ALWAYS_INLINE inline ~block_allocator()
         {
-            if (m_block_sets)
+            while (m_all_sets)
             {
-                for (size_t i = 0; i < n_block_sets; ++i)
-                    delete m_block_sets[i];
+                block_set *next = m_all_sets->all_next;
+
+                __block_slab_free(m_all_sets->m_blocks, m_all_sets->bytes);
+                delete m_all_sets;
 
-                delete[] m_block_sets;
+                m_all_sets = next;
             }
         }
 
@@ -97,54 +191,53 @@ namespace fungus_util
         FUNGUSUTIL_ALWAYS_INLINE inline size_t count_blocks()     const {return n_block_sets * n_blocks;}
         FUNGUSUTIL_ALWAYS_INLINE inline size_t count_alloced()    const {return n_alloced;}
 
+        // bytes of block sets not given back to the os by trim() or reclaim().
+        FUNGUSUTIL_ALWAYS_INLINE inline size_t count_committed_bytes() const {return committed_bytes;}
+
         template <typename... argT>
         FUNGUSUTIL_ALWAYS_INLINE inline blockT *create(argT&&... argV)
         {
-            fungus_util_assert(m_block_sets, "fungus_util::block_allocator::create(): this instance has been moved!");
+            fungus_util_assert(m_all_sets, "fungus_util::block_allocator::create(): this instance has been moved!");
 
-            if (++n_alloced > count_blocks())
+            if (!m_free_sets)
                 expand();
 
-            //for (size_t i = 0; i < n_block_sets && p == nullptr; ++i)
-            unsigned char *p = nullptr;
-            block_set *m_set = nullptr;
+            block_set *m_set = m_free_sets;
+            if (!m_set)
+                return nullptr;
 
-            if (n_block_sets > 1)
+            if (m_set->b_decommitted)
             {
-                auto it = m_set_map.begin();
-                if (it != m_set_map.end())
-                    m_set = it->key;
+                m_set->b_decommitted = false;
+                committed_bytes += m_set->bytes;
             }
-            else
-                m_set = m_block_sets[0];
 
-            p = m_set->alloc();
+            m_set->b_idle = false;
+
+            unsigned char *p = m_set->alloc();
             if (m_set->n_alloced >= n_blocks)
-                m_set_map.erase(m_set);
+                free_unlink(m_set);
 
-            if (p)
-            {
-                blockT *b = new(p) blockT(std::forward<argT>(argV)...);
-                return b;
-            }
-            else
-                return nullptr;
+            ++n_alloced;
+
+            return new(p) blockT(std::forward<argT>(argV)...);
         }
 
         FUNGUSUTIL_ALWAYS_INLINE inline bool destroy(blockT *b)
         {
-            fungus_util_assert(m_block_sets, "fungus_util::block_allocator::destroy(): this instance has been moved!");
+            fungus_util_assert(m_all_sets, "fungus_util::block_allocator::destroy(): this instance has been moved!");
 
             unsigned char *p = (unsigned char *)b;
 
-            block_t *p_b = block_set::get_from_p(p);
-            if (p_b->m_set->n_alloced > 0 && p_b->m_set->dealloc(p))
+            block_t   *p_b   = block_set::get_from_p(p);
+            block_set *m_set = p_b->m_set;
+
+            const bool was_full = m_set->n_alloced >= n_blocks;
+
+            if (m_set->n_alloced > 0 && m_set->dealloc(p))
             {
-                if (n_block_sets > 1)
-                {
-                    if (m_set_map.find(p_b->m_set) == m_set_map.end())
-                        m_set_map.insert(std::move(typename set_map::entry(p_b->m_set, _s_nil())));
-                }
+                if (was_full)
+                    free_push_front(m_set);
 
                 b->~blockT();
                 --n_alloced;
@@ -154,6 +247,56 @@ namespace fungus_util
             else
                 return false;
         }
+
+        // gives empty sets back to the os until no more than target_bytes
+        // are committed, or no empty set is left.  the sets are kept, and
+        // are used again once every other set is full.  returns the
+        // number of bytes given back.
+        inline size_t trim(size_t target_bytes = 0)
+        {
+            size_t released = 0;
+
+            block_set *m_set = m_free_sets;
+            while (m_set && !m_set->b_decommitted && count_committed_bytes() > target_bytes)
+            {
+                block_set *next = m_set->free_next;
+
+                if (m_set->n_alloced == 0 && decommit(m_set))
+                    released += m_set->bytes;
+
+                m_set = next;
+            }
+
+            return released;
+        }
+
+        // gives back the sets that have stayed empty since the last call,
+        // and marks the other empty ones to go next time.  meant to be
+        // called periodically, so that memory taken for a spike drains
+        // away without sets being given back just before they are needed
+        // again.  returns the number of bytes given back.
+        inline size_t reclaim()
+        {
+            size_t released = 0;
+
+            block_set *m_set = m_free_sets;
+            while (m_set && !m_set->b_decommitted)
+            {
+                block_set *next = m_set->free_next;
+
+                if (m_set->n_alloced == 0)
+                {
+                    if (!m_set->b_idle)
+                        m_set->b_idle = true;
+                    else if (decommit(m_set))
+                        released += m_set->bytes;
+                }
+
+                m_set = next;
+            }
+
+            return released;
+        }
     };
 
     template <typename blockT, size_t n_blocks>
@@ -161,15 +304,25 @@ namespace fungus_util
     {
         size_t n_alloced;
 
-        block_t   m_blocks[n_blocks];
+        block_t  *m_blocks;
+        size_t    bytes;
         block_t  *m_free_stack[n_blocks];
         block_t **p_free_stack;
 
+        block_set *all_next;
+        block_set *free_prev;
+        block_set *free_next;
+
+        bool b_decommitted;
+        bool b_idle;
+
         block_set(block_set      &&m_set) = delete;
         block_set(const block_set &m_set) = delete;
 
-        FUNGUSUTIL_ALWAYS_INLINE inline block_set():
-            n_alloced(0)
+        FUNGUSUTIL_ALWAYS_INLINE inline block_set(block_t *m_blocks, size_t bytes):
+            n_alloced(0), m_blocks(m_blocks), bytes(bytes),
+            all_next(nullptr), free_prev(nullptr), free_next(nullptr),
+            b_decommitted(false), b_idle(false)
         {
             for (size_t i = 0; i < n_blocks; ++i)
                 m_free_stack[i] = m_blocks + i;
@@ -232,7 +385,7 @@ namespace fungus_util
             m_block_allocator.b_moved = true;
         }
 
-        FUNGUSUTIL_ALWAYS_INLINE inline block_allocator(size_t n_block_sets = 1):
+        FUNGUSUTIL_ALWAYS_INLINE inline block_allocator(size_t n_block_sets = 1, uint32_t flags = block_allocator_flag_none):
             b_moved(false), n_alloced(0)
         {}
 
@@ -243,6 +396,11 @@ namespace fungus_util
         FUNGUSUTIL_ALWAYS_INLINE inline size_t count_blocks()     const {return UINT32_MAX;}
         FUNGUSUTIL_ALWAYS_INLINE inline size_t count_alloced()    const {return n_alloced;}
 
+        FUNGUSUTIL_ALWAYS_INLINE inline size_t count_committed_bytes() const {return 0;}
+
+        inline size_t trim(size_t target_bytes = 0) {return 0;}
+        inline size_t reclaim()                     {return 0;}
+
         template <typename... argT>
         FUNGUSUTIL_ALWAYS_INLINE inline blockT *create(argT&&... argV)
         {
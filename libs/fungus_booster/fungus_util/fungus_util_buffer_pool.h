@@ -0,0 +1,92 @@
+#ifndef FUNGUSUTIL_BUFFER_POOL_H
+#define FUNGUSUTIL_BUFFER_POOL_H
+
+#include "fungus_util_common.h"
+#include "fungus_util_any.h"
+
+#include <vector>
+
+namespace fungus_util
+{
+    // A cache of byte buffers in power of two size classes.  Buffers
+    // given back are kept for the next request of their class, up to
+    // max_cached_bytes per class, and classes above max_cached_cap are
+    // never kept.  Every buffer is made with new char[], with
+    // header_bytes in front of it for the owner's own use, so one may
+    // always be delete[]d (from the start of its header) instead of
+    // being given back.
+    //
+    // A buffer_pool is not thread safe.  serializer and serializer_buf
+    // draw from the pool of the thread they run on, local(), when they
+    // are not given an allocator; a buffer freed on another thread just
+    // joins that thread's pool.
+    class FUNGUSUTIL_API buffer_pool: public serializer_allocator
+    {
+    public:
+        enum
+        {
+            n_classes = sizeof(size_t) * 8
+        };
+
+        static constexpr size_t default_max_cached_bytes = 256 * 1024;
+        static constexpr size_t default_max_cached_cap   = 1024 * 1024;
+
+        struct class_stats
+        {
+            size_t hits;   // served from the cache
+            size_t misses; // had to be made
+            size_t cached; // waiting in the cache now
+
+            class_stats(): hits(0), misses(0), cached(0) {}
+        };
+    private:
+        std::vector<char *> free_bufs[n_classes];
+        class_stats         stats[n_classes];
+
+        size_t header_bytes;
+        size_t max_cached_bytes;
+        size_t max_cached_cap;
+
+        inline char *__new_buf(size_t cap)    {return new char[header_bytes + cap] + header_bytes;}
+        inline void  __delete_buf(char *buf)  {delete[] (buf - header_bytes);}
+
+        FUNGUSUTIL_NO_ASSIGN(buffer_pool)
+    public:
+        buffer_pool(size_t header_bytes     = 0,
+                    size_t max_cached_bytes = default_max_cached_bytes,
+                    size_t max_cached_cap   = default_max_cached_cap);
+        virtual ~buffer_pool();
+
+        // the size class a request for size bytes is served from, the
+        // bit width of size - 1.  long is 32 bits on LLP64 targets, so
+        // the count is taken over a long long.
+        static inline size_t class_of(size_t size)
+        {
+            return size <= 1 ? 0 : (size_t)(sizeof(unsigned long long) * 8 -
+                                             __builtin_clzll((unsigned long long)(size - 1)));
+        }
+
+        // rounds cap up to its size class, which is what the buffer
+        // must be given back with.
+        char *allocate_at_least(size_t &cap);
+
+        // cap must be what allocate_at_least() left it as, or a
+        // power of two, as serializer always asks for.
+        virtual char *allocate(size_t cap);
+        virtual void  deallocate(char *buf, size_t cap);
+
+        // frees every cached buffer.
+        void trim();
+
+        class_stats get_class_stats(size_t size_class) const;
+
+        // this thread's pool.  nullptr once the thread has started to
+        // exit, after which buffers come from and go back to the heap.
+        static buffer_pool *local();
+
+        static char *local_allocate(size_t &cap);
+        static void  local_deallocate(char *buf, size_t cap);
+    };
+}
+
+#endif
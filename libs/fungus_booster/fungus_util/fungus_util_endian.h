@@ -2,7 +2,9 @@
 #define FUNGUSUTIL_ENDIAN_H
 
 #include <cstddef>
+#include <cstring>
 #include <stdint.h>
+#include <vector>
 
 #include "fungus_util_common.h"
 #include "fungus_util_type_info_wrap.h"
@@ -87,6 +89,61 @@ namespace fungus_util
     typedef std::map<type_info_wrap, endian_registration> __endian_reg_map_type;
 #endif
 
+    // Types listed here have their byte order resolved at compile time
+    // once lazy_register_numeric_types() has been called on a converter,
+    // so converting them never touches the registration map.  Any other
+    // type still has to be registered at runtime with register_type().
+    template <typename T> struct endian_static_type           {enum {value = false};};
+
+    template <> struct endian_static_type<int16_t>  {enum {value = true};};
+    template <> struct endian_static_type<int32_t>  {enum {value = true};};
+    template <> struct endian_static_type<int64_t>  {enum {value = true};};
+    template <> struct endian_static_type<uint16_t> {enum {value = true};};
+    template <> struct endian_static_type<uint32_t> {enum {value = true};};
+    template <> struct endian_static_type<uint64_t> {enum {value = true};};
+    template <> struct endian_static_type<float>    {enum {value = true};};
+    template <> struct endian_static_type<double>   {enum {value = true};};
+
+    template <size_t n_bytes>
+    struct __bswap
+    {
+        template <typename T>
+        FUNGUSUTIL_ALWAYS_INLINE static inline T __impl(const T &v)
+        {
+            T r;
+            flip_endian<n_bytes>((const char *)&v, (char *)&r);
+            return r;
+        }
+    };
+
+#define FUNGUSUTIL_BSWAP_SPECIALIZE(N, WORD, BUILTIN)                  \
+    template <>                                                         \
+    struct __bswap<N>                                                   \
+    {                                                                   \
+        template <typename T>                                           \
+        FUNGUSUTIL_ALWAYS_INLINE static inline T __impl(const T &v)     \
+        {                                                               \
+            WORD w;                                                     \
+            T r;                                                        \
+            memcpy(&w, &v, N);                                          \
+            w = BUILTIN(w);                                             \
+            memcpy(&r, &w, N);                                          \
+            return r;                                                   \
+        }                                                               \
+    };
+
+    FUNGUSUTIL_BSWAP_SPECIALIZE(2, uint16_t, __builtin_bswap16)
+    FUNGUSUTIL_BSWAP_SPECIALIZE(4, uint32_t, __builtin_bswap32)
+    FUNGUSUTIL_BSWAP_SPECIALIZE(8, uint64_t, __builtin_bswap64)
+
+#undef FUNGUSUTIL_BSWAP_SPECIALIZE
+
+    template <typename T>
+    FUNGUSUTIL_ALWAYS_INLINE static inline T bswap(const T &v)
+    {
+        return __bswap<sizeof(T)>::__impl(v);
+    }
+
     class FUNGUSUTIL_API endian_converter
     {
     private:
@@ -104,36 +161,40 @@ namespace fungus_util
         {
             T convert(const T &v) const
             {
-                T r;
-                flip_endian<sizeof(T)>((const char *)&v, (char *)&r);
-                return r;
+                return bswap(v);
             }
         };
 
+        FUNGUSUTIL_NO_ASSIGN(endian_converter)
+
+        // writers copy the current map, modify the copy and publish it.
+        // Readers never lock; old maps are kept until destruction since
+        // registration is rare and a reader may still be looking at one.
         mutex m;
 
-        __endian_reg_map_type type_regs;
+        atomic<__endian_reg_map_type *>     type_regs;
+        std::vector<__endian_reg_map_type *> type_regs_retired;
+
+        atomic<bool> __static_numeric;
         bool __lazy_init_numeric;
-    public:
-        endian_converter();
-        endian_converter(endian_converter &&endian);
 
-        void lazy_register_numeric_types();
-        void register_type(const endian_registration &et);
-        void unregister_type(const type_info_wrap &info);
-        bool type_registered(const type_info_wrap &info, int &target_endian) const;
+        void __publish(__endian_reg_map_type *regs);
 
-        template <typename T> inline void register_type()                           {register_type(endian_registration::get<T>());}
-        template <typename T> inline void unregister_type()                         {unregister_type(typeid(T));}
-        template <typename T> inline bool type_registered(int &target_endian) const {return type_registered(typeid(T), target_endian);}
-        template <typename T> inline bool type_registered() const                   {int _dummy; return type_registered(typeid(T), _dummy);}
+        FUNGUSUTIL_ALWAYS_INLINE inline bool __no_regs() const
+        {
+            const __endian_reg_map_type *regs = type_regs.load();
+            return !regs || regs->size() == 0;
+        }
 
         template <typename T>
-        inline T convert(const T &v) const
+        FUNGUSUTIL_ALWAYS_INLINE inline T __convert_registered(const T &v) const
         {
             const __smart_endian_flip<T, big_endian>    __big_converter    = __smart_endian_flip<T, big_endian>();
             const __smart_endian_flip<T, little_endian> __little_converter = __smart_endian_flip<T, little_endian>();
 
+            if (__no_regs())
+                return v;
+
             int target_endian;
             bool do_conv = type_registered<T>(target_endian);
 
@@ -149,6 +210,56 @@ namespace fungus_util
 
             return v;
         }
+
+        // made once per type, so that looking a type up on every
+        // convert() neither allocates nor hashes its name again.
+        template <typename T>
+        static inline const type_info_wrap &__type_key()
+        {
+            static const type_info_wrap key(typeid(T));
+            return key;
+        }
+
+        template <bool _b_static, typename T>
+        struct __convert_impl
+        {
+            FUNGUSUTIL_ALWAYS_INLINE static inline T __impl(const endian_converter &endian, const T &v)
+            {
+                return endian.__convert_registered(v);
+            }
+        };
+
+        template <typename T>
+        struct __convert_impl<true, T>
+        {
+            FUNGUSUTIL_ALWAYS_INLINE static inline T __impl(const endian_converter &endian, const T &v)
+            {
+                if (endian.__static_numeric.load(memory_order_relaxed))
+                    return bswap(v);
+                else
+                    return endian.__convert_registered(v);
+            }
+        };
+    public:
+        endian_converter();
+        endian_converter(endian_converter &&endian);
+        ~endian_converter();
+
+        void lazy_register_numeric_types();
+        void register_type(const endian_registration &et);
+        void unregister_type(const type_info_wrap &info);
+        bool type_registered(const type_info_wrap &info, int &target_endian) const;
+
+        template <typename T> inline void register_type()                           {register_type(endian_registration::get<T>());}
+        template <typename T> inline void unregister_type()                         {unregister_type(typeid(T));}
+        template <typename T> inline bool type_registered(int &target_endian) const {return type_registered(__type_key<T>(), target_endian);}
+        template <typename T> inline bool type_registered() const                   {int _dummy; return type_registered(__type_key<T>(), _dummy);}
+
+        template <typename T>
+        inline T convert(const T &v) const
+        {
+            return __convert_impl<endian_static_type<T>::value, T>::__impl(*this, v);
+        }
     };
 }
 
@@ -0,0 +1,680 @@
+#ifndef FUNGUSUTIL_FLAT_HASH_MAP_H
+#define FUNGUSUTIL_FLAT_HASH_MAP_H
+
+#include "fungus_util_common.h"
+
+#ifdef FUNGUSUTIL_CPP11_PARTIAL
+
+#include "fungus_util_hash_map.h"
+#include "fungus_util_pow2.h"
+
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+namespace fungus_util
+{
+    // an open addressing counterpart to hash_map, taking the same hash
+    // policies (hash_key() and the hash_entry_on_* hooks) and offering
+    // the same interface, so that a map can be switched by changing its
+    // template.
+    //
+    // entries live inline in one array of slots whose size is a power of
+    // two.  collisions are resolved by robin hood linear probing: every
+    // slot remembers how far its entry is from the slot it hashed to, and
+    // an entry being placed takes the slot of any entry closer to home
+    // than itself.  erasing shifts the rest of the run back by one, so no
+    // tombstones are left behind.  the table is followed by max_probe
+    // overflow slots rather than wrapping around, so that shifting only
+    // ever moves entries towards the front, and erase(iterator) returns
+    // an iterator that will visit every remaining entry exactly once.
+    //
+    // unlike hash_map, inserting or erasing moves entries, so pointers
+    // and iterators in to the map do not survive either.
+    template <typename hashT, size_t init_size = 16>
+    class flat_hash_map
+    {
+    public:
+        typedef typename hashT::key_type   key_type;
+        typedef typename hashT::value_type value_type;
+        typedef typename hashT::data_type  data_type;
+
+        class entry
+        {
+        public:
+            key_type   key;
+            value_type value;
+            data_type  data;
+
+            FUNGUSUTIL_ALWAYS_INLINE inline entry(): key(), value(), data() {}
+
+            FUNGUSUTIL_ALWAYS_INLINE inline entry(entry &&e):
+                key(std::move(e.key)), value(std::move(e.value)), data(std::move(e.data))
+            {}
+
+            FUNGUSUTIL_ALWAYS_INLINE inline entry(const entry &e):
+                key(e.key), value(e.value), data(e.data)
+            {}
+
+            FUNGUSUTIL_ALWAYS_INLINE inline entry(const key_type &key, value_type &&value):
+                key(key), value(std::move(value)), data()
+            {}
+
+            FUNGUSUTIL_ALWAYS_INLINE inline entry(const key_type &key, const value_type &value):
+                key(key), value(value), data()
+            {}
+
+            FUNGUSUTIL_ALWAYS_INLINE inline entry &operator =(entry &&e)
+            {
+                key   = std::move(e.key);
+                value = std::move(e.value);
+                data  = std::move(e.data);
+
+                return *this;
+            }
+
+            FUNGUSUTIL_ALWAYS_INLINE inline entry &operator =(const entry &e)
+            {
+                key   = e.key;
+                value = e.value;
+                data  = e.data;
+
+                return *this;
+            }
+
+            FUNGUSUTIL_ALWAYS_INLINE inline operator std::pair<key_type, value_type>()
+            {
+                return std::pair<key_type, value_type>(key, value);
+            }
+
+            FUNGUSUTIL_ALWAYS_INLINE inline operator const std::pair<const key_type, value_type>() const
+            {
+                return std::pair<const key_type, value_type>(key, value);
+            }
+        };
+    private:
+        struct slot
+        {
+            // how far the entry is from its home slot, or empty_dist.
+            int8_t dist;
+
+            typename std::aligned_storage<sizeof(entry), std::alignment_of<entry>::value>::type storage;
+
+            FUNGUSUTIL_ALWAYS_INLINE inline slot(): dist(empty_dist) {}
+
+            FUNGUSUTIL_ALWAYS_INLINE inline bool empty() const
+            {
+                return dist < 0;
+            }
+
+            FUNGUSUTIL_ALWAYS_INLINE inline entry &get()
+            {
+                return *reinterpret_cast<entry *>(&storage);
+            }
+
+            FUNGUSUTIL_ALWAYS_INLINE inline const entry &get() const
+            {
+                return *reinterpret_cast<const entry *>(&storage);
+            }
+        };
+
+        static constexpr int8_t empty_dist    = -1;
+        static constexpr size_t min_capacity  = 4;
+
+        // n_slots() is the table, then max_probe overflow slots, then one
+        // slot that always stays empty and ends every probe.
+        slot    *slots;
+        size_t   m_capacity;
+        unsigned m_shift;
+        int8_t   max_probe;
+        size_t   n_elems;
+
+        mutable hashT __hash_impl;
+
+        FUNGUSUTIL_ALWAYS_INLINE inline size_t n_slots() const
+        {
+            return m_capacity + max_probe + 1;
+        }
+
+        // hash_key() folds in to a range with %, so ask for the full range
+        // and then spread it over the table with a fibonacci multiply,
+        // which keeps weak low bits from piling entries up in one run.
+        template <typename lookupT>
+        FUNGUSUTIL_ALWAYS_INLINE inline size_t __home(const lookupT &key) const
+        {
+            uint32_t h = __hash_impl.hash_key(key, UINT32_MAX);
+            return (size_t)((uint32_t)(h * 2654435769u) >> m_shift);
+        }
+
+        void __alloc(size_t capacity)
+        {
+            unsigned bits = 0;
+            while (((size_t)1 << bits) < capacity)
+                ++bits;
+
+            m_capacity = (size_t)1 << bits;
+            m_shift    = 32 - bits;
+            max_probe  = (int8_t)(bits < 4 ? 4 : bits);
+            n_elems    = 0;
+
+            slots = new slot[n_slots()];
+        }
+
+        void __free()
+        {
+            if (!slots) return;
+
+            for (size_t i = 0; i < n_slots(); ++i)
+            {
+                if (!slots[i].empty())
+                    slots[i].get().~entry();
+            }
+
+            delete[] slots;
+            slots = nullptr;
+        }
+
+        template <typename lookupT>
+        FUNGUSUTIL_ALWAYS_INLINE inline slot *__find(const lookupT &key) const
+        {
+            slot *s = slots + __home(key);
+            for (int8_t d = 0; s->dist >= d; ++s, ++d)
+            {
+                if (s->get().key == key)
+                    return s;
+            }
+
+            return nullptr;
+        }
+
+        // places an entry whose key is not in the map.  returns its slot,
+        // or nullptr if the table had to grow on the way.
+        slot *__place(entry &&e)
+        {
+            entry  cur(std::move(e));
+            slot  *placed = nullptr;
+
+            slot  *s = slots + __home(cur.key);
+            int8_t d = 0;
+
+            for (;; ++s, ++d)
+            {
+                if (d > max_probe)
+                {
+                    __rehash(m_capacity << 1);
+                    __place(std::move(cur));
+
+                    return nullptr;
+                }
+
+                if (s->empty())
+                {
+                    new (&s->storage) entry(std::move(cur));
+                    s->dist = d;
+                    ++n_elems;
+
+                    return placed ? placed : s;
+                }
+
+                if (s->dist < d)
+                {
+                    std::swap(cur, s->get());
+                    std::swap(d, s->dist);
+
+                    if (!placed) placed = s;
+                }
+            }
+        }
+
+        void __remove_at(slot *s)
+        {
+            s->get().~entry();
+            s->dist = empty_dist;
+            --n_elems;
+
+            for (slot *next = s + 1; next->dist > 0; ++s, ++next)
+            {
+                new (&s->storage) entry(std::move(next->get()));
+                s->dist = next->dist - 1;
+
+                next->get().~entry();
+                next->dist = empty_dist;
+            }
+        }
+
+        void __rehash(size_t capacity)
+        {
+            slot  *old_slots   = slots;
+            size_t old_n_slots = n_slots();
+
+            __alloc(capacity);
+
+            for (size_t i = 0; i < old_n_slots; ++i)
+            {
+                if (!old_slots[i].empty())
+                {
+                    __place(std::move(old_slots[i].get()));
+                    old_slots[i].get().~entry();
+                }
+            }
+
+            delete[] old_slots;
+        }
+
+        FUNGUSUTIL_ALWAYS_INLINE inline void __reserve_one()
+        {
+            // keep the load at or under 3/4.
+            if ((n_elems + 1) * 4 > m_capacity * 3)
+                __rehash(m_capacity << 1);
+        }
+
+        void __copy(const flat_hash_map &__map)
+        {
+            __alloc(__map.m_capacity);
+
+            for (size_t i = 0; i < __map.n_slots(); ++i)
+            {
+                if (!__map.slots[i].empty())
+                    __place(entry(__map.slots[i].get()));
+            }
+        }
+    public:
+        class iterator;
+        class const_iterator;
+
+        FUNGUSUTIL_ALWAYS_INLINE inline flat_hash_map(size_t m_table_size = init_size, hashT hash = hashT()):
+            slots(nullptr), __hash_impl(hash)
+        {
+            __alloc(m_table_size < min_capacity ? min_capacity : m_table_size);
+        }
+
+        FUNGUSUTIL_ALWAYS_INLINE inline flat_hash_map(const flat_hash_map &__map):
+            slots(nullptr), __hash_impl(__map.__hash_impl)
+        {
+            __copy(__map);
+        }
+
+        FUNGUSUTIL_ALWAYS_INLINE inline flat_hash_map(flat_hash_map &&__map):
+            slots(__map.slots), m_capacity(__map.m_capacity), m_shift(__map.m_shift),
+            max_probe(__map.max_probe), n_elems(__map.n_elems),
+            __hash_impl(std::move(__map.__hash_impl))
+        {
+            __map.slots = nullptr;
+            __map.__alloc(min_capacity);
+        }
+
+        template <typename iterator_type>
+        FUNGUSUTIL_ALWAYS_INLINE inline flat_hash_map(const iterator_type &it_b, const iterator_type &it_e):
+            slots(nullptr), __hash_impl(hashT())
+        {
+            __alloc(init_size < min_capacity ? min_capacity : init_size);
+            assign(it_b, it_e);
+        }
+
+        FUNGUSUTIL_ALWAYS_INLINE inline ~flat_hash_map()
+        {
+            clear();
+            __free();
+        }
+
+        template <typename iterator_type>
+        FUNGUSUTIL_ALWAYS_INLINE inline void assign(const iterator_type &it_b, const iterator_type &it_e)
+        {
+            clear();
+            for (auto it = it_b; it != it_e; ++it)
+                insert(*it);
+        }
+
+        template <typename container_type>
+        FUNGUSUTIL_ALWAYS_INLINE inline void assign(const container_type &c)
+        {
+            assign(c.begin(), c.end());
+        }
+
+        FUNGUSUTIL_ALWAYS_INLINE inline flat_hash_map &operator =(const flat_hash_map &__map)
+        {
+            if (&__map != this)
+            {
+                clear();
+                __free();
+
+                __hash_impl = __map.__hash_impl;
+                __copy(__map);
+            }
+
+            return *this;
+        }
+
+        FUNGUSUTIL_ALWAYS_INLINE inline flat_hash_map &operator =(flat_hash_map &&__map)
+        {
+            if (&__map != this)
+            {
+                clear();
+                __free();
+
+                slots       = __map.slots;
+                m_capacity  = __map.m_capacity;
+                m_shift     = __map.m_shift;
+                max_probe   = __map.max_probe;
+                n_elems     = __map.n_elems;
+                __hash_impl = std::move(__map.__hash_impl);
+
+                __map.slots = nullptr;
+                __map.__alloc(min_capacity);
+            }
+
+            return *this;
+        }
+
+        FUNGUSUTIL_ALWAYS_INLINE inline size_t size() const
+        {
+            return n_elems;
+        }
+
+        FUNGUSUTIL_ALWAYS_INLINE inline bool empty() const
+        {
+            return n_elems == 0;
+        }
+
+        FUNGUSUTIL_ALWAYS_INLINE inline size_t table_size() const
+        {
+            return m_capacity;
+        }
+
+        FUNGUSUTIL_ALWAYS_INLINE inline void clear()
+        {
+            if (n_elems == 0) return;
+
+            for (size_t i = 0; i < n_slots(); ++i)
+            {
+                slot &s = slots[i];
+                if (!s.empty())
+                {
+                    entry &e = s.get();
+                    __hash_impl.hash_entry_force_remove(e.key, e.value, e.data);
+
+                    e.~entry();
+                    s.dist = empty_dist;
+                }
+            }
+
+            n_elems = 0;
+        }
+
+        FUNGUSUTIL_ALWAYS_INLINE inline iterator begin()
+        {
+            return iterator(slots, slots + n_slots());
+        }
+
+        FUNGUSUTIL_ALWAYS_INLINE inline const_iterator begin() const
+        {
+            return const_iterator(slots, slots + n_slots());
+        }
+
+        FUNGUSUTIL_ALWAYS_INLINE inline iterator end()
+        {
+            return iterator();
+        }
+
+        FUNGUSUTIL_ALWAYS_INLINE inline const_iterator end() const
+        {
+            return const_iterator();
+        }
+
+        FUNGUSUTIL_ALWAYS_INLINE inline iterator insert(const std::pair<key_type, value_type> &pair)
+        {
+            return insert(entry(pair.first, pair.second));
+        }
+
+        FUNGUSUTIL_ALWAYS_INLINE inline iterator insert(const entry &__entry)
+        {
+            return insert(std::move(entry(__entry)));
+        }
+
+        iterator insert(entry &&__entry)
+        {
+            slot *s = __find(__entry.key);
+
+            if (s)
+            {
+                entry &e = s->get();
+                if (__hash_impl.hash_entry_on_replace(__entry.key, e.value, __entry.value, e.data) != hash_entry_complete_action)
+                    return end();
+
+                e.value = std::move(__entry.value);
+                return iterator(s, slots + n_slots());
+            }
+
+            if (__hash_impl.hash_entry_on_insert(__entry.key, __entry.value, __entry.data) != hash_entry_complete_action)
+                return end();
+
+            __reserve_one();
+
+            key_type key = __entry.key;
+
+            s = __place(std::move(__entry));
+            if (!s)
+                s = __find(key);
+
+            return iterator(s, slots + n_slots());
+        }
+
+        bool erase(const key_type &key)
+        {
+            slot *s = __find(key);
+            if (!s) return false;
+
+            entry &e = s->get();
+            if (__hash_impl.hash_entry_on_remove(e.key, e.value, e.data) != hash_entry_complete_action)
+                return false;
+
+            __remove_at(s);
+            return true;
+        }
+
+        // returns the entry after it.  that may be the one shifted in to
+        // the slot it was in.
+        iterator erase(const iterator &it)
+        {
+            if (!it.__slot) return end();
+
+            entry &e = it.__slot->get();
+            if (__hash_impl.hash_entry_on_remove(e.key, e.value, e.data) != hash_entry_complete_action)
+                return it;
+
+            __remove_at(it.__slot);
+            return iterator(it.__slot, it.__last);
+        }
+
+        FUNGUSUTIL_ALWAYS_INLINE inline iterator find(const key_type &key)
+        {
+            slot *s = __find(key);
+            return s ? iterator(s, slots + n_slots()) : end();
+        }
+
+        FUNGUSUTIL_ALWAYS_INLINE inline const_iterator find(const key_type &key) const
+        {
+            slot *s = __find(key);
+            return s ? const_iterator(s, slots + n_slots()) : end();
+        }
+
+        // see hash_map::find_as().
+        template <typename lookupT>
+        FUNGUSUTIL_ALWAYS_INLINE inline iterator find_as(const lookupT &key)
+        {
+            slot *s = __find(key);
+            return s ? iterator(s, slots + n_slots()) : end();
+        }
+
+        template <typename lookupT>
+        FUNGUSUTIL_ALWAYS_INLINE inline const_iterator find_as(const lookupT &key) const
+        {
+            slot *s = __find(key);
+            return s ? const_iterator(s, slots + n_slots()) : end();
+        }
+
+        FUNGUSUTIL_ALWAYS_INLINE inline iterator find(const char *str, size_t len)
+        {
+            return find_as(string_ref(str, len));
+        }
+
+        FUNGUSUTIL_ALWAYS_INLINE inline const_iterator find(const char *str, size_t len) const
+        {
+            return find_as(string_ref(str, len));
+        }
+
+        // makes room for n entries without growing again.
+        FUNGUSUTIL_ALWAYS_INLINE inline void rehash(size_t n)
+        {
+            size_t capacity = next_pow2((n * 4 + 2) / 3);
+            if (capacity > m_capacity)
+                __rehash(capacity);
+        }
+    };
+
+    template <typename hashT, size_t init_size>
+    constexpr int8_t flat_hash_map<hashT, init_size>::empty_dist;
+
+    template <typename hashT, size_t init_size>
+    constexpr size_t flat_hash_map<hashT, init_size>::min_capacity;
+
+    template <typename hashT, size_t init_size>
+    class flat_hash_map<hashT, init_size>::iterator:
+        public std::iterator<std::forward_iterator_tag, entry>
+    {
+    private:
+        slot *__slot;
+        slot *__last;
+
+        // moves to the first full slot at or after __slot.
+        FUNGUSUTIL_ALWAYS_INLINE inline void __settle()
+        {
+            while (__slot != __last && __slot->empty())
+                ++__slot;
+
+            if (__slot == __last)
+                __slot = nullptr;
+        }
+
+        FUNGUSUTIL_ALWAYS_INLINE inline iterator(slot *__slot, slot *__last):
+            __slot(__slot), __last(__last)
+        {
+            __settle();
+        }
+
+        friend class flat_hash_map<hashT, init_size>;
+        friend class const_iterator;
+    public:
+        FUNGUSUTIL_ALWAYS_INLINE inline iterator(): __slot(nullptr), __last(nullptr) {}
+
+        FUNGUSUTIL_ALWAYS_INLINE inline entry &operator *() const
+        {
+            fungus_util_assert(__slot, "Attempted to dereference a flat_hash_map iterator that was empty!\n");
+            return __slot->get();
+        }
+
+        FUNGUSUTIL_ALWAYS_INLINE inline entry *operator ->() const
+        {
+            return &(this->operator *());
+        }
+
+        FUNGUSUTIL_ALWAYS_INLINE inline iterator &operator ++()
+        {
+            if (__slot)
+            {
+                ++__slot;
+                __settle();
+            }
+
+            return *this;
+        }
+
+        FUNGUSUTIL_ALWAYS_INLINE inline iterator operator ++(int)
+        {
+            iterator temp = *this;
+            ++(*this);
+            return temp;
+        }
+
+        FUNGUSUTIL_ALWAYS_INLINE inline bool operator ==(const iterator &it) const
+        {
+            return __slot == it.__slot;
+        }
+
+        FUNGUSUTIL_ALWAYS_INLINE inline bool operator !=(const iterator &it) const
+        {
+            return __slot != it.__slot;
+        }
+    };
+
+    template <typename hashT, size_t init_size>
+    class flat_hash_map<hashT, init_size>::const_iterator:
+        public std::iterator<std::forward_iterator_tag, const entry>
+    {
+    private:
+        const slot *__slot;
+        const slot *__last;
+
+        FUNGUSUTIL_ALWAYS_INLINE inline void __settle()
+        {
+            while (__slot != __last && __slot->empty())
+                ++__slot;
+
+            if (__slot == __last)
+                __slot = nullptr;
+        }
+
+        FUNGUSUTIL_ALWAYS_INLINE inline const_iterator(const slot *__slot, const slot *__last):
+            __slot(__slot), __last(__last)
+        {
+            __settle();
+        }
+
+        friend class flat_hash_map<hashT, init_size>;
+    public:
+        FUNGUSUTIL_ALWAYS_INLINE inline const_iterator(): __slot(nullptr), __last(nullptr) {}
+        FUNGUSUTIL_ALWAYS_INLINE inline const_iterator(const iterator &it): __slot(it.__slot), __last(it.__last) {}
+
+        FUNGUSUTIL_ALWAYS_INLINE inline const entry &operator *() const
+        {
+            fungus_util_assert(__slot, "Attempted to dereference a flat_hash_map iterator that was empty!\n");
+            return __slot->get();
+        }
+
+        FUNGUSUTIL_ALWAYS_INLINE inline const entry *operator ->() const
+        {
+            return &(this->operator *());
+        }
+
+        FUNGUSUTIL_ALWAYS_INLINE inline const_iterator &operator ++()
+        {
+            if (__slot)
+            {
+                ++__slot;
+                __settle();
+            }
+
+            return *this;
+        }
+
+        FUNGUSUTIL_ALWAYS_INLINE inline const_iterator operator ++(int)
+        {
+            const_iterator temp = *this;
+            ++(*this);
+            return temp;
+        }
+
+        FUNGUSUTIL_ALWAYS_INLINE inline bool operator ==(const const_iterator &it) const
+        {
+            return __slot == it.__slot;
+        }
+
+        FUNGUSUTIL_ALWAYS_INLINE inline bool operator !=(const const_iterator &it) const
+        {
+            return __slot != it.__slot;
+        }
+    };
+}
+
+#endif
+#endif
@@ -0,0 +1,167 @@
+#ifndef FUNGUSUTIL_HASH_H
+#define FUNGUSUTIL_HASH_H
+
+#include "fungus_util_common.h"
+
+#include <stdint.h>
+#include <string>
+
+namespace fungus_util
+{
+    // general purpose hashing for hash_map and friends, after wyhash
+    // by Wang Yi (public domain).  hash_bytes() is for strings and other
+    // runs of bytes, hash_u64() is a full avalanche mix for integer and
+    // pointer keys, whose low bits tend to all look alike.
+
+    static const uint64_t __hash_secret[4] =
+    {
+        0xa0761d6478bd642fULL, 0xe7037ed1a0b428dbULL,
+        0x8ebc6af09c88c6e3ULL, 0x589965cc75374cc3ULL
+    };
+
+    // 64x64 -> 128 bit multiply, hi and lo words in to a and b.
+    FUNGUSUTIL_ALWAYS_INLINE static inline void __hash_mum(uint64_t &a, uint64_t &b)
+    {
+#ifdef __SIZEOF_INT128__
+        __uint128_t r = a;
+        r *= b;
+        a = (uint64_t)r;
+        b = (uint64_t)(r >> 64);
+#else
+        uint64_t ha = a >> 32, hb = b >> 32, la = (uint32_t)a, lb = (uint32_t)b;
+        uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+        uint64_t t  = rl + (rm0 << 32), c = t < rl;
+        uint64_t lo = t + (rm1 << 32);
+        c += lo < t;
+        uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+        a = lo;
+        b = hi;
+#endif
+    }
+
+    FUNGUSUTIL_ALWAYS_INLINE static inline uint64_t hash_mix(uint64_t a, uint64_t b)
+    {
+        __hash_mum(a, b);
+        return a ^ b;
+    }
+
+    FUNGUSUTIL_ALWAYS_INLINE static inline uint64_t hash_u64(uint64_t key, uint64_t seed = 0)
+    {
+        return hash_mix(key ^ __hash_secret[0], seed ^ __hash_secret[1]);
+    }
+
+    FUNGUSUTIL_ALWAYS_INLINE static inline uint64_t __hash_r8(const uint8_t *p)
+    {
+        uint64_t v;
+        memcpy(&v, p, 8);
+        return v;
+    }
+
+    FUNGUSUTIL_ALWAYS_INLINE static inline uint64_t __hash_r4(const uint8_t *p)
+    {
+        uint32_t v;
+        memcpy(&v, p, 4);
+        return v;
+    }
+
+    // 1 to 3 bytes, read so that every byte counts once.
+    FUNGUSUTIL_ALWAYS_INLINE static inline uint64_t __hash_r3(const uint8_t *p, size_t k)
+    {
+        return ((uint64_t)p[0] << 16) | ((uint64_t)p[k >> 1] << 8) | p[k - 1];
+    }
+
+    static inline uint64_t hash_bytes(const void *key, size_t len, uint64_t seed = 0)
+    {
+        const uint8_t *p = (const uint8_t *)key;
+        uint64_t a, b;
+
+        seed ^= hash_mix(seed ^ __hash_secret[0], __hash_secret[1]);
+
+        if (len <= 16)
+        {
+            if (len >= 4)
+            {
+                a = (__hash_r4(p) << 32) | __hash_r4(p + ((len >> 3) << 2));
+                b = (__hash_r4(p + len - 4) << 32) | __hash_r4(p + len - 4 - ((len >> 3) << 2));
+            }
+            else if (len > 0)
+            {
+                a = __hash_r3(p, len);
+                b = 0;
+            }
+            else
+                a = b = 0;
+        }
+        else
+        {
+            size_t i = len;
+
+            if (i > 48)
+            {
+                uint64_t see1 = seed, see2 = seed;
+
+                do
+                {
+                    seed = hash_mix(__hash_r8(p)      ^ __hash_secret[1], __hash_r8(p + 8)  ^ seed);
+                    see1 = hash_mix(__hash_r8(p + 16) ^ __hash_secret[2], __hash_r8(p + 24) ^ see1);
+                    see2 = hash_mix(__hash_r8(p + 32) ^ __hash_secret[3], __hash_r8(p + 40) ^ see2);
+                    p += 48;
+                    i -= 48;
+                }
+                while (i > 48);
+
+                seed ^= see1 ^ see2;
+            }
+
+            while (i > 16)
+            {
+                seed = hash_mix(__hash_r8(p) ^ __hash_secret[1], __hash_r8(p + 8) ^ seed);
+                i -= 16;
+                p += 16;
+            }
+
+            a = __hash_r8(p + i - 16);
+            b = __hash_r8(p + i - 8);
+        }
+
+        a ^= __hash_secret[1];
+        b ^= seed;
+        __hash_mum(a, b);
+
+        return hash_mix(a ^ __hash_secret[0] ^ len, b ^ __hash_secret[1]);
+    }
+
+    // folds a 64 bit hash in to [0, max).
+    FUNGUSUTIL_ALWAYS_INLINE static inline uint32_t hash_fold(uint64_t h, uint32_t max)
+    {
+        return (uint32_t)(h ^ (h >> 32)) % max;
+    }
+
+    // a borrowed run of characters, for looking up std::string keys
+    // without building a temporary std::string.  hashes and compares
+    // the same as a std::string holding the same characters.
+    struct string_ref
+    {
+        const char *data;
+        size_t      size;
+
+        string_ref(const char *data, size_t size): data(data), size(size)               {}
+        string_ref(const char *data):              data(data), size(strlen(data))       {}
+        string_ref(const std::string &s):          data(s.data()), size(s.size())       {}
+
+        bool operator ==(const string_ref &s) const
+        {
+            return size == s.size && memcmp(data, s.data, size) == 0;
+        }
+
+        bool operator !=(const string_ref &s) const
+        {
+            return !(*this == s);
+        }
+    };
+
+    static inline bool operator ==(const std::string &a, const string_ref &b) {return string_ref(a) == b;}
+    static inline bool operator !=(const std::string &a, const string_ref &b) {return string_ref(a) != b;}
+}
+
+#endif
@@ -6,6 +6,7 @@
 #ifdef FUNGUSUTIL_CPP11_PARTIAL
 
 #include "fungus_util_prime.h"
+#include "fungus_util_hash.h"
 #include "fungus_util_type_info_wrap.h"
 #include "fungus_util_bidirectional_container_base.h"
 #include "fungus_util_constexpr.h"
@@ -76,17 +77,11 @@ namespace fungus_util
     public:
         typedef uint64_t key_type;
 
-        // source unknown
+        // 64 bit keys are mostly pointers, whose low bits are all alike,
+        // so they get a full 128 bit multiply mix.
         FUNGUSUTIL_ALWAYS_INLINE inline map_index_type operator()(key_type key, map_index_type max) const
         {
-            key = (~key) + (key << 18); // key = (key << 18) - key - 1;
-            key = key ^ (key >> 31);
-            key = key * 21; // key = (key + (key << 2)) + (key << 4);
-            key = key ^ (key >> 11);
-            key = key + (key << 6);
-            key = key ^ (key >> 22);
-
-            return (map_index_type)key % max;
+            return hash_fold(hash_u64(key), max);
         }
     };
 
@@ -140,12 +135,19 @@ namespace fungus_util
     public:
         FUNGUSUTIL_ALWAYS_INLINE static inline map_index_type __impl(const std::string &key, map_index_type max)
         {
-            map_index_type hash = 0;
-
-			for (size_t i = 0; i < key.size(); ++i)
-                hash ^= (hash << 5) + (hash >> 2) + key[i];
+            return hash_fold(hash_bytes(key.data(), key.size()), max);
+        }
+    };
 
-			return hash % max;
+    // hashes the same as the std::string it refers to, so that
+    // std::string keyed maps can be searched with find_as().
+    template <>
+    class __default_hash_key_fn_impl<string_ref>
+    {
+    public:
+        FUNGUSUTIL_ALWAYS_INLINE static inline map_index_type __impl(const string_ref &key, map_index_type max)
+        {
+            return hash_fold(hash_bytes(key.data, key.size), max);
         }
     };
 
@@ -155,8 +157,7 @@ namespace fungus_util
     public:
         FUNGUSUTIL_ALWAYS_INLINE static inline map_index_type __impl(const type_info_wrap &key, map_index_type max)
         {
-            return __default_hash_key_fn_impl<std::string>::__impl
-                    (key.name(), max);
+            return hash_fold(key.hash_code(), max);
         }
     };
 
@@ -174,6 +175,14 @@ namespace fungus_util
             return __default_hash_key_fn_impl<keyT>::__impl(key, max);
         }
 
+        // for find_as(), lookup keys of another type that compare
+        // and hash the same as keyT.
+        template <typename lookupT>
+        FUNGUSUTIL_ALWAYS_INLINE inline map_index_type    hash_key(const lookupT &key, map_index_type max)
+        {
+            return __default_hash_key_fn_impl<lookupT>::__impl(key, max);
+        }
+
         FUNGUSUTIL_ALWAYS_INLINE inline hash_entry_action hash_entry_on_insert(const keyT &key,
                                                       valueT &value,
                                                       dataT &data)
@@ -215,6 +224,14 @@ namespace fungus_util
             return __default_hash_key_fn_impl<keyT>::__impl(key, max);
         }
 
+        // for find_as(), lookup keys of another type that compare
+        // and hash the same as keyT.
+        template <typename lookupT>
+        FUNGUSUTIL_ALWAYS_INLINE inline map_index_type    hash_key(const lookupT &key, map_index_type max)
+        {
+            return __default_hash_key_fn_impl<lookupT>::__impl(key, max);
+        }
+
         FUNGUSUTIL_ALWAYS_INLINE inline hash_entry_action hash_entry_on_insert(const keyT &key,
                                                       valueT *value,
                                                       dataT &data)
@@ -440,7 +457,8 @@ namespace fungus_util
                 __top = __new_cell;
             }
 
-            FUNGUSUTIL_ALWAYS_INLINE inline bool find(const key_type &key)
+            template <typename lookupT>
+            FUNGUSUTIL_ALWAYS_INLINE inline bool find(const lookupT &key)
             {
                 reset();
 
@@ -785,6 +803,33 @@ namespace fungus_util
             return m.find(key) ? const_iterator(m.__cell) : end();
         }
 
+        // looks up by a key of another type, such as a string_ref in to
+        // a std::string keyed map, without building a key_type.  the
+        // policy must hash it the same as the key_type it is equal to.
+        template <typename lookupT>
+        FUNGUSUTIL_ALWAYS_INLINE inline iterator find_as(const lookupT &key)
+        {
+            cell_manip m(table[__hash_impl.hash_key(key, m_table_size)]);
+            return m.find(key) ? iterator(m.__cell) : end();
+        }
+
+        template <typename lookupT>
+        FUNGUSUTIL_ALWAYS_INLINE inline const_iterator find_as(const lookupT &key) const
+        {
+            cell_manip m(table[__hash_impl.hash_key(key, m_table_size)]);
+            return m.find(key) ? const_iterator(m.__cell) : end();
+        }
+
+        FUNGUSUTIL_ALWAYS_INLINE inline iterator find(const char *str, size_t len)
+        {
+            return find_as(string_ref(str, len));
+        }
+
+        FUNGUSUTIL_ALWAYS_INLINE inline const_iterator find(const char *str, size_t len) const
+        {
+            return find_as(string_ref(str, len));
+        }
+
         FUNGUSUTIL_ALWAYS_INLINE inline void rehash(size_t _new_table_size)
         {
             const size_t new_table_size = next_prime(_new_table_size);
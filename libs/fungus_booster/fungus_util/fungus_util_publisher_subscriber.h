@@ -3,6 +3,7 @@
 
 #include "fungus_util_common.h"
 #include "fungus_util_block_allocator.h"
+#include "fungus_util_flat_hash_map.h"
 
 namespace fungus_util
 {
@@ -101,7 +102,7 @@ namespace fungus_util
             subsbase_type;
     
         typedef
-            hash_map
+            flat_hash_map
             <
                 default_hash
                 <
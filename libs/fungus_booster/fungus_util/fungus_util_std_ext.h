@@ -6,6 +6,7 @@
 #include "fungus_util_make_string.h"
 #include "fungus_util_from_string.h"
 #include "fungus_util_hash_map.h"
+#include "fungus_util_flat_hash_map.h"
 #include "fungus_util_block_allocator.h"
 #include "fungus_util_optional.h"
 #include "fungus_util_auto_ptr.h"
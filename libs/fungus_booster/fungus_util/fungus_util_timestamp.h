@@ -32,11 +32,13 @@
 #endif
 #else
 #   include <sys/time.h>
+#   include <time.h>
 #endif
 
 namespace fungus_util
 {
     typedef long long   usec_duration_t;
+    typedef long long   nsec_duration_t;
     typedef long double  sec_duration_t;
 
     struct timestamp
@@ -113,6 +115,71 @@ namespace fungus_util
         return (usec_duration_t)(secs * 1000000.0);
     }
 
+    // the longest duration counted in nanoseconds.  about 146 years, and
+    // half the range, so a clock reading plus it cannot overflow.
+    static const nsec_duration_t nsec_duration_max = 0x3FFFFFFFFFFFFFFFLL;
+
+    // periods of LDBL_MAX seconds stand for "never"; they are clamped to
+    // nsec_duration_max rather than wrapping round to a negative count.
+    static inline nsec_duration_t sec_duration_to_nsec(sec_duration_t secs)
+    {
+        if (secs >= (sec_duration_t)nsec_duration_max / 1000000000.0)
+            return nsec_duration_max;
+        if (secs <= -(sec_duration_t)nsec_duration_max / 1000000000.0)
+            return -nsec_duration_max;
+
+        return (nsec_duration_t)(secs * 1000000000.0);
+    }
+
+    static inline sec_duration_t nsec_duration_to_sec(nsec_duration_t nsecs)
+    {
+        return (sec_duration_t)nsecs / 1000000000.0;
+    }
+
+    static inline nsec_duration_t usec_duration_to_nsec(usec_duration_t usecs)
+    {
+        return usecs * 1000LL;
+    }
+
+    static inline usec_duration_t nsec_duration_to_usec(nsec_duration_t nsecs)
+    {
+        return nsecs / 1000LL;
+    }
+
+    // timestamp follows the wall clock, which can jump.  for measuring
+    // durations use monotonic_clock, which counts nanoseconds from an
+    // arbitrary point and only ever moves forward.
+    //
+    // update() reads the clock and caches the result for the calling
+    // thread; now() returns the cached value.  call update() once at the
+    // top of a dispatch and everything under it can share that reading.
+    class FUNGUSUTIL_API monotonic_clock
+    {
+    public:
+        static inline nsec_duration_t read()
+        {
+#ifdef FUNGUSUTIL_WIN32
+            static LARGE_INTEGER freq = {{0, 0}};
+            if (freq.QuadPart == 0)
+                QueryPerformanceFrequency(&freq);
+
+            LARGE_INTEGER count;
+            QueryPerformanceCounter(&count);
+
+            return (nsec_duration_t)(count.QuadPart / freq.QuadPart) * 1000000000LL +
+                   (nsec_duration_t)(count.QuadPart % freq.QuadPart) * 1000000000LL / freq.QuadPart;
+#else
+            struct timespec ts;
+            clock_gettime(CLOCK_MONOTONIC, &ts);
+
+            return (nsec_duration_t)ts.tv_sec * 1000000000LL + (nsec_duration_t)ts.tv_nsec;
+#endif
+        }
+
+        static nsec_duration_t update();
+        static nsec_duration_t now();
+    };
+
     static inline std::ostream &operator <<(std::ostream &o, const timestamp &t)
     {
         return o << t.sec << '\'' << t.usec << "\"\"";
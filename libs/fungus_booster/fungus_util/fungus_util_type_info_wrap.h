@@ -3,6 +3,7 @@
 
 #include <typeinfo>
 #include "fungus_util_common.h"
+#include "fungus_util_hash.h"
 
 namespace fungus_util
 {
@@ -19,6 +20,9 @@ namespace fungus_util
     // It's used internally by endian_converter
     // as a key value in a map it uses to store
     // the types registered for conversion.
+    // The hash of the type's name is worked
+    // out once, when the wrapper is made, so
+    // hashing one as a map key is free.
 
     class type_info_wrap
     {
@@ -26,10 +30,17 @@ namespace fungus_util
         struct container
         {
             const std::type_info &info;
+            uint64_t              hash;
 
-            container():                           info(typeid(void)) {}
-            container(const std::type_info &info): info(info)         {}
-            container(const container &wrap):      info(wrap)         {}
+            container():                           info(typeid(void)), hash(hash_name(info)) {}
+            container(const std::type_info &info): info(info),         hash(hash_name(info)) {}
+            container(const container &wrap):      info(wrap.info),    hash(wrap.hash)       {}
+
+            static uint64_t hash_name(const std::type_info &info)
+            {
+                const char *name = info.name();
+                return hash_bytes(name, strlen(name));
+            }
 
             operator const std::type_info &() const
             {
@@ -126,8 +137,16 @@ namespace fungus_util
             return m_container->info.name();
         }
 
+        uint64_t hash_code() const
+        {
+            return m_container->hash;
+        }
+
         bool operator ==(const type_info_wrap &wrap) const
         {
+            if (m_container->hash != wrap.m_container->hash)
+                return false;
+
             return *m_container == *(wrap.m_container);
         }
 
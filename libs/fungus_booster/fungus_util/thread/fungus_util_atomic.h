@@ -0,0 +1,87 @@
+#ifndef FUNGUSUTIL_THREAD_ATOMIC_H
+#define FUNGUSUTIL_THREAD_ATOMIC_H
+
+#include "fungus_util_thread_common.h"
+
+// a thin wrapper around the GCC __atomic builtins, in the
+// same spirit as mutex and condition wrap the platform
+// primitives.  Only integral and pointer types should be
+// used with atomic<T>.
+
+#define FUNGUSUTIL_CACHE_LINE_SIZE 64
+#define FUNGUSUTIL_CACHE_ALIGNED   __attribute__ ((aligned (FUNGUSUTIL_CACHE_LINE_SIZE)))
+
+namespace fungus_util
+{
+    enum memory_order
+    {
+        memory_order_relaxed = __ATOMIC_RELAXED,
+        memory_order_acquire = __ATOMIC_ACQUIRE,
+        memory_order_release = __ATOMIC_RELEASE,
+        memory_order_acq_rel = __ATOMIC_ACQ_REL,
+        memory_order_seq_cst = __ATOMIC_SEQ_CST
+    };
+
+    template <typename T>
+    class atomic
+    {
+    private:
+        volatile T v;
+
+        FUNGUSUTIL_NO_ASSIGN(atomic)
+    public:
+        atomic():           v() {}
+        atomic(const T &v): v(v) {}
+
+        FUNGUSUTIL_ALWAYS_INLINE inline T load(memory_order order = memory_order_acquire) const
+        {
+            return __atomic_load_n(&v, order);
+        }
+
+        FUNGUSUTIL_ALWAYS_INLINE inline void store(T n, memory_order order = memory_order_release)
+        {
+            __atomic_store_n(&v, n, order);
+        }
+
+        FUNGUSUTIL_ALWAYS_INLINE inline T exchange(T n, memory_order order = memory_order_acq_rel)
+        {
+            return __atomic_exchange_n(&v, n, order);
+        }
+
+        // on failure, expected is updated to the current value.
+        FUNGUSUTIL_ALWAYS_INLINE inline bool compare_exchange(T &expected, T n,
+                                                              memory_order order = memory_order_acq_rel)
+        {
+            return __atomic_compare_exchange_n(&v, &expected, n, false, order,
+                                               order == memory_order_acq_rel ? memory_order_acquire :
+                                               order == memory_order_release ? memory_order_relaxed : order);
+        }
+
+        FUNGUSUTIL_ALWAYS_INLINE inline T fetch_add(T n, memory_order order = memory_order_acq_rel)
+        {
+            return __atomic_fetch_add(&v, n, order);
+        }
+
+        FUNGUSUTIL_ALWAYS_INLINE inline T fetch_sub(T n, memory_order order = memory_order_acq_rel)
+        {
+            return __atomic_fetch_sub(&v, n, order);
+        }
+    };
+
+    FUNGUSUTIL_ALWAYS_INLINE static inline void atomic_fence(memory_order order = memory_order_seq_cst)
+    {
+        __atomic_thread_fence(order);
+    }
+
+    // hint to the processor that we are spinning.
+    FUNGUSUTIL_ALWAYS_INLINE static inline void cpu_relax()
+    {
+#if defined(__i386__) || defined(__x86_64__)
+        __builtin_ia32_pause();
+#else
+        __asm__ __volatile__ ("" ::: "memory");
+#endif
+    }
+}
+
+#endif
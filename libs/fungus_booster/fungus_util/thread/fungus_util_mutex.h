@@ -14,11 +14,14 @@ namespace fungus_util
         pthread_mutex_t _handle;
 #endif
 
+        // how many times the owner holds it.  only touched by the owner.
+        size_t _depth;
+
         friend class condition;
 
         FUNGUSUTIL_NO_ASSIGN(mutex)
     public:
-        mutex()
+        mutex(): _depth(0)
         {
 #ifdef FUNGUSUTIL_WIN32
             InitializeCriticalSection(&_handle);
@@ -46,25 +49,36 @@ namespace fungus_util
 #else
             pthread_mutex_lock(&_handle);
 #endif
+            ++_depth;
         }
 
         inline bool try_lock()
         {
 #ifdef FUNGUSUTIL_WIN32
-            return TryEnterCriticalSection(&_handle) ? true : false;
+            bool success = TryEnterCriticalSection(&_handle) ? true : false;
 #else
-            return (pthread_mutex_trylock(&_handle) == 0) ? true : false;
+            bool success = (pthread_mutex_trylock(&_handle) == 0) ? true : false;
 #endif
+            if (success) ++_depth;
+            return success;
         }
 
         inline void unlock()
         {
+            --_depth;
 #ifdef FUNGUSUTIL_WIN32
             LeaveCriticalSection(&_handle);
 #else
             pthread_mutex_unlock(&_handle);
 #endif
         }
+
+        // how many times the calling thread holds the mutex.  only
+        // meaningful to a thread that holds it.
+        inline size_t get_depth() const
+        {
+            return _depth;
+        }
     };
 
     // a scope lock
@@ -86,6 +100,111 @@ namespace fungus_util
             if (_mutex) _mutex->unlock();
         }
     };
+
+    // a reader-writer lock.  unlike mutex it is not recursive: a thread
+    // holding it in either mode must not take it again.
+    class rw_mutex
+    {
+    private:
+#ifdef FUNGUSUTIL_WIN32
+        SRWLOCK _handle;
+#else
+        pthread_rwlock_t _handle;
+#endif
+
+        FUNGUSUTIL_NO_ASSIGN(rw_mutex)
+    public:
+        rw_mutex()
+        {
+#ifdef FUNGUSUTIL_WIN32
+            InitializeSRWLock(&_handle);
+#else
+            pthread_rwlock_init(&_handle, nullptr);
+#endif
+        }
+
+        ~rw_mutex()
+        {
+#ifndef FUNGUSUTIL_WIN32
+            pthread_rwlock_destroy(&_handle);
+#endif
+        }
+
+        inline void lock_shared()
+        {
+#ifdef FUNGUSUTIL_WIN32
+            AcquireSRWLockShared(&_handle);
+#else
+            pthread_rwlock_rdlock(&_handle);
+#endif
+        }
+
+        inline void unlock_shared()
+        {
+#ifdef FUNGUSUTIL_WIN32
+            ReleaseSRWLockShared(&_handle);
+#else
+            pthread_rwlock_unlock(&_handle);
+#endif
+        }
+
+        inline void lock()
+        {
+#ifdef FUNGUSUTIL_WIN32
+            AcquireSRWLockExclusive(&_handle);
+#else
+            pthread_rwlock_wrlock(&_handle);
+#endif
+        }
+
+        inline void unlock()
+        {
+#ifdef FUNGUSUTIL_WIN32
+            ReleaseSRWLockExclusive(&_handle);
+#else
+            pthread_rwlock_unlock(&_handle);
+#endif
+        }
+    };
+
+    // scope locks for rw_mutex
+    class read_lock
+    {
+    private:
+        rw_mutex *_mutex;
+
+        FUNGUSUTIL_NO_ASSIGN(read_lock)
+    public:
+        read_lock(rw_mutex &__mutex)
+        {
+            __mutex.lock_shared();
+            _mutex = &__mutex;
+        }
+
+        ~read_lock()
+        {
+            _mutex->unlock_shared();
+        }
+    };
+
+    class write_lock
+    {
+    private:
+        rw_mutex *_mutex;
+
+        FUNGUSUTIL_NO_ASSIGN(write_lock)
+    public:
+        write_lock(rw_mutex &__mutex)
+        {
+            __mutex.lock();
+            _mutex = &__mutex;
+        }
+
+        ~write_lock()
+        {
+            _mutex->unlock();
+        }
+    };
 }
 
 #endif
@@ -0,0 +1,73 @@
+#ifndef FUNGUSUTIL_THREAD_NOTIFIER_H
+#define FUNGUSUTIL_THREAD_NOTIFIER_H
+
+#include "fungus_util_thread_common.h"
+#include "../fungus_util_timestamp.h"
+
+namespace fungus_util
+{
+    // lets one thread sleep until another tells it there is work.
+    //
+    // notify() bumps an epoch.  a waiter reads the epoch with
+    // get_epoch(), checks for work, and only then calls wait() with the
+    // epoch it read, so a notify() that lands between the check and the
+    // wait is never lost.  notify() makes no system call unless someone
+    // is actually waiting.
+    //
+    // on linux this is a futex on the epoch itself.
+    //
+    // a thread that sleeps in epoll instead of wait() can attach an
+    // eventfd; until it detaches, notify() also writes to the eventfd.
+    // attach before checking for work, as with get_epoch().  only one
+    // eventfd can be attached at a time.  (linux only.)
+    class FUNGUSUTIL_API notifier
+    {
+    private:
+        // not an atomic<>, because the futex needs its address.
+        volatile int _epoch;
+        volatile int _waiters;
+
+#ifdef __linux__
+        volatile int _eventfd;
+#endif
+
+#ifdef FUNGUSUTIL_WIN32
+        HANDLE _event;
+#elif !defined(__linux__)
+        // condition has no timed wait, so use pthreads directly.
+        pthread_mutex_t _m;
+        pthread_cond_t  _c;
+#endif
+
+        void _wake();
+
+        FUNGUSUTIL_NO_ASSIGN(notifier)
+    public:
+        notifier();
+        ~notifier();
+
+        inline int get_epoch() const
+        {
+            return __atomic_load_n(&_epoch, __ATOMIC_ACQUIRE);
+        }
+
+        inline void notify()
+        {
+            __atomic_fetch_add(&_epoch, 1, __ATOMIC_SEQ_CST);
+
+            if (__atomic_load_n(&_waiters, __ATOMIC_SEQ_CST) > 0)
+                _wake();
+        }
+
+        // sleeps until the epoch moves past epoch or timeout runs out.
+        // a negative timeout waits forever.  returns false on timeout.
+        bool wait(int epoch, nsec_duration_t timeout);
+
+#ifdef __linux__
+        void attach_eventfd(int fd);
+        void detach_eventfd();
+#endif
+    };
+}
+
+#endif
@@ -4,6 +4,8 @@
 #include "fungus_util_thread_common.h"
 #include "fungus_util_mutex.h"
 #include "fungus_util_condition.h"
+#include "fungus_util_atomic.h"
+#include "fungus_util_notifier.h"
 #include <iostream>
 
 namespace fungus_util
@@ -22,6 +24,7 @@ namespace fungus_util
         native_id _handle;   ///< Thread handle.
         mutable mutex _data_mutex;     ///< Serializer for access to the thread private data.
         bool _not_thread;             ///< True if this object is not a thread of execution.
+        bool _unjoined;               ///< True from start() until join(), even once the thread has finished.
 #ifdef FUNGUSUTIL_WIN32
         unsigned int w32_thread_id;  ///< Unique thread ID (filled out by _beginthreadex).
 #endif
@@ -35,7 +38,7 @@ namespace fungus_util
     public:
         class id;
 
-        thread(): _handle(0), _not_thread(true)
+        thread(): _handle(0), _not_thread(true), _unjoined(false)
 #ifdef FUNGUSUTIL_WIN32
             ,w32_thread_id(0)
 #endif
@@ -1,9 +1,16 @@
 #include "fungus_util_thread.h"
 #include "fungus_util_condition.h"
 #include "fungus_util_mutex.h"
+#include "fungus_util_notifier.h"
 
 #ifdef FUNGUSUTIL_WIN32
 #include <process.h>
+#elif defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <climits>
 #endif
 
 #ifdef FUNGUSUTIL_WIN32
@@ -63,6 +70,125 @@ void condition::notify_all()
 }
 #endif
 
+notifier::notifier(): _epoch(0), _waiters(0)
+#ifdef __linux__
+    , _eventfd(-1)
+#endif
+{
+#ifdef FUNGUSUTIL_WIN32
+    _event = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+#elif !defined(__linux__)
+    pthread_mutex_init(&_m, nullptr);
+    pthread_cond_init(&_c, nullptr);
+#endif
+}
+
+notifier::~notifier()
+{
+#ifdef FUNGUSUTIL_WIN32
+    CloseHandle(_event);
+#elif !defined(__linux__)
+    pthread_cond_destroy(&_c);
+    pthread_mutex_destroy(&_m);
+#endif
+}
+
+void notifier::_wake()
+{
+#ifdef FUNGUSUTIL_WIN32
+    SetEvent(_event);
+#elif defined(__linux__)
+    syscall(SYS_futex, &_epoch, FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+
+    int fd = __atomic_load_n(&_eventfd, __ATOMIC_ACQUIRE);
+    if (fd >= 0)
+    {
+        // can only fail if the counter is full, which still wakes.
+        uint64_t one = 1;
+        ssize_t written = write(fd, &one, sizeof(one));
+        (void)written;
+    }
+#else
+    pthread_mutex_lock(&_m);
+    pthread_cond_broadcast(&_c);
+    pthread_mutex_unlock(&_m);
+#endif
+}
+
+bool notifier::wait(int epoch, nsec_duration_t timeout)
+{
+    if (get_epoch() != epoch)
+        return true;
+
+    nsec_duration_t deadline = timeout >= 0 ? monotonic_clock::read() + timeout : 0;
+    bool notified = true;
+
+    __atomic_fetch_add(&_waiters, 1, __ATOMIC_SEQ_CST);
+
+    while (get_epoch() == epoch)
+    {
+        nsec_duration_t remaining = 0;
+        if (timeout >= 0)
+        {
+            remaining = deadline - monotonic_clock::read();
+            if (remaining <= 0)
+            {
+                notified = false;
+                break;
+            }
+        }
+
+#ifdef FUNGUSUTIL_WIN32
+        WaitForSingleObject(_event, timeout >= 0 ? (DWORD)((remaining + 999999) / 1000000) : INFINITE);
+#elif defined(__linux__)
+        struct timespec ts;
+        ts.tv_sec  = remaining / 1000000000LL;
+        ts.tv_nsec = remaining % 1000000000LL;
+
+        syscall(SYS_futex, &_epoch, FUTEX_WAIT_PRIVATE, epoch,
+                timeout >= 0 ? &ts : nullptr, nullptr, 0);
+#else
+        pthread_mutex_lock(&_m);
+        if (get_epoch() == epoch)
+        {
+            if (timeout >= 0)
+            {
+                struct timespec ts;
+                clock_gettime(CLOCK_REALTIME, &ts);
+
+                nsec_duration_t abs_nsec = (nsec_duration_t)ts.tv_nsec + remaining;
+                ts.tv_sec += abs_nsec / 1000000000LL;
+                ts.tv_nsec = abs_nsec % 1000000000LL;
+
+                pthread_cond_timedwait(&_c, &_m, &ts);
+            }
+            else
+                pthread_cond_wait(&_c, &_m);
+        }
+        pthread_mutex_unlock(&_m);
+#endif
+    }
+
+    __atomic_fetch_sub(&_waiters, 1, __ATOMIC_SEQ_CST);
+    return notified;
+}
+
+#ifdef __linux__
+// counts as a waiter, so that notify() takes the slow path and writes
+// to the eventfd.
+void notifier::attach_eventfd(int fd)
+{
+    __atomic_store_n(&_eventfd, fd, __ATOMIC_RELEASE);
+    __atomic_fetch_add(&_waiters, 1, __ATOMIC_SEQ_CST);
+}
+
+void notifier::detach_eventfd()
+{
+    __atomic_fetch_sub(&_waiters, 1, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&_eventfd, -1, __ATOMIC_RELEASE);
+}
+#endif
+
 #ifdef FUNGUSUTIL_POSIX
 } // close the namespace to include another header.
 
@@ -120,7 +246,7 @@ void *thread::wrapper_function(void * args__)
 }
 
 thread::thread(void (*fn)(void *), void * args__):
-    _handle(0), _not_thread(true)
+    _handle(0), _not_thread(true), _unjoined(false)
 #ifdef FUNGUSUTIL_WIN32
     , w32_thread_id(0)
 #endif
@@ -132,11 +258,25 @@ thread::~thread()
 {
     if(joinable())
         std::terminate();
+
+    // finished, but its resources are only freed by a join.
+    join();
 }
 
+// joins even a thread that has already finished, which no longer counts
+// as joinable().  the lock is not held while waiting, since the thread
+// takes it on its way out.
 void thread::join()
 {
-    if (joinable())
+    bool unjoined;
+    {
+        lock guard(_data_mutex);
+
+        unjoined  = _unjoined;
+        _unjoined = false;
+    }
+
+    if (unjoined)
     {
 #ifdef FUNGUSUTIL_WIN32
         WaitForSingleObject(_handle, INFINITE);
@@ -148,9 +288,9 @@ void thread::join()
 
 void thread::start(void (*fn)(void *), void *args__)
 {
-    lock guard(_data_mutex);
+    join();
 
-    if (joinable()) join();
+    lock guard(_data_mutex);
 
     _thread_start_info * ti = new _thread_start_info;
     ti->_fn = fn;
@@ -158,6 +298,7 @@ void thread::start(void (*fn)(void *), void *args__)
     ti->_m_thread = this;
 
     _not_thread = false;
+    _unjoined   = true;
 
 #ifdef FUNGUSUTIL_WIN32
     _handle = (HANDLE) _beginthreadex(0, 0, wrapper_function, (void *) ti, 0, &w32_thread_id);
@@ -169,6 +310,7 @@ void thread::start(void (*fn)(void *), void *args__)
     if (!_handle)
     {
         _not_thread = true;
+        _unjoined   = false;
         delete ti;
     }
 }
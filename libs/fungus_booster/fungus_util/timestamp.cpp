@@ -22,3 +22,19 @@ int gettimeofday(struct timeval *tp, struct timezone *tzp)
     return 0;
 }
 #endif
+
+namespace fungus_util
+{
+    // 0 means this thread has not read the clock yet.
+    static __thread nsec_duration_t __monotonic_now = 0;
+
+    nsec_duration_t monotonic_clock::update()
+    {
+        return __monotonic_now = read();
+    }
+
+    nsec_duration_t monotonic_clock::now()
+    {
+        return __monotonic_now ? __monotonic_now : update();
+    }
+}